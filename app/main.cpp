@@ -22,6 +22,49 @@ void signalHandler(int) {
     g_shouldExit = true;
 }
 
+// 設定ファイルの満杯時の扱いをバッファのオプションへ変換する
+global_buffer::OverflowPolicy toOverflowPolicy(framework4cpp::OverflowMode mode) {
+    switch (mode) {
+    case framework4cpp::OverflowMode::BlockTimeout:
+        return global_buffer::OverflowPolicy::BlockWithTimeout;
+    case framework4cpp::OverflowMode::DropNewest:
+        return global_buffer::OverflowPolicy::DropNewest;
+    case framework4cpp::OverflowMode::DropOldest:
+        return global_buffer::OverflowPolicy::DropOldest;
+    case framework4cpp::OverflowMode::Spill:
+        return global_buffer::OverflowPolicy::Spill;
+    case framework4cpp::OverflowMode::Block:
+        break;
+    }
+    return global_buffer::OverflowPolicy::Block;
+}
+
+// 設定ファイルの待ち方をバッファのオプションへ変換する
+global_buffer::WaitStrategy toWaitStrategy(framework4cpp::WaitMode mode) {
+    switch (mode) {
+    case framework4cpp::WaitMode::SpinYieldPark:
+        return global_buffer::WaitStrategy::SpinYieldPark;
+    case framework4cpp::WaitMode::BusySpin:
+        return global_buffer::WaitStrategy::BusySpin;
+    case framework4cpp::WaitMode::Blocking:
+        break;
+    }
+    return global_buffer::WaitStrategy::Blocking;
+}
+
+// 設定ファイルの受信時刻の取得元をバッファのオプションへ変換する
+global_buffer::ClockSource toClockSource(framework4cpp::ClockMode mode) {
+    switch (mode) {
+    case framework4cpp::ClockMode::RealtimeCoarse:
+        return global_buffer::ClockSource::RealtimeCoarse;
+    case framework4cpp::ClockMode::Tsc:
+        return global_buffer::ClockSource::Tsc;
+    case framework4cpp::ClockMode::Realtime:
+        break;
+    }
+    return global_buffer::ClockSource::Realtime;
+}
+
 } // namespace
 
 int main(int argc, char **argv) {
@@ -51,33 +94,109 @@ int main(int argc, char **argv) {
             // バックファイル名が明示指定されていれば採用
             bufferOptions.backingFile = config.buffer.backingFile;
         }
+        // メモリマップトファイルのデータ領域サイズ（0 の場合はバッファ側で算出）
+        bufferOptions.sizeBytes = config.buffer.sizeBytes;
+        // 溜めるペイロードの合計バイト数の上限（0 なら件数だけで制限）
+        bufferOptions.maxBytes = config.buffer.maxBytes;
+        // 前回の未消費データを引き継ぐかどうか
+        bufferOptions.recover = config.buffer.recover;
+        // メモリマップトファイルの事前割り当て・固定・huge page
+        bufferOptions.prefaultMapping = config.buffer.prefault;
+        bufferOptions.lockMapping = config.buffer.lockMemory;
+        bufferOptions.hugePages = config.buffer.hugePages;
+        // 複数のプロセスでリングを共有するかどうか
+        bufferOptions.shareAcrossProcesses = config.buffer.shared;
+        // セッションごとの lane と、その取り出し順序
+        bufferOptions.producerLanes = config.buffer.producerLanes;
+        bufferOptions.laneOrder =
+            config.buffer.orderedLanes ? global_buffer::LaneOrder::Timestamp : global_buffer::LaneOrder::RoundRobin;
+        // 満杯時の扱い
+        bufferOptions.overflowPolicy = toOverflowPolicy(config.buffer.overflowPolicy);
+        bufferOptions.overflowTimeout = config.buffer.overflowTimeout;
+        if (!config.buffer.spillFile.empty()) {
+            bufferOptions.spillFile = config.buffer.spillFile;
+        }
+        // 満杯・空のときの待ち方
+        bufferOptions.waitStrategy = toWaitStrategy(config.buffer.waitStrategy);
+        bufferOptions.spinCount = config.buffer.waitSpinCount;
+        bufferOptions.yieldCount = config.buffer.waitYieldCount;
+        // 受信時刻の取得元
+        bufferOptions.clockSource = toClockSource(config.buffer.clockSource);
+        bufferOptions.clockResyncInterval = config.buffer.clockResyncInterval;
+        // 入力セッションへ読み取りの一時停止・再開を求める占有率
+        bufferOptions.highWatermark = static_cast<double>(config.buffer.highWatermarkPercent) / 100.0;
+        bufferOptions.lowWatermark = static_cast<double>(config.buffer.lowWatermarkPercent) / 100.0;
         // フィールド名の指定があればバッファオプションに転記
         bufferOptions.fieldNames.source = config.buffer.fieldNames.source;
         bufferOptions.fieldNames.timestamp = config.buffer.fieldNames.timestamp;
         bufferOptions.fieldNames.payload = config.buffer.fieldNames.payload;
+        bufferOptions.fieldNames.sequence = config.buffer.fieldNames.sequence;
+        bufferOptions.fieldNames.sourceSequence = config.buffer.fieldNames.sourceSequence;
 
         // 共有バッファを設定に従って初期化
         global_buffer::GlobalBuffer buffer(bufferOptions);
+        if (buffer.recoveredCount() > 0) {
+            // 前回の実行で書き出されなかったデータは CSV へ先に出力される
+            std::cout << "Recovered " << buffer.recoveredCount() << " buffered records from "
+                      << bufferOptions.backingFile << std::endl;
+        }
+        if (bufferOptions.memoryMapped) {
+            // バックファイルの領域が実際にどう確保されたかを表示する（常駐量などは取得できた場合のみ）
+            const auto mapping = buffer.mappingReport();
+            std::cout << "Buffer mapping: " << mapping.mappedBytes << " bytes, page size " << mapping.pageSize
+                      << (mapping.hugetlbfs ? " (hugetlbfs)" : "") << ", prefaulted "
+                      << (mapping.prefaulted ? "yes" : "no") << ", locked " << (mapping.locked ? "yes" : "no")
+                      << ", huge pages advised " << (mapping.hugePagesAdvised ? "yes" : "no") << "; resident "
+                      << mapping.residentBytes << ", locked " << mapping.lockedBytes << ", huge " << mapping.hugePageBytes
+                      << " bytes" << std::endl;
+            if (!mapping.notes.empty()) {
+                std::cout << "Buffer mapping notes: " << mapping.notes << std::endl;
+            }
+        }
+
+        if (bufferOptions.clockSource != global_buffer::ClockSource::Realtime) {
+            // 要求した時計を使えなかった場合は、代わりに使う時計と理由を表示する
+            const auto &clock = buffer.clock();
+            if (clock.source() == bufferOptions.clockSource) {
+                std::cout << "Timestamp clock: "
+                          << (clock.source() == global_buffer::ClockSource::Tsc ? "tsc" : "realtime_coarse");
+                if (clock.source() == global_buffer::ClockSource::Tsc) {
+                    std::cout << ", " << clock.nanosecondsPerTick() << " ns per tick";
+                }
+                std::cout << std::endl;
+            } else {
+                std::cout << "Timestamp clock: realtime (" << clock.note() << ")" << std::endl;
+            }
+        }
+
+        // 共有時は役割に応じて、入力セッションと CSV 出力の一方だけを動かせる
+        const auto role = config.buffer.shared ? config.buffer.processRole : framework4cpp::ProcessRole::Both;
+        const bool runSessions = role != framework4cpp::ProcessRole::Writer;
+        const bool runWriter = role != framework4cpp::ProcessRole::Producer;
 
         // 有効なセッションのみ生成するためのコンテナ
         std::vector<framework4cpp::StreamingSessionPtr> sessions;
         sessions.reserve(3);
-        if (config.fileInput.enabled) {
+        if (runSessions && config.fileInput.enabled) {
             // ファイル入力セッションを生成
             sessions.emplace_back(std::make_unique<framework4cpp::FileSession>(config.fileInput, buffer));
         }
-        if (config.serialInput.enabled) {
+        if (runSessions && config.serialInput.enabled) {
             // シリアル入力セッションを生成
             sessions.emplace_back(std::make_unique<framework4cpp::SerialSession>(config.serialInput, buffer));
         }
-        if (config.ipInput.enabled) {
+        if (runSessions && config.ipInput.enabled) {
             // ネットワーク入力セッションを生成
             sessions.emplace_back(std::make_unique<framework4cpp::IpSession>(config.ipInput, buffer));
         }
 
-        // CSV への書き込みワーカーを初期化・起動
-        framework4cpp::CsvWriter writer(config.csv, buffer);
-        writer.start();
+        // CSV への書き込みワーカーを初期化・起動（共有時は既に他のプロセスが書き出していれば起動前に失敗させる）
+        std::unique_ptr<framework4cpp::CsvWriter> writer;
+        if (runWriter) {
+            buffer.acquireConsumer();
+            writer = std::make_unique<framework4cpp::CsvWriter>(config.csv, buffer);
+            writer->start();
+        }
 
         // すべてのセッションを起動
         for (auto &session : sessions) {
@@ -107,7 +226,45 @@ int main(int argc, char **argv) {
 
         // バッファとライターも停止処理を実施
         buffer.shutdown();
-        writer.stop();
+        if (writer) {
+            writer->stop();
+        }
+
+        // 満杯のために捨てた・退避したデータがあれば件数を報告する
+        const auto overflow = buffer.overflowStats();
+        if (overflow.droppedNewest + overflow.droppedOldest + overflow.timedOut + overflow.spilled > 0) {
+            std::cout << "Buffer overflow: dropped " << overflow.droppedNewest << " newest, "
+                      << overflow.droppedOldest << " oldest, " << overflow.timedOut << " timed out; spilled "
+                      << overflow.spilled << ", restored " << overflow.restored << std::endl;
+        }
+        if (writer) {
+            // 発生元ごとの通し番号に抜けがあれば、届かなかった件数と直近の範囲を報告する
+            for (const auto &gap : writer->gapStats()) {
+                if (gap.missing == 0 && gap.reordered == 0) {
+                    continue;
+                }
+                std::cout << "Sequence gaps in '" << buffer.sourceName(gap.source) << "': " << gap.missing
+                          << " missing in " << gap.gaps << " ranges, " << gap.reordered << " reordered";
+                for (const auto &range : gap.recent) {
+                    std::cout << ' ' << range.first << '-' << range.last;
+                }
+                std::cout << std::endl;
+            }
+            // 書き込めずに捨てた行があれば、最初の失敗を報告する
+            if (writer->writeError()) {
+                std::cerr << "CSV write failed: " << *writer->writeError() << std::endl;
+            }
+            // 再起動後に重複や欠落を確かめられるよう、書き出した位置を報告する
+            if (config.csv.includeSequence && writer->lastSequence()) {
+                std::cout << "Last written sequence: " << *writer->lastSequence() << std::endl;
+            }
+        }
+        if (bufferOptions.waitStrategy != global_buffer::WaitStrategy::Blocking) {
+            // 待ち方を調整できるよう、待機がどの段階で終わったかを報告する
+            const auto waits = buffer.waitStats();
+            std::cout << "Buffer waits: " << waits.spinHits << " spin, " << waits.yieldHits << " yield, "
+                      << waits.parks << " park" << std::endl;
+        }
 
         return 0;
     } catch (const std::exception &ex) {
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace global_buffer {
+
+// 受信時刻の取得元
+enum class ClockSource {
+    // CLOCK_REALTIME（system_clock::now と同じ）
+    Realtime,
+    // CLOCK_REALTIME_COARSE（分解能はカーネルのティック程度だが、読み取りはより安価）
+    RealtimeCoarse,
+    // CPU のタイムスタンプカウンタを壁時計に合わせて換算する（一定間隔で壁時計に合わせ直す）
+    Tsc
+};
+
+// データに受信時刻を付けるための時計（スレッドセーフ。バッファごとに 1 つを全セッションで共有する）
+// 壁時計が戻されたり合わせ直したりしても、同じ時計が返す時刻はプロセス内で減少しない
+class Clock {
+public:
+    // source の時計を用意する。Tsc は起動時に約 10 ms かけて換算係数を測り、resyncInterval ごとに測り直す
+    // 不変 TSC を持たない環境など、要求した取得元を使えない場合は Realtime で動作する
+    explicit Clock(ClockSource source = ClockSource::Realtime,
+                   std::chrono::milliseconds resyncInterval = std::chrono::milliseconds{1000});
+    Clock(const Clock &) = delete;
+    Clock &operator=(const Clock &) = delete;
+
+    // 現在時刻（これまでに返した時刻以上）
+    std::chrono::system_clock::time_point now();
+    // 実際に使っている取得元
+    ClockSource source() const { return source_; }
+    // 要求した取得元を使えなかった理由（使えた場合は空）
+    const std::string &note() const { return note_; }
+    // Tsc で 1 カウントあたりのナノ秒数（Tsc 以外では 0）
+    double nanosecondsPerTick() const { return nanosecondsPerTick_.load(std::memory_order_relaxed); }
+
+private:
+    // 取得元から読んだ、system_clock のエポックからのナノ秒
+    std::int64_t read();
+    // カウンタの値を換算係数で壁時計のナノ秒へ変換する（合わせ直す時期なら先に合わせ直す）
+    std::int64_t readTsc();
+    // カウンタと壁時計を同時に読み、換算の基準を更新する（initial なら換算係数も初めて測る）
+    void calibrate(bool initial);
+
+    // 実際に使っている取得元
+    ClockSource source_;
+    // 要求した取得元を使えなかった理由
+    std::string note_;
+    // 合わせ直す間隔（カウント数）
+    std::uint64_t resyncTicks_{0};
+    // 換算の基準。version_ が奇数の間は更新中で、読み手は読み直す
+    std::atomic<std::uint32_t> version_{0};
+    std::atomic<std::uint64_t> baseTicks_{0};
+    std::atomic<std::int64_t> baseNanoseconds_{0};
+    std::atomic<double> nanosecondsPerTick_{0.0};
+    // 合わせ直しを 1 スレッドだけが行うためのフラグ
+    std::atomic<bool> resyncing_{false};
+    // これまでに返した最も新しい時刻（ナノ秒）。各セッションが更新するため別のキャッシュラインへ置く
+    alignas(64) std::atomic<std::int64_t> latest_{0};
+};
+
+} // namespace global_buffer
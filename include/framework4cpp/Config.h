@@ -22,6 +22,54 @@ struct BufferFieldNames {
     std::string timestamp{"timestamp"};
     // ペイロードフィールド名（未指定時は "payload"）
     std::string payload{"payload"};
+    // 全体の通し番号のフィールド名（未指定時は "sequence"）
+    std::string sequence{"sequence"};
+    // 発生元ごとの通し番号のフィールド名（未指定時は "source_sequence"）
+    std::string sourceSequence{"source_sequence"};
+};
+
+// バッファが満杯のときに投入されたデータの扱い（overflow_policy の値に対応）
+enum class OverflowMode {
+    // block: 空きができるまで待機する
+    Block,
+    // block_timeout: overflow_timeout_ms だけ待機し、期限切れなら新しいデータを捨てる
+    BlockTimeout,
+    // drop_newest: 待機せずに新しいデータを捨てる
+    DropNewest,
+    // drop_oldest: 未出力の最古のデータを捨てて空きを作る
+    DropOldest,
+    // spill: 新しいデータを spill_file へ退避し、バッファが空になってから出力する
+    Spill
+};
+
+// バッファが満杯・空のときの待ち方（wait_strategy の値に対応）
+enum class WaitMode {
+    // blocking: すぐに眠る
+    Blocking,
+    // spin_yield_park: wait_spin_count 回スピンし、wait_yield_count 回 CPU を譲ってから眠る
+    SpinYieldPark,
+    // busy_spin: 眠らずにスピンし続ける
+    BusySpin
+};
+
+// 受信時刻の取得元（clock_source の値に対応）
+enum class ClockMode {
+    // realtime: CLOCK_REALTIME
+    Realtime,
+    // realtime_coarse: CLOCK_REALTIME_COARSE
+    RealtimeCoarse,
+    // tsc: CPU のタイムスタンプカウンタを壁時計に合わせて換算する
+    Tsc
+};
+
+// バッファを複数のプロセスで共有する場合の、このプロセスの役割（process_role の値に対応）
+enum class ProcessRole {
+    // both: 入力セッションと CSV 出力の両方を動かす
+    Both,
+    // producer: 入力セッションだけを動かし、CSV 出力は writer のプロセスに任せる
+    Producer,
+    // writer: CSV 出力だけを動かす
+    Writer
 };
 
 // グローバルバッファに関する設定を保持する構造体
@@ -34,10 +82,58 @@ struct BufferSettings {
     bool memoryMapped{false};
     // メモリマップトファイルを利用する際のバックファイルパス
     std::string backingFile{};
+    // メモリマップトファイルのデータ領域のバイト数（0 なら capacity と max_payload_size から算出）
+    std::size_t sizeBytes{0};
+    // バッファに溜めるペイロードの合計バイト数の上限（0 なら capacity の件数だけで制限する）
+    std::size_t maxBytes{0};
+    // 前回のバックファイルに残った未消費データを起動時に引き継ぐかどうか
+    bool recover{true};
+    // メモリマップトファイルの全ページを起動時に割り当てるかどうか
+    bool prefault{false};
+    // メモリマップトファイルの領域をメモリに固定するかどうか
+    bool lockMemory{false};
+    // メモリマップトファイルの領域に透過的 huge page の利用を助言するかどうか
+    bool hugePages{false};
+    // メモリマップトファイルのリングを複数のプロセスで共有するかどうか
+    bool shared{false};
+    // 共有時にこのプロセスが担う役割
+    ProcessRole processRole{ProcessRole::Both};
+    // 入力セッションごとに専用のリング（lane）を割り当てるかどうか
+    bool producerLanes{false};
+    // lane から取り出す際に受信時刻順へ並べ替えるかどうか（false ならラウンドロビン）
+    bool orderedLanes{true};
+    // バッファが満杯のときに投入されたデータの扱い
+    OverflowMode overflowPolicy{OverflowMode::Block};
+    // block_timeout で空きを待つ最大時間
+    std::chrono::milliseconds overflowTimeout{std::chrono::milliseconds{100}};
+    // spill で使う退避ファイルのパス（空ならバッファ側のデフォルト）
+    std::string spillFile{};
+    // 満杯・空のときの待ち方
+    WaitMode waitStrategy{WaitMode::Blocking};
+    // spin_yield_park でスピンする回数
+    std::size_t waitSpinCount{500};
+    // spin_yield_park で CPU を譲る回数
+    std::size_t waitYieldCount{20};
+    // 受信時刻の取得元
+    ClockMode clockSource{ClockMode::Realtime};
+    // tsc で壁時計に合わせ直す間隔
+    std::chrono::milliseconds clockResyncInterval{std::chrono::milliseconds{1000}};
+    // 入力セッションへ読み取りの一時停止を求める占有率（%。0 なら通知しない）
+    std::size_t highWatermarkPercent{0};
+    // 一時停止した読み取りを再開させる占有率（%。high_watermark_percent 未満）
+    std::size_t lowWatermarkPercent{0};
     // BufferItem のフィールド名設定
     BufferFieldNames fieldNames{};
 };
 
+// CSV のペイロード列の 16 進表記（payload_layout の値に対応）
+enum class PayloadLayout {
+    // spaced: バイトごとに空白で区切る（"0a 1b 2c"）
+    Spaced,
+    // packed: 区切らない（"0a1b2c"）
+    Packed
+};
+
 // CSV 出力の整形と出力方法に関する設定
 struct CsvSettings {
     // 出力する CSV ファイルのパス
@@ -48,10 +144,20 @@ struct CsvSettings {
     bool quoteStrings{true};
     // タイムスタンプ列を含めるかどうか
     bool includeTimestamp{true};
+    // 全体と発生元ごとの通し番号の列を含めるかどうか
+    bool includeSequence{false};
     // 出力バッファをフラッシュする間隔
     std::chrono::milliseconds flushInterval{std::chrono::milliseconds{1000}};
+    // 整形した行をまとめてファイルへ書き込む単位（バイト数。溜まるかフラッシュ間隔が来た時点で書き込む。0 は不可）
+    std::size_t writeBufferBytes{1024 * 1024};
+    // 出力ファイルの末尾の先を前もって確保する単位（バイト数。0 なら確保しない）
+    std::size_t preallocateBytes{0};
+    // 書き込むたびにストレージまで書き出す（fdatasync）かどうか
+    bool syncWrites{false};
     // タイムスタンプ整形に使用するフォーマット文字列
     std::string timestampFormat{"%Y-%m-%d %H:%M:%S"};
+    // ペイロード列の 16 進表記
+    PayloadLayout payloadLayout{PayloadLayout::Spaced};
 };
 
 // ファイル入力を制御するための設定
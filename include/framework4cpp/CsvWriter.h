@@ -2,12 +2,20 @@
 
 #include "framework4cpp/Config.h"
 #include "framework4cpp/GlobalBuffer.h"
+#include "framework4cpp/HexEncoder.h"
+#include "framework4cpp/OutputFile.h"
+#include "framework4cpp/TimestampFormatter.h"
 
 #include <atomic>
-#include <fstream>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <thread>
+#include <vector>
 
 namespace framework4cpp {
 
@@ -19,17 +27,68 @@ public:
     void start();
     void stop();
 
+    // 発生元ごとの通し番号の抜け（stop 後に参照する）
+    std::vector<SourceGapStats> gapStats() const { return gaps_.stats(); }
+    // 書き出したデータのうち最も大きい全体の通し番号（再開位置の目安。stop 後に参照し、未出力なら空）
+    std::optional<std::uint64_t> lastSequence() const { return lastSequence_; }
+    // 最初に失敗した書き込みのエラー（stop 後に参照し、失敗していなければ空）
+    std::optional<std::string> writeError() const { return writeError_; }
+
 private:
+    // 1 回の取り出しでまとめて処理する最大件数
+    static constexpr std::size_t kMaxBatchItems = 256;
+    // フラッシュ間隔 0 のときにデータ待ちで待機する上限
+    static constexpr std::chrono::milliseconds kIdleWait{100};
+    // 書き込みスレッドが書き込み中のとき、整形スレッドが待たずに溜めてよい量（write_buffer の倍数）
+    static constexpr std::size_t kMaxPendingBuffers = 4;
+    // 書き込み単位の下限（小さすぎると 1 行ごとに書き込み側と待ち合わせ、整形と書き込みが重ならなくなる）
+    static constexpr std::size_t kMinWriteBufferBytes = 4 * 1024;
+
+    // 整形スレッド：バッファから取り出して pending_ へ整形する
     void run();
-    std::string formatRecord(const BufferItem &item) const;
-    static std::string escape(const std::string &value);
+    // pending_ を書き込みスレッドへ渡す（渡せたか、渡すものが無ければ true）
+    // wait が false なら、書き込み中のときは溜められる上限までは待たずに false を返す
+    bool handOff(bool wait);
+    // 書き込みスレッド：渡された written_ をファイルへ書き込む
+    void writeLoop();
+    // バッファ内のデータを参照したまま 1 行分（改行を除く）を out の末尾へ整形する
+    void appendRecord(const ItemView &item, std::string &out) const;
+    // 発生元番号に対応する列の文字列（エスケープ・引用符付けは初回のみ行う）
+    const std::string &sourceColumn(SourceId id) const;
+    // value を 10 進で out の末尾へ追加する
+    static void appendNumber(std::uint64_t value, std::string &out);
+    // out の begin 以降に含まれる二重引用符を、その場で 2 つ重ねてエスケープする
+    static void escapeFrom(std::string &out, std::size_t begin);
 
     CsvSettings settings_;
     GlobalBuffer &buffer_;
-    std::ofstream output_;
+    OutputFile output_;
     std::thread worker_;
+    std::thread ioWorker_;
     std::atomic<bool> running_{false};
-    mutable std::mutex fileMutex_;
+    // 出力する列の並び（Schema から開始前に取得する）
+    std::vector<Column> columns_;
+    // ペイロード列の 16 進表記
+    HexLayout hexLayout_;
+    // タイムスタンプ列の書式（書き込みスレッドだけが使い、直前の秒の整形結果を使い回す）
+    mutable TimestampFormatter timestamp_;
+    // 整形した行を書き込み側へ渡すまで溜める領域（整形スレッドだけが使い、容量を使い回す）
+    std::string pending_;
+    // 書き込みスレッドへ渡した領域（pending_ と入れ替えて受け渡す）
+    std::string written_;
+    // written_ の受け渡しを保護し、書き込みの依頼と完了を互いに知らせる
+    std::mutex handoffMutex_;
+    std::condition_variable handoffCondition_;
+    // written_ を書き込み中かどうかと、書き込みスレッドを動かし続けるかどうか
+    bool writing_{false};
+    bool ioRunning_{false};
+    // 発生元番号ごとに整形済みの列文字列を保持する（書き込みスレッドだけが参照する）
+    mutable std::vector<std::optional<std::string>> sourceColumns_;
+    // 発生元ごとの通し番号を追い、届かなかったデータを数える（書き込みスレッドだけが更新する）
+    GapDetector gaps_;
+    // 書き出したデータのうち最も大きい全体の通し番号
+    std::optional<std::uint64_t> lastSequence_;
+    std::optional<std::string> writeError_;
 };
 
 } // namespace framework4cpp
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "framework4cpp/SourceRegistry.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace global_buffer {
+
+// 発生元ごとの通し番号のうち、届かなかった範囲 [first, last]
+struct SequenceGap {
+    std::uint64_t first{0};
+    std::uint64_t last{0};
+};
+
+// 発生元 1 つ分の受信状況
+struct SourceGapStats {
+    // 発生元の番号
+    SourceId source{kAnonymousSource};
+    // 受け取った件数
+    std::uint64_t received{0};
+    // 届かなかった件数
+    std::uint64_t missing{0};
+    // 届かなかった範囲の数
+    std::uint64_t gaps{0};
+    // 既に通過した番号が後から届いた件数（同じ発生元へ複数の生産者が投入した場合など）
+    std::uint64_t reordered{0};
+    // 次に届くはずの番号
+    std::uint64_t next{0};
+    // 直近に検出した範囲（古い順に GapDetector::kMaxRecentGaps 件まで）
+    std::vector<SequenceGap> recent;
+};
+
+// 消費者側で発生元ごとの通し番号を追い、届かなかった範囲を数える（1 つのスレッドから使う）
+// 各発生元で最初に受け取った番号を起点にするため、それより前に失われたデータは数えない
+class GapDetector {
+public:
+    // 発生元ごとに保持する直近の範囲の数
+    static constexpr std::size_t kMaxRecentGaps = 16;
+
+    // 受け取ったデータの番号を記録し、その直前に届かなかった件数を返す
+    std::uint64_t observe(SourceId source, std::uint64_t sourceSequence);
+    // これまでに受け取った発生元ごとの状況（発生元番号の順）
+    std::vector<SourceGapStats> stats() const;
+    // 全発生元で届かなかった件数の合計
+    std::uint64_t missing() const { return missing_; }
+
+private:
+    struct Track {
+        // 1 件以上受け取ったか
+        bool seen{false};
+        SourceGapStats stats;
+    };
+
+    // 発生元番号ごとの状況
+    std::vector<Track> tracks_;
+    // 届かなかった件数の合計
+    std::uint64_t missing_{0};
+};
+
+} // namespace global_buffer
@@ -1,38 +1,125 @@
 #pragma once
 
+#include "framework4cpp/Clock.h"
+#include "framework4cpp/GapDetector.h"
+#include "framework4cpp/Payload.h"
+#include "framework4cpp/Schema.h"
+#include "framework4cpp/SourceRegistry.h"
+
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <cstddef>
 #include <cstdint>
-#include <deque>
-#include <limits>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace global_buffer {
 
-// グローバルバッファでデータを扱う際のフィールド名セット
-struct FieldNames {
-    // 発生元を表すフィールド名（デフォルトは "source"）
-    std::string source{"source"};
-    // タイムスタンプを表すフィールド名（デフォルトは "timestamp"）
-    std::string timestamp{"timestamp"};
-    // ペイロードを表すフィールド名（デフォルトは "payload"）
-    std::string payload{"payload"};
-};
+// 偽共有を避けるために想定するキャッシュラインサイズ
+inline constexpr std::size_t kCacheLineSize = 64;
 
-// 入出力で共有する 1 レコード分のデータを格納する構造体
+// 入出力で共有する 1 レコード分のデータを格納する構造体（フィールド名はバッファの Schema が持つ）
 struct BufferItem {
-    // データの発生元（ファイルパスやポートなど）
-    std::string source;
+    // データの発生元（registerSource で登録した番号。未指定なら名前の無い発生元）
+    SourceId source{kAnonymousSource};
     // データを受信した時刻
     std::chrono::system_clock::time_point timestamp;
-    // 受信した生データのバイト列
-    std::vector<std::uint8_t> payload;
-    // 取り扱いフィールド名（用途に応じてデフォルトから上書き可能）
-    FieldNames fieldNames;
+    // 受信した生データのバイト列（小さなデータは内部に保持し、大きなデータは PayloadPool から得る）
+    Payload payload;
+    // 投入時に振られるバッファ全体の通し番号（満杯で捨てられたデータも番号を消費する）
+    std::uint64_t sequence{0};
+    // 投入時に振られる発生元ごとの通し番号（抜けから、途中で失われたデータを検出できる）
+    std::uint64_t sourceSequence{0};
+};
+
+// 生産者ごとのリング（lane）を使う場合に、消費者が各 lane からデータを取り出す順序
+enum class LaneOrder {
+    // 各 lane の先頭のうち受信時刻が最も古いものから取り出す（k-way マージ。取り出し時点で届いているデータの範囲で並べる）
+    Timestamp,
+    // 順序を問わず、データのある lane から 1 件ずつ順番に取り出す
+    RoundRobin
+};
+
+// バッファが満杯のときに投入されたデータの扱い
+enum class OverflowPolicy {
+    // 空きができるまで待機する
+    Block,
+    // 最大 overflowTimeout だけ待機し、期限切れなら新しいデータを捨てる
+    BlockWithTimeout,
+    // 待機せずに新しいデータを捨てる
+    DropNewest,
+    // 消費者がまだ取り出していない最古のデータを捨てて空きを作る
+    DropOldest,
+    // 新しいデータをディスク上の退避ファイルへ書き出し、バッファが空になってから消費者へ渡す
+    Spill
+};
+
+// 満杯時の扱いによって捨てた・退避したデータの件数（各事象の発生時に 1 件ずつ数える）
+struct OverflowStats {
+    // 待機せずに捨てた新しいデータの件数（DropNewest）
+    std::uint64_t droppedNewest{0};
+    // 空きを作るために捨てた古いデータの件数（DropOldest）
+    std::uint64_t droppedOldest{0};
+    // 待機が期限切れになり捨てたデータの件数（BlockWithTimeout）
+    std::uint64_t timedOut{0};
+    // 退避ファイルへ書き出したデータの件数（Spill）
+    std::uint64_t spilled{0};
+    // 退避ファイルから消費者へ渡したデータの件数（Spill）
+    std::uint64_t restored{0};
+};
+
+// 満杯・空のときに生産者・消費者が条件の成立を待つ方法
+enum class WaitStrategy {
+    // すぐに条件変数で眠る（CPU を使わないが、起床のたびにシステムコールとスケジューリングを伴う）
+    Blocking,
+    // spinCount 回スピンし、続けて yieldCount 回 CPU を譲ってから条件変数で眠る
+    SpinYieldPark,
+    // 眠らずにスピンし続ける（専用コアに固定したスレッド向け）
+    BusySpin
+};
+
+// 待機がどの段階で終わったかの集計
+struct WaitStats {
+    // スピン中に条件が満たされた回数
+    std::uint64_t spinHits{0};
+    // CPU を譲っている間に条件が満たされた回数
+    std::uint64_t yieldHits{0};
+    // 条件変数で眠った回数
+    std::uint64_t parks{0};
+};
+
+// メモリマップト利用時に、バッファの領域が実際にどう確保されたか（起動時の確認用）
+// 常駐・固定・huge page のバイト数は Linux の /proc/self/smaps から得た値で、取得できない環境では 0
+struct MappingReport {
+    // メモリマップトファイルを利用しているか（false なら他の項目は全て未設定）
+    bool memoryMapped{false};
+    // マップ全体（制御領域を含む）のバイト数
+    std::size_t mappedBytes{0};
+    // マップに使われたページサイズ（hugetlbfs 上なら huge page のサイズ）
+    std::size_t pageSize{0};
+    // バックファイルが hugetlbfs 上にあり、huge page で直接マップしたか
+    bool hugetlbfs{false};
+    // 起動時に全ページを割り当て済みにしたか
+    bool prefaulted{false};
+    // マップ全体をメモリに固定できたか
+    bool locked{false};
+    // 透過的 huge page の利用を助言できたか（実際に使われたかは hugePageBytes で確認する）
+    bool hugePagesAdvised{false};
+    // 物理メモリに載っているバイト数
+    std::size_t residentBytes{0};
+    // メモリに固定されているバイト数
+    std::size_t lockedBytes{0};
+    // huge page で割り当てられているバイト数（hugetlbfs 上では常駐分の全て）
+    std::size_t hugePageBytes{0};
+    // 指定どおりに準備できなかった項目とその理由（全て成功すれば空）
+    std::string notes;
 };
 
 // グローバルバッファの利用時に指定可能なオプション一式
@@ -45,10 +132,237 @@ struct Options {
     std::string backingFile{"global_buffer.mmap"};
     // 各アイテムの最大ペイロードサイズ（メモリマップト利用時に必須）
     std::size_t maxPayloadSize{4096};
-    // BufferItem 内のフィールド名セット（指定が無ければデフォルト値）
+    // メモリマップトファイルのデータ領域のバイト数（0 なら capacity 件の最大サイズ分を確保）
+    // メモリマップト利用時はこの領域に収まる限りアイテム数の上限は無い
+    std::size_t sizeBytes{0};
+    // 溜まっているペイロードの合計バイト数の上限（0 なら制限しない）。capacity と先に達した方で満杯として扱う
+    // メモリマップト利用時はデータ領域のバイト数（sizeBytes）をこの値までに抑える
+    std::size_t maxBytes{0};
+    // メモリマップト利用時、前回のバックファイルに残った未消費データを引き継ぐかどうか
+    bool recover{true};
+    // メモリマップト利用時、起動時に全ページを割り当てて、最初の 1 周でページフォールトが起きないようにする
+    bool prefaultMapping{false};
+    // メモリマップト利用時、マップ全体をメモリに固定してスワップアウトされないようにする（失敗しても起動は続ける）
+    bool lockMapping{false};
+    // メモリマップト利用時、透過的 huge page の利用を助言する（バックファイルが hugetlbfs 上なら常に huge page を使う）
+    bool hugePages{false};
+    // メモリマップト利用時、同じバックファイルを開いた複数のプロセス（任意の数の生産者と 1 つの消費者）でリングを共有する
+    // lane・購読者・DropOldest・Spill・占有率の通知はプロセス内の状態に依存するため併用できない（POSIX のみ）
+    bool shareAcrossProcesses{false};
+    // openLane で開いた投入口ごとに、専用の単一生産者・単一消費者リング（lane）を割り当てるかどうか
+    // 生産者どうしの競合が無くなり、停滞した生産者が他の生産者のデータを待たせることも無い（メモリ上で動作する場合のみ）
+    bool producerLanes{false};
+    // lane を使う場合の取り出し順序
+    LaneOrder laneOrder{LaneOrder::Timestamp};
+    // バッファが満杯のときに投入されたデータの扱い
+    OverflowPolicy overflowPolicy{OverflowPolicy::Block};
+    // BlockWithTimeout で空きを待つ最大時間
+    std::chrono::milliseconds overflowTimeout{100};
+    // Spill で使う退避ファイル（最初の退避時に作成し、バッファの破棄時に削除する）
+    std::string spillFile{"global_buffer.spill"};
+    // 満杯・空のときの待ち方
+    WaitStrategy waitStrategy{WaitStrategy::Blocking};
+    // SpinYieldPark でスピンする回数
+    std::size_t spinCount{500};
+    // SpinYieldPark で CPU を譲る回数
+    std::size_t yieldCount{20};
+    // 占有率（0.0〜1.0）がこの値に達したら、登録された通知先へ高水位を知らせる（0 なら通知しない）
+    double highWatermark{0.0};
+    // 高水位の通知後、占有率がこの値まで下がったら低水位を知らせる（highWatermark 未満であること）
+    double lowWatermark{0.0};
+    // 受信時刻の取得元（セッションと予約の commit は GlobalBuffer::now で時刻を付ける）
+    ClockSource clockSource{ClockSource::Realtime};
+    // Tsc で壁時計に合わせ直す間隔
+    std::chrono::milliseconds clockResyncInterval{1000};
+    // Schema に設定するフィールド名セット（指定が無ければデフォルト値）
     FieldNames fieldNames{};
 };
 
+class GlobalBuffer;
+class RecordRing;
+class SpillFile;
+
+// 生産者がバッファ内の領域へ直接書き込むための予約ハンドル（ムーブのみ可能）
+class WriteReservation {
+public:
+    WriteReservation() = default;
+    WriteReservation(WriteReservation &&other) noexcept;
+    WriteReservation &operator=(WriteReservation &&other) noexcept;
+    WriteReservation(const WriteReservation &) = delete;
+    WriteReservation &operator=(const WriteReservation &) = delete;
+    // commit も abort もされずに破棄された場合は予約を取り消す
+    ~WriteReservation();
+
+    // 予約が有効か（終了中に予約した場合は無効。満杯で捨てる・退避する場合も有効で、commit 時に扱いが決まる）
+    explicit operator bool() const { return owner_ != nullptr; }
+    // 書き込み先の先頭アドレス
+    std::uint8_t *data() const { return data_; }
+    // 書き込み可能なバイト数
+    std::size_t size() const { return size_; }
+
+    // 先頭 length バイトを 1 レコードとして公開する（受信時刻は commit 時点）
+    void commit(std::size_t length);
+    // 予約を取り消す（消費者からは見えない）
+    void abort();
+
+private:
+    friend class GlobalBuffer;
+
+    // 予約元のバッファ（無効時は nullptr）
+    GlobalBuffer *owner_{nullptr};
+    // 予約した lane の番号 + 1（0 は共有リング）
+    std::size_t lane_{0};
+    // 確保したリング上の位置（メモリマップト利用時はバイト位置）
+    std::uint64_t position_{0};
+    // 書き込み先の領域
+    std::uint8_t *data_{nullptr};
+    std::size_t size_{0};
+    // 満杯のためバッファ外の一時領域を渡した予約か（commit 時に満杯時の扱いに従う）
+    bool overflow_{false};
+    // 予約の発生元（commit 時に発生元ごとの通し番号を振る）
+    SourceId source_{kAnonymousSource};
+};
+
+// 生産者（セッション）ごとのデータの投入口（ムーブのみ可能）
+// producerLanes が有効なら専用の lane へ、無効なら全生産者で共有するリングへ投入する
+// lane は単一生産者を前提とするため、1 つの投入口は同時に 1 スレッドからのみ使うこと
+class ProducerLane {
+public:
+    ProducerLane() = default;
+    ProducerLane(ProducerLane &&other) noexcept;
+    ProducerLane &operator=(ProducerLane &&other) noexcept;
+    ProducerLane(const ProducerLane &) = delete;
+    ProducerLane &operator=(const ProducerLane &) = delete;
+    // lane を閉じる（投入済みのデータは引き続き消費者が取り出す）
+    ~ProducerLane();
+
+    // 投入口が有効か
+    explicit operator bool() const { return owner_ != nullptr; }
+    // 投入口を開いたときの発生元
+    SourceId source() const { return source_; }
+
+    // GlobalBuffer::push / pushBatch / reserve と同じ動作で、この投入口へ投入する
+    void push(BufferItem item);
+    void pushBatch(std::vector<BufferItem> &items);
+    WriteReservation reserve(std::size_t size);
+
+private:
+    friend class GlobalBuffer;
+
+    // lane を閉じて投入口を無効にする
+    void close() noexcept;
+
+    // 投入先のバッファ（無効時は nullptr）
+    GlobalBuffer *owner_{nullptr};
+    // 割り当てた lane の番号 + 1（0 は共有リング）
+    std::size_t lane_{0};
+    // 予約時に使う発生元
+    SourceId source_{kAnonymousSource};
+};
+
+// 消費者がバッファ内のデータをコピーせずに参照するためのビュー（release まで有効）
+// 購読者が受け取ったビューは Subscription の次の read か release まで有効
+struct ItemView {
+    // データの発生元の番号（名前は GlobalBuffer::sourceName で引く）
+    SourceId source{kAnonymousSource};
+    // データを受信した時刻
+    std::chrono::system_clock::time_point timestamp;
+    // ペイロードの先頭（バッファ内部を直接指す）
+    const std::uint8_t *payload{nullptr};
+    // ペイロードのバイト数
+    std::size_t payloadSize{0};
+    // バッファ全体の通し番号
+    std::uint64_t sequence{0};
+    // 発生元ごとの通し番号
+    std::uint64_t sourceSequence{0};
+    // release で返却するリング上の位置（メモリマップト利用時はバイト位置）
+    std::uint64_t position{0};
+};
+
+// 購読者がデータの流入に追いつけないときの扱い
+enum class SinkMode {
+    // 購読者が処理を終えるまで、そのデータの領域を再利用させない（生産者は待機する）
+    Blocking,
+    // バッファが満杯なら、購読者が未読の最古のデータを読み飛ばさせて生産者を先へ進める
+    Lossy
+};
+
+// 独自の読み出し位置を持ち、全データを受け取る購読者のハンドル（ムーブのみ可能）
+// 購読者どうしや pop 等で取り出す消費者とは独立に、同じデータを同じ順序で受け取る
+class Subscription {
+public:
+    Subscription() = default;
+    Subscription(Subscription &&other) noexcept;
+    Subscription &operator=(Subscription &&other) noexcept;
+    Subscription(const Subscription &) = delete;
+    Subscription &operator=(const Subscription &) = delete;
+    // 保持中のデータを返却し、以降は生産者を待たせない読み飛ばし対象として扱わせる（バッファより先に破棄すること）
+    ~Subscription();
+
+    // 購読が有効か
+    explicit operator bool() const { return owner_ != nullptr; }
+
+    // 前回受け取ったデータを返却してから最大 maxWait だけ待ち、最大 maxItems 件のビューを out へ追加する
+    std::size_t read(std::vector<ItemView> &out, std::size_t maxItems, std::chrono::milliseconds maxWait);
+    // read で受け取ったデータを返却する（以降、受け取ったビューは参照できない）
+    void release();
+    // バッファが満杯のために読み飛ばされたデータの件数（Lossy のみ増える）
+    std::uint64_t dropped() const;
+
+private:
+    friend class GlobalBuffer;
+
+    // 購読をやめ、保持中のデータを返却する
+    void close() noexcept;
+
+    // 購読先のバッファ（無効時は nullptr）
+    GlobalBuffer *owner_{nullptr};
+    // バッファ内の購読者の番号
+    std::size_t index_{0};
+    // read で受け取り、まだ返却していない範囲 [begin, end)（メモリマップト利用時はバイト位置）
+    std::uint64_t begin_{0};
+    std::uint64_t end_{0};
+};
+
+// 消費者が取り出したデータを、バッファ内の領域を直接参照したまま保持する
+// 保持中の領域は release するか破棄するまで再利用されないため、処理を終えたら速やかに返却すること
+class ReadLease {
+public:
+    ReadLease() = default;
+    ReadLease(ReadLease &&other) noexcept;
+    ReadLease &operator=(ReadLease &&other) noexcept;
+    ReadLease(const ReadLease &) = delete;
+    ReadLease &operator=(const ReadLease &) = delete;
+    // 保持中のデータを返却する（バッファより先に破棄すること）
+    ~ReadLease();
+
+    // 保持中のデータのビュー（release まで有効）
+    const std::vector<ItemView> &items() const { return views_; }
+    std::vector<ItemView>::const_iterator begin() const { return views_.begin(); }
+    std::vector<ItemView>::const_iterator end() const { return views_.end(); }
+    std::size_t size() const { return views_.size(); }
+    bool empty() const { return views_.empty(); }
+    // 保持中のデータを返却する（以降、受け取ったビューは参照できない。lease は再び取り出しに使える）
+    void release();
+
+private:
+    friend class GlobalBuffer;
+
+    // 取り出し元のバッファ（何も保持していなければ nullptr）
+    GlobalBuffer *owner_{nullptr};
+    // 保持中のデータのビュー
+    std::vector<ItemView> views_;
+    // バッファ内で保持している範囲 [begin, end)（メモリマップト利用時はバイト位置）
+    std::uint64_t begin_{0};
+    std::uint64_t end_{0};
+    // lane・退避ファイルから取り出したデータ（バッファ内に留めておけないため、lease が所有してビューで参照させる）
+    std::vector<BufferItem> owned_;
+};
+
+// 占有率が高水位・低水位を跨いだときの通知先（true: 高水位に達した / false: 低水位まで下がった）
+// 投入・取り出しを行ったスレッドから呼ばれるため、フラグを立てる程度の短い処理にすること
+using PressureListener = std::function<void(bool pressured)>;
+
 // スレッド間で共有するリングバッファの実装
 class GlobalBuffer {
 public:
@@ -62,70 +376,380 @@ public:
 
     // 新しいデータをバッファに追加する（必要に応じて待機）
     void push(BufferItem item);
+    // 複数のデータをまとめて追加する（items は空になり、容量は呼び出し側で再利用できる）
+    void pushBatch(std::vector<BufferItem> &items);
     // データを 1 件取り出す（データが来るまで待機）
     std::optional<BufferItem> pop();
     // ノンブロッキングでデータを 1 件取り出す
     std::optional<BufferItem> tryPop();
+    // 最大 maxWait だけ待ち、その時点で溜まっているデータを最大 maxItems 件まとめて out へ追加する
+    std::size_t popBatch(std::vector<BufferItem> &out, std::size_t maxItems, std::chrono::milliseconds maxWait);
+
+    // 最大 size バイトの書き込み領域をバッファ内に直接確保する（満杯なら待機）
+    // メモリマップト利用時は maxPayloadSize に切り詰め、終了中は無効な予約を返す
+    // 未確定の予約は消費者を待たせるため、1 スレッドが同時に保持する予約は 1 つまでにすること
+    WriteReservation reserve(std::size_t size, SourceId source);
+    // 先頭データをコピーせずに参照する（最大 maxWait 待機）。参照後は必ず release する（lane・Spill 利用時は使えない）
+    std::optional<ItemView> peek(std::chrono::milliseconds maxWait);
+    // peek で参照したデータの領域を返却する
+    void release(const ItemView &view);
+    // lease が保持していたデータを返却してから最大 maxWait だけ待ち、最大 maxItems 件をコピーせずに lease へ保持させる
+    // メモリ上のセル・メモリマップトのレコードはバッファ内を直接参照し、lane・退避ファイルのデータは lease へ移して参照する
+    std::size_t lease(ReadLease &lease, std::size_t maxItems, std::chrono::milliseconds maxWait);
+
+    // 登録できる購読者の最大数
+    static constexpr std::size_t kMaxSinks = 8;
+    // 独自の読み出し位置を持つ購読者を登録する（データの投入が始まる前に呼ぶこと。lane・Spill 利用時は使えない）
+    // 各データの領域は、pop 等で取り出す消費者と全ての購読者が処理を終えてから再利用される
+    Subscription subscribe(SinkMode mode = SinkMode::Blocking);
+
+    // 同時に開ける lane の最大数
+    static constexpr std::size_t kMaxLanes = 64;
+    // 発生元 source 用の投入口を開く（セッション開始時に 1 度だけ呼ぶ）
+    ProducerLane openLane(SourceId source);
 
     // バッファの終了フラグを立て、待機スレッドを解除する
     void shutdown();
+    // バッファ全体で共通のレコード構成（出力側は開始時に参照して保持してよい）
+    const Schema &schema() const { return schema_; }
+    // 発生元の名前を登録して番号を返す（セッション開始時に 1 度だけ呼び、以降は番号でデータを渡す）
+    SourceId registerSource(std::string_view name);
+    // 発生元の番号に対応する名前（バッファの破棄まで有効）
+    std::string_view sourceName(SourceId id) const;
+    // 起動時にバックファイルから引き継いだ未消費データの件数（メモリ上で動作する場合は常に 0）
+    std::size_t recoveredCount() const;
+    // メモリマップトファイルの領域がどう確保されたか（呼び出し時点の常駐状況を含む）
+    MappingReport mappingReport() const;
+    // プロセス間で共有する場合に、このプロセスを消費者として登録する（取り出し時にも自動で行う）
+    // 他の動作中のプロセスが消費者なら例外。前の消費者が停止していれば、処理途中だったデータから読み出し直す
+    void acquireConsumer();
+    // 満杯時の扱いによって捨てた・退避したデータの件数
+    OverflowStats overflowStats() const;
+
+    // 占有率の通知先を登録し、解除用の番号を返す
+    std::size_t addPressureListener(PressureListener listener);
+    // 通知先の登録を解除する（戻った後は呼ばれない）
+    void removePressureListener(std::size_t id);
+    // 高水位に達してから低水位まで下がっていない状態か（退避中のデータがある間も含む）
+    bool underPressure() const { return pressured_.load(std::memory_order_acquire); }
+    // 現在の占有率（0.0〜1.0。lane 利用時は最も埋まっている lane の値、メモリマップト利用時はバイト数で求める）
+    // maxBytes を指定した場合は、件数とバイト数のうち高い方の値
+    double occupancy() const;
+    // 溜まっているペイロードの合計バイト数（メモリ上で maxBytes を指定した場合のみ数え、それ以外は 0）
+    std::size_t queuedBytes() const { return queuedBytes_.load(std::memory_order_relaxed); }
+    // 生産者・消費者の待機がどの段階で終わったかの集計
+    WaitStats waitStats() const;
+    // 受信時刻として使う現在時刻（全セッションで共通の時計から取り、プロセス内で減少しない）
+    std::chrono::system_clock::time_point now() { return clock_.now(); }
+    // 受信時刻を付ける時計（実際に使っている取得元の確認用）
+    const Clock &clock() const { return clock_; }
 
 private:
+    friend class WriteReservation;
+    friend class Subscription;
+    friend class ProducerLane;
+    friend class ReadLease;
+
     // 利用時のオプションを保持
     Options options_{};
     // 実際に格納できるアイテム数
     std::size_t capacity_{};
-    // BufferItem に反映するフィールド名のセット
-    FieldNames fieldNames_{};
+    // フィールド名と列構成（生成後は変更しない）
+    const Schema schema_;
+    // 受信時刻を付ける時計
+    Clock clock_;
+    // 発生元の名前と番号の対応（プロセス間で共有する場合は、他のプロセスが登録した番号を参照時に取り込む）
+    mutable SourceRegistry sources_;
 
-    // 排他制御用ミューテックス
-    std::mutex mutex_;
-    // push が可能になるまで待たせるための条件変数
-    std::condition_variable canPush_;
-    // pop が可能になるまで待たせるための条件変数
-    std::condition_variable canPop_;
     struct QueueEntry {
-        // メモリマップトファイル未使用時を表すスロット番号
-        static constexpr std::size_t kInvalidSlot = std::numeric_limits<std::size_t>::max();
         // アイテム本体（ソースやタイムスタンプなど）
         BufferItem item;
-        // 保持しているペイロードのサイズ
-        std::size_t payloadSize{0};
-        // メモリマップトファイル上のスロット番号
-        std::size_t slotIndex{kInvalidSlot};
+        // 取り消された予約で、消費者が読み飛ばすべきか
+        bool discarded{false};
+    };
+
+    // メモリマップト利用時のレコードリング（未使用時は nullptr で、セル配列を使う）
+    std::unique_ptr<RecordRing> ring_;
+
+    // リングの 1 セル。sequence が位置と一致すれば空き、位置 + 1 なら公開済みを表す
+    struct Cell {
+        std::atomic<std::size_t> sequence{0};
+        // 処理を終えていない読み手の数（0 になったセルから次周回の生産者へ返却する）
+        std::atomic<std::uint32_t> readers{1};
+        // バイト数の予算に計上したペイロードの大きさ（セルの返却時に予算へ戻す）
+        std::size_t bytes{0};
+        QueueEntry entry;
     };
 
-    // 実データを保持する待ち行列
-    std::deque<QueueEntry> queue_;
+    // 購読者ごとの読み出し状態
+    struct alignas(kCacheLineSize) SinkState {
+        // 次に読み出す位置（メモリマップト利用時はバイト位置）
+        std::atomic<std::uint64_t> cursor{0};
+        // 満杯時に生産者が読み飛ばさせてよいか（購読の終了後も true になる）
+        std::atomic<bool> lossy{false};
+        // 読み飛ばされたデータの件数
+        std::atomic<std::uint64_t> dropped{0};
+        // メモリマップト利用時、購読者自身と読み飛ばしを行う生産者の確保を直列化する
+        // （位置を固定している間は、その位置のレコードが回収されないことを保証できる）
+        mutable std::mutex claimMutex;
+    };
+
+    // 生産者・消費者のカーソルが同じキャッシュラインに載らないよう分離する
+    struct alignas(kCacheLineSize) Cursor {
+        std::atomic<std::size_t> value{0};
+    };
+
+    // 固定長のセル配列（メモリ上で動作する場合に容量分を一括確保）
+    std::unique_ptr<Cell[]> cells_;
+    // 次に生産者が確保する位置
+    Cursor enqueuePos_;
+    // 次に消費者が取り出す位置
+    Cursor dequeuePos_;
+    // 次に投入するデータの全体の通し番号（メモリマップト利用時はリングのファイル上で採番する）
+    alignas(kCacheLineSize) std::atomic<std::uint64_t> nextSequence_{0};
+    // 発生元ごとの次の通し番号（発生元番号で引く。メモリマップト利用時はリングのファイル上で採番する）
+    std::unique_ptr<std::atomic<std::uint64_t>[]> sourceSequences_;
+    // maxBytes の予算に計上済みのバイト数（生産者が確保時に加え、最後の読み手が返却時に戻す）
+    alignas(kCacheLineSize) std::atomic<std::size_t> queuedBytes_{0};
     // 終了状態を示すフラグ
-    bool shutdown_{false};
-
-    // メモリマップトファイルの 1 スロットあたりの確保バイト数
-    std::size_t slotSize_{0};
-    // 次に書き込むスロットのインデックス
-    std::size_t writeIndex_{0};
-
-    // メモリマップトファイルを初期化する
-    void initializeMapping();
-    // メモリマップトファイルを解放する
-    void releaseMapping();
-    // メモリマップトファイルからペイロードを復元する
-    BufferItem materializeEntry(QueueEntry entry) const;
-
-#ifdef _WIN32
-    void ensureFileSize(std::uint64_t size);
-    void openFileHandle();
-    void mapView(std::uint64_t size);
-    void closeFileHandle();
-    void closeMappingHandle();
-    void unmapView();
-    void *mappingHandle_{nullptr};
-    void *fileHandle_{reinterpret_cast<void *>(-1)};
-#else
-    int fileDescriptor_{-1};
-#endif
-    std::uint8_t *mappedView_{nullptr};
-    std::size_t mappedSize_{0};
+    alignas(kCacheLineSize) std::atomic<bool> shutdown_{false};
+
+    // 1 生産者専用のリング。生産者は tail だけ、消費者は head だけを更新する
+    struct Lane {
+        // 容量分のアイテム（予約時はここへ直接書き込む）
+        std::unique_ptr<BufferItem[]> items;
+        // 生産者が次に書き込む位置
+        alignas(kCacheLineSize) std::atomic<std::size_t> tail{0};
+        // 生産者が最後に読んだ head（満杯に近づくまで消費者側のキャッシュラインを読まずに済ませる）
+        std::size_t cachedHead{0};
+        // 消費者が次に取り出す位置
+        alignas(kCacheLineSize) std::atomic<std::size_t> head{0};
+        // 消費者が最後に読んだ tail
+        std::size_t cachedTail{0};
+        // 投入口が開いているか（閉じた lane は空になってから別の投入口へ再利用する）
+        std::atomic<bool> open{false};
+    };
+
+    // lane の一覧（先頭 laneCount_ 件が作成済みで、作成後は破棄しない）
+    std::array<std::unique_ptr<Lane>, kMaxLanes> lanes_;
+    std::atomic<std::size_t> laneCount_{0};
+    // lane の割り当てを直列化するミューテックス
+    std::mutex laneMutex_;
+    // lane からの取り出しを 1 スレッドずつに制限するミューテックス
+    std::mutex laneConsumerMutex_;
+    // ラウンドロビンで次に取り出す入力（laneConsumerMutex_ で保護）
+    std::size_t nextInput_{0};
+
+    // 購読者の読み出し状態（先頭 sinkCount_ 件が登録済み）
+    std::array<SinkState, kMaxSinks> sinks_;
+    std::atomic<std::size_t> sinkCount_{0};
+    // 各データを処理する読み手の数（消費者 1 + 購読者数。投入開始後は変更しない）
+    std::uint32_t readers_{1};
+    // 生産者が最初の領域を確保したか（以降は購読者を登録できない）
+    std::atomic<bool> started_{false};
+    // 購読者の登録と投入開始を直列化するミューテックス
+    std::mutex sinkMutex_;
+
+    // 退避ファイル（最初の退避時に作成する）
+    std::unique_ptr<SpillFile> spill_;
+    // 退避ファイルの読み書きを直列化するミューテックス
+    std::mutex spillMutex_;
+    // 退避ファイルに未読のデータがあるか（この間の投入は順序を保つため全て退避する）
+    std::atomic<bool> spilling_{false};
+    // メモリマップトで DropOldest を使う場合、消費者と最古のレコードを捨てる生産者の確保を直列化する
+    mutable std::mutex readMutex_;
+    // 満杯時の扱いの集計
+    std::atomic<std::uint64_t> droppedNewest_{0};
+    std::atomic<std::uint64_t> droppedOldest_{0};
+    std::atomic<std::uint64_t> timedOut_{0};
+    std::atomic<std::uint64_t> spilled_{0};
+    std::atomic<std::uint64_t> restored_{0};
+
+    // 満杯・空のときだけ利用する待機用ミューテックス
+    std::mutex waitMutex_;
+    // push が可能になるまで待たせるための条件変数
+    std::condition_variable canPush_;
+    // pop が可能になるまで待たせるための条件変数
+    std::condition_variable canPop_;
+    // 占有率の高水位・低水位（アイテム数、メモリマップト利用時はバイト数。高水位が 0 なら通知しない）
+    std::uint64_t highMark_{0};
+    std::uint64_t lowMark_{0};
+    // 生産者が占有率を確認する間隔（投入位置がこの境界を跨いだときだけ確認する）
+    std::uint64_t pressureStride_{1};
+    // maxBytes を指定した場合のバイト数での高水位・低水位と確認間隔（高水位が 0 ならバイト数では判定しない）
+    std::size_t byteHighMark_{0};
+    std::size_t byteLowMark_{0};
+    std::size_t byteStride_{1};
+    // 高水位を通知済みで、低水位まで下がっていないか
+    std::atomic<bool> pressured_{false};
+    // 通知先の一覧と、登録・通知を直列化するミューテックス
+    std::vector<std::pair<std::size_t, PressureListener>> pressureListeners_;
+    std::size_t nextListenerId_{1};
+    std::mutex pressureMutex_;
+
+    // 待機の段階ごとの集計
+    std::atomic<std::uint64_t> spinHits_{0};
+    std::atomic<std::uint64_t> yieldHits_{0};
+    std::atomic<std::uint64_t> parks_{0};
+    // canPush_ で待機中の生産者数（0 のときは通知を省略する）
+    alignas(kCacheLineSize) std::atomic<std::size_t> pushWaiters_{0};
+    // canPop_ で待機中の消費者数（0 のときは通知を省略する）
+    std::atomic<std::size_t> popWaiters_{0};
+
+    // 投入前にアイテムを検証する
+    void validateItem(const BufferItem &item) const;
+    // 全体の通し番号を count 件分進め、先頭の番号を返す
+    std::uint64_t nextSequence(std::uint64_t count);
+    // 発生元 source の通し番号を count 件分進め、先頭の番号を返す
+    std::uint64_t nextSourceSequence(SourceId source, std::uint64_t count);
+    // 検証済みのアイテムへ通し番号を振る（領域の確保より前に振り、満杯で捨てたデータも抜けとして残す）
+    void stamp(BufferItem &item);
+    void stamp(std::vector<BufferItem> &items);
+    // 消費者がまだ処理していないデータ量（アイテム数、メモリマップト利用時はバイト数）
+    std::uint64_t occupied() const;
+    // 消費者と Blocking の購読者のうち、最も遅い読み手の位置（共有リング）
+    std::uint64_t slowestReader() const;
+    // 生産者が [begin, end) を投入した後に、高水位に達していれば通知する
+    void checkHighWatermark(std::uint64_t begin, std::uint64_t end);
+    // lane へ end まで投入した後に、その lane が高水位に達していれば通知する
+    void checkLaneHighWatermark(Lane &lane, std::size_t end);
+    // 予算の使用量が before から after へ増えた後に、バイト数の高水位に達していれば通知する
+    void checkByteHighWatermark(std::size_t before, std::size_t after);
+    // 消費者が取り出した後に、低水位まで下がっていれば通知する
+    void checkLowWatermark();
+    // 高水位・低水位の状態を切り替えて通知先へ知らせる
+    void setPressure(bool pressured);
+
+    // 満杯時の扱いに従って ready になるまで待機する（待たずに諦める場合や期限切れなら false）
+    // deadline は初回の待機時に決めるため、呼び出し側は最初に time_point::max() を渡す
+    template <typename Predicate>
+    bool awaitSpace(Predicate ready, std::chrono::steady_clock::time_point &deadline);
+    // 満杯などで確保できなかったアイテムを満杯時の扱いに従って捨てるか退避する（終了中は黙って捨てる）
+    void overflow(const BufferItem &item);
+    // 満杯時の扱いに従う予約として、バッファ外の一時領域を渡す（終了中は無効な予約）
+    WriteReservation overflowReservation(std::size_t size, SourceId source);
+    // アイテムを退避ファイルへ書き出す
+    void spill(const BufferItem &item);
+    // 退避ファイルから最大 maxItems 件を sink へ渡す（全て渡し終えたら退避を終える）
+    template <typename Sink>
+    std::size_t restoreSpilled(std::size_t maxItems, Sink &sink);
+    // 消費者が取り出していない最古のセル oldest を捨てる（捨てたら true）
+    bool evictOldestCell(std::size_t oldest);
+    // 消費者が取り出していない最古のレコードを捨てる（捨てたら true）
+    bool evictOldestRecord();
+    // 消費者としてレコードを確保する（DropOldest では捨てる側の生産者と直列化する）
+    std::size_t claimRecords(std::size_t maxRecords, std::uint64_t &begin, std::uint64_t &end);
+
+    // 先頭から sizeOf(i) バイトのアイテムを入れるため、空きセルを最大 count 個連続で確保する
+    // セル数とバイト数の予算のどちらかが満杯なら満杯時の扱いに従い、確保できなければ 0
+    template <typename SizeOf>
+    std::size_t claimCells(std::size_t count, SizeOf sizeOf, std::size_t &position);
+    // 待機せずに空きセルの連続確保を試みる
+    std::size_t tryClaimCells(std::size_t count, std::size_t &position);
+    // 確保済みセルへアイテムを書き込んで公開する
+    void publishCell(std::size_t position, BufferItem item);
+    // 公開済みのセルを最大 count 個連続で確保する（空なら 0）
+    std::size_t tryClaimPublished(std::size_t count, std::size_t &position);
+    // 確保済みセルからアイテムを取り出し、セルを返却する
+    BufferItem takeCell(std::size_t position);
+    // 取り消された予約のセルか
+    bool isDiscarded(std::size_t position) const;
+    // 予約した領域へ書き込まれたデータを公開する
+    void commitReservation(WriteReservation &reservation, std::size_t length);
+    // 予約した領域を読み飛ばし対象として公開する
+    void abortReservation(WriteReservation &reservation);
+    // 先頭から sizeOf(i) バイトのアイテムのうち、予算に収まる件数分のバイト数を待機せずに確保する
+    // 確保した件数を返し、合計バイト数を bytes に設定する（maxBytes 未指定なら count 件をそのまま返す）
+    template <typename SizeOf>
+    std::size_t tryClaimBytes(std::size_t count, SizeOf sizeOf, std::size_t &bytes);
+    // 確保したバイト数を予算へ戻す
+    void releaseBytes(std::size_t bytes);
+    // size バイトのアイテムを予算に入れられるか（空のときは上限を超える 1 件も受け入れる）
+    bool hasByteRoom(std::size_t size) const;
+    // 予算を使い切っているときに、読み飛ばせる購読者や DropOldest で最古のデータを捨てて空ける（空けたら true）
+    bool evictForBytes();
+    // 消費者と Blocking の購読者より遅れ、予算を単独で保持している Lossy の購読者がいるか
+    bool hasLaggingSink() const;
+    // 取り出し済みのセルを次周回の生産者へ返却する
+    void releaseCell(std::size_t position);
+    // 生産者が確保できる空きセルがあるか
+    bool hasFreeCell() const;
+    // 消費者が取り出せる公開済みセルがあるか
+    bool hasPublishedCell() const;
+
+    // length バイトのレコードをリング上に確保する（満杯なら満杯時の扱いに従い、確保できなければ false）
+    bool claimRecord(std::size_t length, std::uint64_t &position);
+    // 確保済みレコードへアイテムを書き込んで公開する
+    void publishRecord(std::uint64_t position, const BufferItem &item);
+    // レコードの内容から BufferItem を復元する
+    BufferItem readRecord(std::uint64_t position) const;
+
+    // 最初の投入時に購読者の登録を締め切る
+    void markStarted();
+    // アイテムの内容を参照するビューを作る
+    static ItemView viewItem(const BufferItem &item, std::uint64_t position);
+    // 指定セルの内容を参照するビューを作る
+    ItemView viewCell(std::size_t position) const;
+    // 指定レコードの内容を参照するビューを作る
+    ItemView viewRecord(std::uint64_t position) const;
+    // 読み手の 1 つとして範囲 [begin, end) のデータを返却する（待機中の生産者は呼び出し側で起こす）
+    void releaseRange(std::uint64_t begin, std::uint64_t end);
+    // 購読者が読み出せるデータを最大 maxItems 件 out へ追加し、確保した範囲を返す（空なら 0）
+    std::size_t tryReadSink(SinkState &sink, std::size_t maxItems, std::vector<ItemView> &out, std::uint64_t &begin,
+                            std::uint64_t &end);
+    // 購読者が読み出せるデータがあるか（読み飛ばし対象を含む）
+    bool hasSinkReadable(const SinkState &sink) const;
+    // oldest の位置を未読のまま保持している Lossy の購読者を 1 件分進める（進めたら true）
+    bool evictLossySinks(std::uint64_t oldest);
+    // 生産者が読み飛ばさせることで空きを作れる購読者がいるか
+    bool hasEvictableSink() const;
+    // Subscription の各操作の実体
+    std::size_t readSink(Subscription &subscription, std::vector<ItemView> &out, std::size_t maxItems,
+                         std::chrono::milliseconds maxWait);
+    void releaseSink(Subscription &subscription);
+    void closeSink(Subscription &subscription) noexcept;
+    std::uint64_t sinkDropped(std::size_t index) const;
+    // ReadLease の各操作の実体（tryLease は取り出せるデータが無ければ 0）
+    std::size_t tryLease(ReadLease &lease, std::size_t maxItems);
+    void releaseLease(ReadLease &lease);
+
+    // lane の空きを先頭から sizeOf(i) バイトのアイテム最大 count 個分確保する
+    // lane とバイト数の予算のどちらかが満杯なら満杯時の扱いに従い、確保できなければ 0
+    template <typename SizeOf>
+    std::size_t claimLaneSlots(Lane &lane, std::size_t count, SizeOf sizeOf, std::size_t &position);
+    // 消費者に代わって lane の先頭を捨てる（消費者が取り出し中か、lane が空なら false）
+    bool evictLaneHead(Lane &lane, std::size_t tail);
+    // 投入口の各操作の実体
+    void lanePush(const ProducerLane &producer, BufferItem item);
+    void lanePushBatch(const ProducerLane &producer, std::vector<BufferItem> &items);
+    WriteReservation laneReserve(const ProducerLane &producer, std::size_t size);
+    void closeLane(ProducerLane &producer) noexcept;
+    // 各 lane と共有リングから取り出し順序に従って最大 maxItems 件 sink へ渡す（空なら 0）
+    template <typename Sink>
+    std::size_t tryDrainLanes(std::size_t maxItems, Sink sink);
+    // 入力（lane 番号、または末尾の番号で共有リング）の先頭アイテム（空なら nullptr）
+    const BufferItem *peekInput(std::size_t input, std::size_t inputs);
+    // 入力の先頭アイテムを取り出して sink へ渡す（空なら false）
+    template <typename Sink>
+    bool takeInput(std::size_t input, std::size_t inputs, Sink &sink);
+
+    // 消費者が取り出せるデータがあるか（読み飛ばし対象・退避中のデータを含む）
+    bool hasReadable() const;
+    // バッファ内に消費者が取り出せるデータがあるか（読み飛ばし対象を含み、退避中のデータは含まない）
+    bool hasQueued() const;
+    // 取り出せるデータを最大 maxItems 件 sink へ渡す（読み飛ばし対象は除き、空なら 0）
+    template <typename Sink>
+    std::size_t tryDrain(std::size_t maxItems, Sink sink);
+    // 条件が満たされるか終了・期限切れになるまで、waitStrategy に従って待機する（期限切れなら false）
+    template <typename Predicate>
+    bool park(std::condition_variable &condition, std::atomic<std::size_t> &waiters, Predicate ready,
+              std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+    // 待機者がいる場合のみ条件変数へ通知する
+    void wake(std::condition_variable &condition, const std::atomic<std::size_t> &waiters, bool all);
+    // プロセス間で共有する場合の park。停止したプロセスを片付けるため、一定時間ごとに起きて条件を確認し直す
+    template <typename Predicate>
+    bool parkShared(bool popSide, Predicate ready, std::chrono::steady_clock::time_point deadline);
+
 };
 
 } // namespace global_buffer
@@ -133,7 +757,28 @@ private:
 // フレームワーク内部からの呼び出し互換性を維持するための別名定義
 namespace framework4cpp {
 using BufferItem = ::global_buffer::BufferItem;
+using SourceId = ::global_buffer::SourceId;
+using Schema = ::global_buffer::Schema;
+using Column = ::global_buffer::Column;
+using Payload = ::global_buffer::Payload;
 using GlobalBuffer = ::global_buffer::GlobalBuffer;
+using SinkMode = ::global_buffer::SinkMode;
+using Subscription = ::global_buffer::Subscription;
+using ReadLease = ::global_buffer::ReadLease;
+using ItemView = ::global_buffer::ItemView;
+using ProducerLane = ::global_buffer::ProducerLane;
+using LaneOrder = ::global_buffer::LaneOrder;
+using OverflowPolicy = ::global_buffer::OverflowPolicy;
+using OverflowStats = ::global_buffer::OverflowStats;
+using WaitStrategy = ::global_buffer::WaitStrategy;
+using WaitStats = ::global_buffer::WaitStats;
+using MappingReport = ::global_buffer::MappingReport;
+using ClockSource = ::global_buffer::ClockSource;
+using Clock = ::global_buffer::Clock;
+using GapDetector = ::global_buffer::GapDetector;
+using SequenceGap = ::global_buffer::SequenceGap;
+using SourceGapStats = ::global_buffer::SourceGapStats;
+using PressureListener = ::global_buffer::PressureListener;
 using GlobalBufferOptions = ::global_buffer::Options;
 } // namespace framework4cpp
 
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace framework4cpp {
+
+// バイト列を 16 進文字列にするときの並べ方
+enum class HexLayout {
+    // "0a 1b 2c"（バイトごとに空白で区切る）
+    Spaced,
+    // "0a1b2c"（区切らない）
+    Packed
+};
+
+// 16 進変換の実装
+enum class HexKernel {
+    // 表を引いて 1 バイトずつ変換する（どの CPU でも使える）
+    Scalar,
+    // SSSE3 で 16 バイトずつ変換する
+    Ssse3,
+    // AVX2 で 32 バイトずつ変換する（Spaced は SSSE3 と同じ）
+    Avx2
+};
+
+// size バイトを layout で変換したときの文字数
+constexpr std::size_t hexEncodedSize(std::size_t size, HexLayout layout) {
+    if (size == 0) {
+        return 0;
+    }
+    return layout == HexLayout::Spaced ? size * 3 - 1 : size * 2;
+}
+
+// data の size バイトを小文字の 16 進文字列として out へ書き込み、書き込んだ文字数を返す
+// out には hexEncodedSize(size, layout) 文字分の領域が必要（終端の '\0' は書き込まない）
+// 初回呼び出し時に CPU を判定し、SSSE3 が使えれば 16 バイトずつ（AVX2 も使えれば Packed は 32 バイトずつ）変換する
+std::size_t encodeHex(const std::uint8_t *data, std::size_t size, char *out, HexLayout layout);
+
+// encodeHex が使っている実装の名前（"avx2" / "ssse3" / "scalar"）
+const char *hexEncoderName();
+// encodeHex が 16 バイト以上のデータに使う実装
+HexKernel selectedHexKernel();
+// 実行中の CPU で kernel を使えるか（Scalar は常に使える）
+bool hexKernelAvailable(HexKernel kernel);
+// 実装を kernel に固定して encodeHex と同じ変換を行う（実装どうしの比較用。使えない実装を指定すると例外を投げる）
+std::size_t encodeHexWith(HexKernel kernel, const std::uint8_t *data, std::size_t size, char *out, HexLayout layout);
+
+} // namespace framework4cpp
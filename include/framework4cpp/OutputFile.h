@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace framework4cpp {
+
+// 追記専用の出力ファイル（ストリームを介さず OS のファイルへ直接書き込む。1 つのスレッドから使う）
+class OutputFile {
+public:
+    OutputFile() = default;
+    ~OutputFile();
+
+    OutputFile(const OutputFile &) = delete;
+    OutputFile &operator=(const OutputFile &) = delete;
+
+    // path を追記モードで開く（開けなければ例外を投げる）
+    // preallocateBytes が 0 以外なら、書き込む前にファイル末尾の先をその単位で確保しておく（ファイルの長さは変えない）
+    void open(const std::string &path, std::size_t preallocateBytes);
+    bool isOpen() const;
+    // data の size バイトをすべて書き込む（途中で書き込めなくなれば例外を投げる）
+    void write(const char *data, std::size_t size);
+    // 書き込んだ内容をストレージまで書き出す（失敗すれば例外を投げる）
+    void sync();
+    void close();
+
+private:
+    // これから size バイト書き込む領域が確保済みでなければ確保する（対応しない環境では確保をやめる）
+    void reserve(std::size_t size);
+
+    std::string path_;
+    std::size_t preallocateBytes_{0};
+    // 書き込み済みの末尾と、確保済みの領域の終わり（ファイル先頭からのバイト数）
+    std::uint64_t end_{0};
+    std::uint64_t allocatedEnd_{0};
+#ifdef _WIN32
+    void *handle_{reinterpret_cast<void *>(-1)};
+#else
+    int fileDescriptor_{-1};
+#endif
+};
+
+} // namespace framework4cpp
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+
+// ペイロードを BufferItem 内へ直接格納できる最大バイト数（ビルド時に -D で変更できる）
+#ifndef FRAMEWORK4CPP_PAYLOAD_INLINE_CAPACITY
+#define FRAMEWORK4CPP_PAYLOAD_INLINE_CAPACITY 64
+#endif
+
+namespace global_buffer {
+
+// 小さなデータは内部の領域に保持し、それを超えた場合だけ PayloadPool から領域を得るバイト列
+class Payload {
+public:
+    // 内部に保持できる最大バイト数
+    static constexpr std::size_t kInlineCapacity = FRAMEWORK4CPP_PAYLOAD_INLINE_CAPACITY;
+    static_assert(kInlineCapacity > 0, "Payload inline capacity must be greater than zero");
+
+    using value_type = std::uint8_t;
+    using iterator = std::uint8_t *;
+    using const_iterator = const std::uint8_t *;
+
+    Payload() noexcept = default;
+    Payload(const std::uint8_t *data, std::size_t size);
+    Payload(std::initializer_list<std::uint8_t> bytes);
+    Payload(const Payload &other);
+    Payload(Payload &&other) noexcept;
+    Payload &operator=(const Payload &other);
+    Payload &operator=(Payload &&other) noexcept;
+    ~Payload();
+
+    // 読み取り用のアクセス（span と同様に先頭ポインタとバイト数で扱う）
+    const std::uint8_t *data() const noexcept { return data_; }
+    std::uint8_t *data() noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    const_iterator begin() const noexcept { return data_; }
+    const_iterator end() const noexcept { return data_ + size_; }
+    iterator begin() noexcept { return data_; }
+    iterator end() noexcept { return data_ + size_; }
+    std::uint8_t operator[](std::size_t index) const noexcept { return data_[index]; }
+    std::uint8_t &operator[](std::size_t index) noexcept { return data_[index]; }
+
+    // 現在の領域に格納できるバイト数
+    std::size_t capacity() const noexcept { return capacity_; }
+    // 内部の領域にデータを保持しているか
+    bool isInline() const noexcept { return data_ == inline_; }
+
+    // data から size バイトをコピーして内容を置き換える
+    void assign(const std::uint8_t *data, std::size_t size);
+    // count バイトを value で埋める
+    void assign(std::size_t count, std::uint8_t value);
+    // 前方反復子の範囲で内容を置き換える（整数 2 つの呼び出しは上の count/value 版を使う）
+    template <typename ForwardIt, typename = std::enable_if_t<!std::is_integral_v<ForwardIt>>>
+    void assign(ForwardIt first, ForwardIt last);
+    // サイズを変更する（増えた部分は 0 で埋める）
+    void resize(std::size_t size);
+    // サイズを変更する（増えた部分は初期化せず、呼び出し側が直後に上書きする）
+    void resizeForOverwrite(std::size_t size);
+    // 内容を空にする（確保済みの領域は保持する）
+    void clear() noexcept { size_ = 0; }
+
+private:
+    // capacity 以上の領域を確保し、既存の内容を preserve バイトだけ引き継ぐ
+    void grow(std::size_t capacity, std::size_t preserve);
+    // プールから得た領域を返却して内部の領域へ戻す
+    void releaseHeap() noexcept;
+
+    // 現在の格納先（内部の領域かプールから得た領域）
+    std::uint8_t *data_{inline_};
+    std::size_t size_{0};
+    std::size_t capacity_{kInlineCapacity};
+    // 小さなデータを保持する内部の領域
+    std::uint8_t inline_[kInlineCapacity];
+};
+
+template <typename ForwardIt, typename>
+void Payload::assign(ForwardIt first, ForwardIt last) {
+    std::size_t count = static_cast<std::size_t>(std::distance(first, last));
+    resizeForOverwrite(count);
+    std::uint8_t *out = data_;
+    for (; first != last; ++first) {
+        *out++ = static_cast<std::uint8_t>(*first);
+    }
+}
+
+} // namespace global_buffer
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace global_buffer {
+
+// ペイロード用プールの利用状況
+struct PayloadPoolStats {
+    // 確保要求の回数
+    std::uint64_t allocations{0};
+    // 呼び出しスレッドのキャッシュから払い出した回数
+    std::uint64_t threadCacheHits{0};
+    // 共有フリーリストから払い出した回数
+    std::uint64_t sharedHits{0};
+    // ヒープから新たに確保した回数（サイズ区分を超える確保を含む）
+    std::uint64_t heapAllocations{0};
+    // 返却の回数
+    std::uint64_t releases{0};
+    // 共有フリーリストが保持しているバイト数
+    std::uint64_t sharedBytes{0};
+};
+
+// ペイロード領域をサイズ区分ごとに再利用するスレッドセーフなプール
+// 各スレッドは小さなキャッシュを持ち、溢れた分や不足分だけを共有フリーリストとやり取りする
+class PayloadPool {
+public:
+    // 最小のサイズ区分（バイト）
+    static constexpr std::size_t kMinBlockSize = 64;
+    // サイズ区分の数（64 バイトから 2 倍刻みで 64 KiB まで）
+    static constexpr std::size_t kClassCount = 11;
+    // プールで扱う最大のブロックサイズ（これを超える確保はヒープへ直接委ねる）
+    static constexpr std::size_t kMaxBlockSize = kMinBlockSize << (kClassCount - 1);
+    // スレッドキャッシュが 1 区分あたりに保持するブロック数
+    static constexpr std::size_t kThreadCacheBlocks = 32;
+    // 共有フリーリストが 1 区分あたりに保持する上限バイト数
+    static constexpr std::size_t kSharedBytesPerClass = 4 * 1024 * 1024;
+
+    // プロセス全体で共有するプール（終了時も破棄しない）
+    static PayloadPool &instance();
+
+    PayloadPool(const PayloadPool &) = delete;
+    PayloadPool &operator=(const PayloadPool &) = delete;
+
+    // size バイト以上のブロックを払い出す
+    void *allocate(std::size_t size);
+    // allocate で得たブロックを同じ size で返却する
+    void deallocate(void *block, std::size_t size) noexcept;
+    // size バイトの確保で実際に払い出されるブロックのサイズ
+    static std::size_t roundUp(std::size_t size);
+    // 現在の利用状況
+    PayloadPoolStats stats() const;
+    // 共有フリーリストに保持しているブロックをヒープへ返す
+    void trim();
+
+private:
+    struct ThreadCache;
+
+    // 1 サイズ区分の共有フリーリスト
+    struct alignas(64) FreeList {
+        std::mutex mutex;
+        std::vector<void *> blocks;
+    };
+
+    PayloadPool() = default;
+
+    // 呼び出しスレッドのキャッシュ
+    static ThreadCache &localCache();
+    // size を収められる最小のサイズ区分（区分を超える場合は kClassCount）
+    static std::size_t classIndex(std::size_t size);
+    // サイズ区分のブロックサイズ
+    static std::size_t blockSize(std::size_t index) { return kMinBlockSize << index; }
+    // 共有フリーリストから最大 count 個をスレッドキャッシュへ移す
+    std::size_t takeShared(std::size_t index, void **out, std::size_t count);
+    // スレッドキャッシュから溢れたブロックを共有フリーリストへ戻す（上限を超えた分はヒープへ返す）
+    void giveShared(std::size_t index, void *const *blocks, std::size_t count) noexcept;
+
+    std::array<FreeList, kClassCount> freeLists_;
+
+    // 利用状況のカウンタ（統計用のため relaxed で更新する）
+    alignas(64) std::atomic<std::uint64_t> allocations_{0};
+    std::atomic<std::uint64_t> threadCacheHits_{0};
+    std::atomic<std::uint64_t> sharedHits_{0};
+    std::atomic<std::uint64_t> heapAllocations_{0};
+    std::atomic<std::uint64_t> releases_{0};
+    std::atomic<std::uint64_t> sharedBytes_{0};
+};
+
+// 確保と解放を PayloadPool へ委ねるアロケータ
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t count) {
+        return static_cast<T *>(PayloadPool::instance().allocate(count * sizeof(T)));
+    }
+    void deallocate(T *pointer, std::size_t count) noexcept {
+        PayloadPool::instance().deallocate(pointer, count * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U> &) const noexcept {
+        return true;
+    }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U> &) const noexcept {
+        return false;
+    }
+};
+
+} // namespace global_buffer
@@ -0,0 +1,373 @@
+#pragma once
+
+#include "framework4cpp/GlobalBuffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace global_buffer {
+
+// メモリマップトファイル上の 1 レコードの先頭に置くヘッダ（8 バイト境界に配置）
+struct RecordHeader {
+    // レコードの状態（RecordRing::State のいずれか）
+    std::atomic<std::uint32_t> state;
+    // ヘッダと本体を含むレコード全体のバイト数（8 バイト単位。読み手が回収と競合して読むことがあるため atomic）
+    std::atomic<std::uint32_t> length;
+    // 投入時に振られる全体の通し番号（ファイル内で永続化され、再起動後も続きから採番する）
+    std::uint64_t sequence;
+    // 投入時に振られる発生元ごとの通し番号（同じくファイル内で永続化する）
+    std::uint64_t sourceSequence;
+    // 受信時刻（system_clock のエポックからのナノ秒）
+    std::int64_t timestamp;
+    // 発生元の番号（名前はファイル内の発生元一覧に保存する）
+    std::uint32_t sourceId;
+    // ヘッダ直後に置くペイロードのバイト数
+    std::uint32_t payloadSize;
+    // length 以降のヘッダ項目とペイロードの CRC-32（復旧時に書きかけのレコードを検出する）
+    std::uint32_t checksum;
+    // 処理を終えていない読み手の数（0 になったレコードから再利用される）
+    std::atomic<std::uint32_t> readers;
+    // 共有時、レコードを確保した生産者のプロセス ID（確保したまま停止したかの判定に使う。非共有時は 0）
+    std::atomic<std::uint32_t> owner;
+    // 8 バイト境界へ揃えるための予約領域
+    std::uint32_t reserved;
+};
+
+// RecordRing のマップ時に行う準備
+struct MapSettings {
+    // 全ページを事前に割り当てる（MAP_POPULATE に加え、各ページへ書き込んで書き込み時のフォールトも済ませる）
+    bool prefault{false};
+    // マップ全体をメモリに固定する
+    bool lock{false};
+    // 透過的 huge page の利用を助言する
+    bool hugePages{false};
+    // 他のプロセスと同じリングを共有する（参加プロセスの登録と、停止したプロセスの後始末を行う）
+    bool shared{false};
+};
+
+// 長さ付きレコードを詰めて格納する、バイト単位のリング（メモリマップトファイル上に構築）
+class RecordRing {
+public:
+    // レコードの状態。空き領域は常に 0 で埋めておき、kEmpty を「未書き込み」として扱う
+    enum State : std::uint32_t {
+        kEmpty = 0,
+        // 生産者が書き込みを終えて公開したデータ
+        kCommitted = 1,
+        // 取り消された予約（消費者は読み飛ばす）
+        kDiscarded = 2,
+        // リング終端の余りを埋めるラップマーカー（消費者は読み飛ばす）
+        kPadding = 3,
+        // 消費者が処理を終え、再利用を待っている
+        kReleased = 4
+    };
+
+    // レコードの配置単位
+    static constexpr std::size_t kAlignment = 8;
+
+    // バックファイルの形式を識別する値とバージョン
+    static constexpr std::uint64_t kMagic = 0x474E495244524346ULL; // "FCRDRING"
+    static constexpr std::uint32_t kVersion = 6;
+    // 共有時に同じリングを開いていられるプロセスの最大数
+    static constexpr std::size_t kMaxParticipants = 64;
+    // 共有時に 1 つのプロセス内で同時に確保を進められるスレッドの最大数（超えた分は枠が空くまで待つ）
+    static constexpr std::size_t kMaxClaims = 16;
+
+    // バックファイルを開き、dataBytes バイトのデータ領域を持つリングとしてマップする
+    // recoverExisting が true で、同じ形式・サイズのファイルが残っていれば未消費のレコードを引き継ぐ
+    // settings.shared が true で、既に動作中のプロセスがリングを開いていれば、初期化も復旧もせずに参加する
+    RecordRing(const std::string &path, std::size_t dataBytes, bool recoverExisting = false,
+               const MapSettings &settings = MapSettings{});
+    ~RecordRing();
+    RecordRing(const RecordRing &) = delete;
+    RecordRing &operator=(const RecordRing &) = delete;
+
+    // ペイロードのサイズから、レコード全体の長さを求める
+    static std::size_t recordLength(std::size_t payloadSize);
+    // データ領域のバイト数
+    std::size_t dataBytes() const { return dataBytes_; }
+    // 格納できる最大のレコード長（ラップ時の余りを含めても必ず確保できる長さ）
+    std::size_t maxRecordLength() const { return dataBytes_ / 2; }
+    // 起動時にファイルから引き継いだ未消費のレコード数
+    std::size_t recoveredRecords() const { return recoveredRecords_; }
+    // マップの準備結果に、呼び出し時点の常駐状況を加えたもの
+    MappingReport mappingReport() const;
+    // 各レコードを処理する読み手の数（公開時にレコードへ設定する。既定は 1）
+    void setReaders(std::uint32_t readers) { readers_ = readers; }
+    // 再利用を待っている最古のレコード位置
+    std::uint64_t head() const { return control_->head.load(std::memory_order_acquire); }
+    // 生産者が次に確保する位置
+    std::uint64_t tail() const { return control_->tail.load(std::memory_order_acquire); }
+    // 消費者が次に確保する位置
+    std::uint64_t readCursor() const { return control_->readCursor.load(std::memory_order_acquire); }
+
+    // length バイトのレコード領域を確保する（空きが無ければ false）
+    bool tryClaim(std::size_t length, std::uint64_t &position);
+    // 現時点で length バイトのレコードを確保できるか
+    bool canClaim(std::size_t length) const;
+    // 確保したレコードを newLength へ縮める（後続の確保が無ければ余りをリングへ返す）
+    void shrink(std::uint64_t position, std::size_t newLength);
+    // 書き込み済みのレコードにチェックサムを付け、消費者へ公開する
+    void commit(std::uint64_t position);
+    // 全体の通し番号を count 件分進め、先頭の番号を返す（共有時は全プロセスで共通）
+    std::uint64_t nextSequence(std::uint64_t count) {
+        return control_->sequence.fetch_add(count, std::memory_order_relaxed);
+    }
+    // 発生元 id の通し番号を count 件分進め、先頭の番号を返す（共有時は全プロセスで共通）
+    std::uint64_t nextSourceSequence(std::uint32_t id, std::uint64_t count) {
+        return sourceSequences_[id].fetch_add(count, std::memory_order_relaxed);
+    }
+    // 確保したレコードを読み飛ばし対象として公開する
+    void discard(std::uint64_t position);
+
+    // 公開済みのデータレコードを最大 maxRecords 件含む範囲 [begin, end) を確保する
+    // 読み飛ばし対象のレコードも範囲に含まれ、戻り値はデータレコードの件数
+    std::size_t tryClaimRead(std::size_t maxRecords, std::uint64_t &begin, std::uint64_t &end);
+    // 独自のカーソルを持つ読み手が、同様に範囲 [begin, end) を確保する
+    std::size_t tryClaimRead(std::atomic<std::uint64_t> &cursor, std::size_t maxRecords, std::uint64_t &begin,
+                             std::uint64_t &end);
+    // 消費者が確保できるレコード（読み飛ばし対象を含む）があるか
+    bool hasReadable() const;
+    // 独自のカーソルを持つ読み手が確保できるレコードがあるか
+    bool hasReadable(const std::atomic<std::uint64_t> &cursor) const;
+    // 読み手の 1 つがレコードを処理済みにする（全員が終えたら領域を reclaim で再利用できる）
+    void release(std::uint64_t position);
+    // 先頭から連続する処理済みレコードを 0 クリアし、生産者が再利用できるようにする
+    void reclaim();
+
+    // 共有時、このプロセスを唯一の消費者として登録する（他の動作中のプロセスが消費者なら例外）
+    // 前の消費者が停止していた場合は、処理を終えていなかったレコードを先頭から読み出し直させる
+    void acquireConsumer();
+    // 共有時、停止したプロセスが残した状態を片付ける（回収中のフラグと、確保したまま公開されないレコード）
+    // 何かを片付けたら true を返す
+    bool recoverStalled();
+    // 共有時の待機者数（popSide が true なら消費者側、false なら生産者側）
+    std::atomic<std::uint32_t> &sharedWaiters(bool popSide) const;
+    // 共有時の通知用カウンタ。値が observed から変わるか timeout が経過するまで待機する
+    std::uint32_t sharedSignal(bool popSide) const;
+    void waitSignal(bool popSide, std::uint32_t observed, std::chrono::nanoseconds timeout) const;
+    // 共有時、待機中のプロセスがあれば全て起こす
+    void wakeSignal(bool popSide) const;
+
+    // 指定位置のレコードヘッダ
+    RecordHeader &header(std::uint64_t position) const;
+    // 指定位置のレコードが持つペイロードの先頭
+    std::uint8_t *payload(std::uint64_t position) const;
+    // 指定位置の次のレコード位置
+    std::uint64_t next(std::uint64_t position) const {
+        return position + header(position).length.load(std::memory_order_relaxed);
+    }
+
+    // 発生元の番号と名前の対応をファイルへ追記する（新しい番号を登録したときに 1 度だけ呼ぶ）
+    void storeSource(std::uint32_t id, std::string_view name);
+    // 共有時、ファイル上の一覧を registry へ取り込んでから name を登録し、全プロセスで共通の番号を返す
+    SourceId internSource(std::string_view name, SourceRegistry &registry);
+    // ファイル上の一覧のうち、registry に無い対応を取り込む（他のプロセスが登録した番号の解決用）
+    void syncSources(SourceRegistry &registry) const;
+    // ファイルに保存済みの発生元の対応を順に visit(id, name) へ渡す
+    template <typename Visitor>
+    void forEachSource(Visitor visit) const;
+
+private:
+    // テストから、確保の途中で停止した生産者を再現する
+    friend class RecordRingTestAccess;
+
+    // 共有時、tail を進める前に記録する確保の範囲（確保した生産者が途中で停止しても、消費者が範囲を読み飛ばせる）
+    struct Claim {
+        // 確保する位置（ラップマーカーがあればその位置）
+        std::atomic<std::uint64_t> begin;
+        // ラップマーカーのバイト数（0 なら置かない）
+        std::atomic<std::uint32_t> padding;
+        // レコードのバイト数（0 なら記録なし）
+        std::atomic<std::uint32_t> length;
+    };
+    // 共有時にリングを開いているプロセスの記録
+    struct Participant {
+        // プロセス ID（0 は空き）
+        std::atomic<std::uint32_t> pid;
+        std::uint32_t reserved;
+        // プロセスの開始時刻（ID が別のプロセスに再利用されていないかの判定に使う。取得できなければ 0）
+        std::atomic<std::uint64_t> startTime;
+        // スレッドごとの確保中の範囲
+        Claim claims[kMaxClaims];
+    };
+    // 停止したプロセスが残した確保の範囲
+    struct AbandonedClaim {
+        std::uint64_t begin;
+        std::size_t padding;
+        std::size_t length;
+        Claim *claim;
+    };
+
+    // ファイル先頭の制御領域。形式情報に続けて、カーソルを互いに別のキャッシュラインへ置く
+    struct Control {
+        // 初期化済みの制御領域であることを示す値（初期化の最後に書き込む）
+        std::uint64_t magic;
+        // ファイル形式のバージョン
+        std::uint32_t version;
+        // 作成時のレコードヘッダのバイト数
+        std::uint32_t headerBytes;
+        // 作成時のデータ領域のバイト数
+        std::uint64_t dataBytes;
+        // 次に投入するデータの全体の通し番号
+        alignas(64) std::atomic<std::uint64_t> sequence;
+        // 発生元一覧の使用済みバイト数（エントリを書き終えてから更新する）
+        alignas(64) std::atomic<std::uint64_t> sourceBytes;
+        // 生産者が次に確保する位置
+        alignas(64) std::atomic<std::uint64_t> tail;
+        // 消費者が次に確保する位置
+        alignas(64) std::atomic<std::uint64_t> readCursor;
+        // 生産者が再利用できる領域の先頭（ここから tail までが使用中）
+        alignas(64) std::atomic<std::uint64_t> head;
+        // reclaim を同時に 1 スレッドだけが行うためのフラグ
+        alignas(64) std::atomic<std::uint32_t> reclaiming;
+        // 回収中に release したスレッドが、回収中のスレッドへ再確認を依頼するフラグ
+        std::atomic<std::uint32_t> reclaimPending;
+        // 共有時に待機中のプロセスを起こすための通知用カウンタと待機者数（生産者側）
+        alignas(64) std::atomic<std::uint32_t> pushSignal;
+        std::atomic<std::uint32_t> pushWaiters;
+        // 同じく消費者側
+        alignas(64) std::atomic<std::uint32_t> popSignal;
+        std::atomic<std::uint32_t> popWaiters;
+        // 共有時に消費者を務めているプロセスの ID（0 なら不在）
+        alignas(64) std::atomic<std::uint32_t> consumer;
+        // 共有時にリングを開いているプロセス
+        alignas(64) Participant participants[kMaxParticipants];
+    };
+
+    // 制御領域に確保するバイト数（データ領域をページ境界から始めるため）
+    static constexpr std::size_t kControlBytes = 32 * 1024;
+    // 制御領域に続けて置く発生元一覧のバイト数
+    static constexpr std::size_t kSourceBytes = 64 * 1024;
+    // 発生元一覧に続けて置く、発生元ごとの次の通し番号の表のバイト数
+    static constexpr std::size_t kSourceSequenceBytes = SourceRegistry::kMaxSources * sizeof(std::uint64_t);
+
+    // 発生元一覧の 1 エントリの先頭（直後に名前が続き、8 バイト境界まで詰める）
+    struct SourceEntry {
+        std::uint32_t id;
+        std::uint32_t size;
+    };
+
+    // バックファイルを開いてマップする（keepContents が true で同じサイズなら内容を残し、true を返す）
+    bool map(bool keepContents, const MapSettings &settings);
+    // マップした領域へ settings の準備を行い、結果を report_ に記録する
+    void prepare(const MapSettings &settings);
+    // マップ全体の各ページへ触れてフォールトを済ませる（write が true なら同じ値を書き戻す）
+    void touchPages(bool write);
+    // 制御領域が同じ形式・サイズのリングを表しているか
+    bool hasCompatibleLayout() const;
+    // 空のリングとして制御領域を初期化する
+    void initialize();
+    // 引き継いだリングを検査し、未消費のレコードを再び読み出せる状態に戻す
+    std::size_t recover();
+    // 共有時、動作中の参加者がいれば初期化・復旧をせずに参加し、参加者の表へ自身を登録する
+    void attach(bool recoverExisting, bool kept);
+    // 共有時、参加者の表から自身を外し、消費者であれば役割を手放す
+    void detach();
+    // 参加者の表に動作中のプロセスが残っているか
+    bool hasLiveParticipant() const;
+    // pid が参加者の表に載っており、記録した開始時刻のまま動作しているか
+    bool isParticipantAlive(std::uint32_t pid) const;
+    // このスレッドが確保の範囲を記録する枠を借りる・返す
+    Claim &acquireClaim();
+    void releaseClaim(Claim &claim);
+    // 動作中のプロセスが position を含む範囲を確保中か
+    bool hasLiveClaim(std::uint64_t position) const;
+    // 停止したプロセスが position で確保したまま残した範囲を探す
+    bool findAbandonedClaim(std::uint64_t position, AbandonedClaim &found) const;
+    // 見つけた範囲をラップマーカーと読み飛ばし対象のレコードとして公開し、記録を消す（公開できたら true）
+    bool publishAbandoned(std::uint64_t position, const AbandonedClaim &found);
+    // 回収のフラグを取得する（停止したプロセスが持ったままなら引き取る）
+    void lockReclaim();
+    // head から limit まで、連続する処理済みレコードを 0 クリアして新しい head を返す
+    std::uint64_t reclaimFrom(std::uint64_t head, std::uint64_t limit);
+    // 前の消費者が停止した後、処理を終えていなかったレコードを読み出し直させる
+    void takeOver();
+    // 発生元の対応をファイルへ追記する（sourceMutex_ を保持して呼ぶ）
+    void appendSource(std::uint32_t id, std::string_view name);
+    // 指定位置のレコードのチェックサムを計算する
+    std::uint32_t checksum(std::uint64_t position) const;
+    // offset から length バイトのレコードの後ろにラップマーカーを置けない余りが残るなら、余りを含めた長さを返す
+    std::size_t fitLength(std::size_t offset, std::size_t length) const;
+    // [begin, end) の領域を 0 で埋める（終端での折り返しを考慮する）
+    void clear(std::uint64_t begin, std::uint64_t end);
+    // マップとファイルを解放する
+    void unmap();
+
+#ifdef _WIN32
+    std::uint64_t fileSize() const;
+    void ensureFileSize(std::uint64_t size);
+    void openFileHandle();
+    void mapView(std::uint64_t size);
+    void closeFileHandle();
+    void closeMappingHandle();
+    void unmapView();
+    void *mappingHandle_{nullptr};
+    void *fileHandle_{reinterpret_cast<void *>(-1)};
+#else
+    int fileDescriptor_{-1};
+#endif
+    // バックファイル全体のアドバイザリロック（共有時の参加処理と発生元の登録を他のプロセスと直列化する）
+    void lockFile();
+    void unlockFile();
+
+    // バックファイルのパス
+    std::string path_;
+    // データ領域のバイト数
+    std::size_t dataBytes_{0};
+    // マップ全体（制御領域 + 発生元一覧 + 発生元ごとの通し番号 + データ領域）のバイト数
+    std::size_t mappedSize_{0};
+    // マップ領域の先頭
+    std::uint8_t *mappedView_{nullptr};
+    // 制御領域
+    Control *control_{nullptr};
+    // 発生元一覧の先頭
+    std::uint8_t *sources_{nullptr};
+    // 発生元一覧への追記を直列化するミューテックス
+    std::mutex sourceMutex_;
+    // 発生元ごとの次の通し番号（発生元番号で引く）
+    std::atomic<std::uint64_t> *sourceSequences_{nullptr};
+    // データ領域の先頭
+    std::uint8_t *data_{nullptr};
+    // 起動時に引き継いだ未消費のレコード数
+    std::size_t recoveredRecords_{0};
+    // マップの準備結果
+    MappingReport report_;
+    // 共有時、書き込みのフォールトを済ませる処理を他のプロセスがいないと分かるまで保留しているか
+    bool prefaultPending_{false};
+    // 公開時に設定する読み手の数
+    std::uint32_t readers_{1};
+    // 他のプロセスとリングを共有しているか
+    bool shared_{false};
+    // 自身のプロセス ID（共有時にレコードの確保者・回収中のフラグ・参加者の表へ記録する）
+    std::uint32_t processId_{1};
+    // 自身のプロセスの開始時刻
+    std::uint64_t startTime_{0};
+    // 参加者の表で使っている位置
+    std::size_t participant_{kMaxParticipants};
+    // 自身の参加者の記録のうち、スレッドが使用中の確保の枠（ビットごと）
+    std::atomic<std::uint32_t> claimSlots_{0};
+};
+
+template <typename Visitor>
+void RecordRing::forEachSource(Visitor visit) const {
+    std::uint64_t used = control_->sourceBytes.load(std::memory_order_acquire);
+    std::uint64_t offset = 0;
+    while (offset + sizeof(SourceEntry) <= used) {
+        SourceEntry entry;
+        std::memcpy(&entry, sources_ + offset, sizeof(entry));
+        if (offset + sizeof(SourceEntry) + entry.size > used) {
+            break;
+        }
+        visit(entry.id, std::string_view(reinterpret_cast<const char *>(sources_ + offset + sizeof(SourceEntry)),
+                                         entry.size));
+        offset += (sizeof(SourceEntry) + entry.size + kAlignment - 1) / kAlignment * kAlignment;
+    }
+}
+
+} // namespace global_buffer
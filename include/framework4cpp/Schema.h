@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace global_buffer {
+
+// グローバルバッファでデータを扱う際のフィールド名セット
+struct FieldNames {
+    // 発生元を表すフィールド名（デフォルトは "source"）
+    std::string source{"source"};
+    // タイムスタンプを表すフィールド名（デフォルトは "timestamp"）
+    std::string timestamp{"timestamp"};
+    // ペイロードを表すフィールド名（デフォルトは "payload"）
+    std::string payload{"payload"};
+    // バッファ全体の通し番号を表すフィールド名（デフォルトは "sequence"）
+    std::string sequence{"sequence"};
+    // 発生元ごとの通し番号を表すフィールド名（デフォルトは "source_sequence"）
+    std::string sourceSequence{"source_sequence"};
+};
+
+// バッファ内のレコードが持つ列の種類
+enum class Column {
+    Timestamp,
+    Source,
+    Payload,
+    Sequence,
+    SourceSequence
+};
+
+// バッファ全体で共通のレコード構成（生成後は変更されず、出力側は開始時に 1 度だけ参照する）
+class Schema {
+public:
+    // フィールド名と列の並びから構成する（列が空なら 時刻・発生元・ペイロード・全体の通し番号・発生元ごとの通し番号 の順）
+    explicit Schema(FieldNames fieldNames = FieldNames{}, std::vector<Column> columns = {});
+
+    // フィールド名のセット
+    const FieldNames &fieldNames() const { return fieldNames_; }
+    // 出力する列の並び
+    const std::vector<Column> &columns() const { return columns_; }
+    // 列に対応するフィールド名
+    const std::string &name(Column column) const;
+
+private:
+    FieldNames fieldNames_;
+    std::vector<Column> columns_;
+};
+
+} // namespace global_buffer
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace global_buffer {
+
+// 登録済みの発生元を表す番号
+using SourceId = std::uint32_t;
+
+// 名前が空の発生元（登録せずに常に利用できる）
+inline constexpr SourceId kAnonymousSource = 0;
+
+// 発生元の名前を一度だけ登録し、以降は番号で扱うための表
+// 登録は排他制御するが、番号から名前への参照はロックを取らずに行える
+class SourceRegistry {
+public:
+    // 登録できる発生元の最大数
+    static constexpr std::size_t kMaxSources = 4096;
+
+    SourceRegistry();
+    SourceRegistry(const SourceRegistry &) = delete;
+    SourceRegistry &operator=(const SourceRegistry &) = delete;
+
+    // 名前を登録して番号を返す（登録済みなら同じ番号を返し、新規登録時は added を true にする）
+    SourceId intern(std::string_view name, bool *added = nullptr);
+    // 保存済みの対応を指定の番号で復元する（起動時の引き継ぎ用）
+    void restore(SourceId id, std::string_view name);
+    // 番号に対応する名前（未登録の番号は例外）
+    std::string_view name(SourceId id) const;
+    // 番号が登録済みか
+    bool contains(SourceId id) const { return id < size_.load(std::memory_order_acquire); }
+    // 登録済みの番号の数（最大の番号 + 1）
+    std::size_t size() const { return size_.load(std::memory_order_acquire); }
+
+private:
+    // 登録処理を直列化するミューテックス
+    std::mutex mutex_;
+    // 名前から番号への対応（登録時のみ参照）
+    std::unordered_map<std::string, SourceId> ids_;
+    // 番号ごとの名前。size_ の公開後は書き換えないため、ロック無しで読める
+    std::unique_ptr<std::unique_ptr<const std::string>[]> names_;
+    // 公開済みの番号の数
+    std::atomic<std::size_t> size_{0};
+};
+
+} // namespace global_buffer
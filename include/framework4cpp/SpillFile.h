@@ -0,0 +1,51 @@
+#pragma once
+
+#include "framework4cpp/GlobalBuffer.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace global_buffer {
+
+// バッファが満杯の間に溢れたデータを一時的に退避する追記専用のファイル
+// 書き込み位置と読み出し位置を持つ FIFO として使い、全て読み出した時点で先頭から再利用する
+// スレッドセーフではないため、呼び出し側で排他制御すること
+class SpillFile {
+public:
+    // path にファイルを作成する（既存の内容は破棄する）
+    explicit SpillFile(std::string path);
+    SpillFile(const SpillFile &) = delete;
+    SpillFile &operator=(const SpillFile &) = delete;
+    // ファイルを閉じて削除する
+    ~SpillFile();
+
+    // アイテムを末尾へ追記する
+    void append(const BufferItem &item);
+    // 最も古いアイテムを 1 件読み出す（未読が無ければ false）
+    bool read(BufferItem &item);
+    // 未読のアイテムが無いか
+    bool empty() const { return pending_ == 0; }
+    // 未読のアイテム数
+    std::uint64_t pending() const { return pending_; }
+
+private:
+    // ファイル上の 1 件分の先頭に置く固定長の情報
+    struct RecordHeader {
+        std::int64_t timestamp;
+        std::uint64_t sequence;
+        std::uint64_t sourceSequence;
+        std::uint32_t source;
+        std::uint32_t payloadSize;
+    };
+
+    std::string path_;
+    std::fstream file_;
+    // 次に書き込む位置と読み出す位置（バイト）
+    std::uint64_t writeOffset_{0};
+    std::uint64_t readOffset_{0};
+    // 未読のアイテム数
+    std::uint64_t pending_{0};
+};
+
+} // namespace global_buffer
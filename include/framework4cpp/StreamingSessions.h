@@ -4,8 +4,10 @@
 #include "framework4cpp/GlobalBuffer.h"
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <thread>
 
 namespace framework4cpp {
@@ -29,6 +31,9 @@ protected:
     virtual void run() = 0;
     // リソース解放などの後処理を行うフック
     virtual void cleanup() {}
+    // バッファの占有率が高水位に達している間、低水位まで下がるか停止指示が出るまで待機する
+    // 読み取りを止めて入力元の流量制御に任せたいセッションが、次の読み取りの前に呼ぶ（停止指示なら false）
+    bool waitWhilePressured();
 
     // データ格納先のグローバルバッファ参照
     GlobalBuffer &buffer_;
@@ -41,6 +46,11 @@ private:
     std::thread worker_;
     // セッションが稼働中かのフラグ
     std::atomic<bool> running_{false};
+    // バッファの高水位・低水位の通知を受けて、待機中の受信ループを起こすための同期オブジェクト
+    std::mutex pressureMutex_;
+    std::condition_variable pressureChanged_;
+    // バッファへ登録した通知先の番号（0 は未登録）
+    std::size_t pressureListener_{0};
 };
 
 inline void StreamingSession::start() {
@@ -50,21 +60,43 @@ inline void StreamingSession::start() {
         // 既に起動済みの場合は何もせず戻る
         return;
     }
+    // 高水位・低水位の通知で、waitWhilePressured で待機中の受信ループを起こす
+    pressureListener_ = buffer_.addPressureListener([this](bool) {
+        std::lock_guard<std::mutex> lock(pressureMutex_);
+        pressureChanged_.notify_all();
+    });
     // 受信処理用のスレッドを生成する
     worker_ = std::thread(&StreamingSession::threadMain, this);
 }
 
 inline void StreamingSession::stop() {
-    // ループに終了を指示する
-    running_.store(false);
+    // ループに終了を指示し、高水位で待機中なら起こす
+    {
+        std::lock_guard<std::mutex> lock(pressureMutex_);
+        running_.store(false);
+    }
+    pressureChanged_.notify_all();
     // スレッドがまだ動作していれば join する
     if (worker_.joinable()) {
         worker_.join();
     }
+    if (pressureListener_ != 0) {
+        buffer_.removePressureListener(pressureListener_);
+        pressureListener_ = 0;
+    }
     // 派生クラス固有の後片付けを呼び出す
     cleanup();
 }
 
+inline bool StreamingSession::waitWhilePressured() {
+    if (!buffer_.underPressure()) {
+        return isRunning();
+    }
+    std::unique_lock<std::mutex> lock(pressureMutex_);
+    pressureChanged_.wait(lock, [this]() { return !buffer_.underPressure() || !running_.load(); });
+    return running_.load();
+}
+
 inline void StreamingSession::threadMain() {
     try {
         // 派生クラスの run() を実行し、例外は外へ伝播させる
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace framework4cpp {
+
+// 受信時刻をローカル時刻の文字列へ整形する（1 つのスレッドから使う）
+// 書式は strftime の指定子に加え、秒未満を %f（マイクロ秒 6 桁）や %Nf（N 桁、1〜9。%3f でミリ秒、%9f でナノ秒）で書ける
+// 同じ秒の時刻は前回の結果を使い回して秒未満の桁だけを書き換え、ローカル時刻への変換は 1 分に 1 回だけ行う
+class TimestampFormatter {
+public:
+    explicit TimestampFormatter(const std::string &format);
+
+    // timestamp を整形して out の末尾へ追加する
+    void append(std::chrono::system_clock::time_point timestamp, std::string &out);
+
+private:
+    // strftime で整形する部分と、その直後に置く秒未満の桁数（0 なら置かない）
+    struct Piece {
+        std::string format;
+        unsigned digits{0};
+    };
+    // 整形結果の中で秒未満の桁を書き込む位置と桁数
+    struct Field {
+        std::size_t offset{0};
+        unsigned digits{0};
+    };
+
+    // second（エポックからの秒）の整形結果を作り直す（秒未満の桁は 0 で埋めておく）
+    void render(std::int64_t second);
+    // second のローカル時刻（同じ分の間は前回の変換結果から秒だけを進める）
+    const std::tm &localTime(std::int64_t second);
+
+    std::vector<Piece> pieces_;
+    // 直前に整形した秒と、その整形結果・秒未満の桁の位置
+    std::int64_t second_{0};
+    bool rendered_{false};
+    std::string text_;
+    std::vector<Field> fields_;
+    // 直前にローカル時刻へ変換した秒（エポックからの秒）と、その変換結果
+    std::int64_t converted_{0};
+    bool hasConverted_{false};
+    std::tm convertedTime_{};
+    // 変換結果から秒を進めたローカル時刻
+    std::tm localTime_{};
+    // strftime の出力先（容量を使い回す）
+    std::vector<char> scratch_;
+};
+
+} // namespace framework4cpp
@@ -106,6 +106,93 @@ Config Config::loadFromFile(const std::string &path) {
                 config.buffer.memoryMapped = parseBool(value);
             } else if (key == "backing_file") {
                 config.buffer.backingFile = value;
+            } else if (key == "size_bytes") {
+                config.buffer.sizeBytes = parseSize(value);
+            } else if (key == "max_bytes") {
+                config.buffer.maxBytes = parseSize(value);
+            } else if (key == "recover") {
+                config.buffer.recover = parseBool(value);
+            } else if (key == "prefault") {
+                config.buffer.prefault = parseBool(value);
+            } else if (key == "lock_memory") {
+                config.buffer.lockMemory = parseBool(value);
+            } else if (key == "huge_pages") {
+                config.buffer.hugePages = parseBool(value);
+            } else if (key == "shared") {
+                config.buffer.shared = parseBool(value);
+            } else if (key == "process_role") {
+                // 共有時のプロセスの役割（both / producer / writer）
+                if (value == "both") {
+                    config.buffer.processRole = ProcessRole::Both;
+                } else if (value == "producer") {
+                    config.buffer.processRole = ProcessRole::Producer;
+                } else if (value == "writer") {
+                    config.buffer.processRole = ProcessRole::Writer;
+                } else {
+                    throw std::runtime_error("Invalid process_role value: " + value);
+                }
+            } else if (key == "producer_lanes") {
+                config.buffer.producerLanes = parseBool(value);
+            } else if (key == "lane_order") {
+                // lane からの取り出し順序（timestamp または round_robin）
+                if (value == "timestamp") {
+                    config.buffer.orderedLanes = true;
+                } else if (value == "round_robin") {
+                    config.buffer.orderedLanes = false;
+                } else {
+                    throw std::runtime_error("Invalid lane_order value: " + value);
+                }
+            } else if (key == "overflow_policy") {
+                // 満杯時の扱い（block / block_timeout / drop_newest / drop_oldest / spill）
+                if (value == "block") {
+                    config.buffer.overflowPolicy = OverflowMode::Block;
+                } else if (value == "block_timeout") {
+                    config.buffer.overflowPolicy = OverflowMode::BlockTimeout;
+                } else if (value == "drop_newest") {
+                    config.buffer.overflowPolicy = OverflowMode::DropNewest;
+                } else if (value == "drop_oldest") {
+                    config.buffer.overflowPolicy = OverflowMode::DropOldest;
+                } else if (value == "spill") {
+                    config.buffer.overflowPolicy = OverflowMode::Spill;
+                } else {
+                    throw std::runtime_error("Invalid overflow_policy value: " + value);
+                }
+            } else if (key == "overflow_timeout_ms") {
+                config.buffer.overflowTimeout = parseDurationMs(value);
+            } else if (key == "spill_file") {
+                config.buffer.spillFile = value;
+            } else if (key == "wait_strategy") {
+                // 満杯・空のときの待ち方（blocking / spin_yield_park / busy_spin）
+                if (value == "blocking") {
+                    config.buffer.waitStrategy = WaitMode::Blocking;
+                } else if (value == "spin_yield_park") {
+                    config.buffer.waitStrategy = WaitMode::SpinYieldPark;
+                } else if (value == "busy_spin") {
+                    config.buffer.waitStrategy = WaitMode::BusySpin;
+                } else {
+                    throw std::runtime_error("Invalid wait_strategy value: " + value);
+                }
+            } else if (key == "wait_spin_count") {
+                config.buffer.waitSpinCount = parseSize(value);
+            } else if (key == "wait_yield_count") {
+                config.buffer.waitYieldCount = parseSize(value);
+            } else if (key == "clock_source") {
+                // 受信時刻の取得元（realtime / realtime_coarse / tsc）
+                if (value == "realtime") {
+                    config.buffer.clockSource = ClockMode::Realtime;
+                } else if (value == "realtime_coarse") {
+                    config.buffer.clockSource = ClockMode::RealtimeCoarse;
+                } else if (value == "tsc") {
+                    config.buffer.clockSource = ClockMode::Tsc;
+                } else {
+                    throw std::runtime_error("Invalid clock_source value: " + value);
+                }
+            } else if (key == "clock_resync_ms") {
+                config.buffer.clockResyncInterval = parseDurationMs(value);
+            } else if (key == "high_watermark_percent") {
+                config.buffer.highWatermarkPercent = parseSize(value);
+            } else if (key == "low_watermark_percent") {
+                config.buffer.lowWatermarkPercent = parseSize(value);
             } else if (key == "source_field") {
                 // 発生元フィールド名の上書き指定
                 config.buffer.fieldNames.source = value;
@@ -115,6 +202,12 @@ Config Config::loadFromFile(const std::string &path) {
             } else if (key == "payload_field") {
                 // ペイロードフィールド名の上書き指定
                 config.buffer.fieldNames.payload = value;
+            } else if (key == "sequence_field") {
+                // 全体の通し番号フィールド名の上書き指定
+                config.buffer.fieldNames.sequence = value;
+            } else if (key == "source_sequence_field") {
+                // 発生元ごとの通し番号フィールド名の上書き指定
+                config.buffer.fieldNames.sourceSequence = value;
             } else {
                 throw std::runtime_error("Unknown key in [buffer]: " + key);
             }
@@ -128,10 +221,31 @@ Config Config::loadFromFile(const std::string &path) {
                 config.csv.quoteStrings = parseBool(value);
             } else if (key == "include_timestamp") {
                 config.csv.includeTimestamp = parseBool(value);
+            } else if (key == "include_sequence") {
+                config.csv.includeSequence = parseBool(value);
             } else if (key == "flush_interval_ms") {
                 config.csv.flushInterval = parseDurationMs(value);
+            } else if (key == "write_buffer") {
+                // 0 では書き込み単位が無くなり、整形と書き込みを重ねられないため受け付けない
+                config.csv.writeBufferBytes = parseSize(value);
+                if (config.csv.writeBufferBytes == 0) {
+                    throw std::runtime_error("Invalid write_buffer value: " + value);
+                }
+            } else if (key == "preallocate") {
+                config.csv.preallocateBytes = parseSize(value);
+            } else if (key == "sync_writes") {
+                config.csv.syncWrites = parseBool(value);
             } else if (key == "timestamp_format") {
                 config.csv.timestampFormat = value;
+            } else if (key == "payload_layout") {
+                // ペイロード列の 16 進表記（spaced / packed）
+                if (value == "spaced") {
+                    config.csv.payloadLayout = PayloadLayout::Spaced;
+                } else if (value == "packed") {
+                    config.csv.payloadLayout = PayloadLayout::Packed;
+                } else {
+                    throw std::runtime_error("Invalid payload_layout value: " + value);
+                }
             } else {
                 throw std::runtime_error("Unknown key in [csv]: " + key);
             }
@@ -0,0 +1,202 @@
+#include "framework4cpp/Clock.h"
+
+#include <algorithm>
+#include <thread>
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+namespace global_buffer {
+
+namespace {
+
+// 換算係数を初めて測るときに、カウンタと壁時計を比べる時間
+constexpr std::chrono::milliseconds kInitialCalibration{10};
+// 合わせ直しで測った換算係数が、これまでの値からこの割合以上ずれていれば壁時計が飛んだとみなす
+constexpr double kMaxRateDrift = 0.01;
+
+// 壁時計（CLOCK_REALTIME）の system_clock のエポックからのナノ秒
+std::int64_t wallNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// 粗い壁時計（CLOCK_REALTIME_COARSE）のナノ秒（使えない環境では呼ばれない）
+std::int64_t coarseNanoseconds() {
+#ifdef CLOCK_REALTIME_COARSE
+    struct timespec now {};
+    ::clock_gettime(CLOCK_REALTIME_COARSE, &now);
+    return static_cast<std::int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+#else
+    return wallNanoseconds();
+#endif
+}
+
+// CPU のタイムスタンプカウンタ（x86 は TSC、AArch64 は仮想カウンタ）
+inline std::uint64_t readCounter() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return 0;
+#endif
+}
+
+// 周波数が一定で、全コアで同じ値を返すカウンタがあるか（無ければ理由を note に書く）
+bool hasInvariantCounter(std::string &note) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int registers[4] = {};
+    __cpuid(registers, 0x80000000);
+    if (static_cast<unsigned>(registers[0]) >= 0x80000007U) {
+        __cpuid(registers, 0x80000007);
+        // EDX の bit 8 が不変 TSC（省電力状態や周波数の変化に関わらず一定の速度で進む）
+        if ((registers[3] & (1 << 8)) != 0) {
+            return true;
+        }
+    }
+    note = "the CPU does not report an invariant TSC";
+    return false;
+#elif defined(__x86_64__) || defined(__i386__)
+    unsigned eax = 0;
+    unsigned ebx = 0;
+    unsigned ecx = 0;
+    unsigned edx = 0;
+    // EDX の bit 8 が不変 TSC（省電力状態や周波数の変化に関わらず一定の速度で進む）
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1U << 8)) != 0) {
+        return true;
+    }
+    note = "the CPU does not report an invariant TSC";
+    return false;
+#elif defined(__aarch64__)
+    // AArch64 の仮想カウンタは常に一定の周波数で全コア共通に進む
+    return true;
+#else
+    note = "no cycle counter is available on this architecture";
+    return false;
+#endif
+}
+
+} // namespace
+
+Clock::Clock(ClockSource source, std::chrono::milliseconds resyncInterval) : source_(source) {
+    if (source_ == ClockSource::RealtimeCoarse) {
+#ifndef CLOCK_REALTIME_COARSE
+        note_ = "CLOCK_REALTIME_COARSE is not available on this platform";
+        source_ = ClockSource::Realtime;
+#endif
+    } else if (source_ == ClockSource::Tsc) {
+        if (!hasInvariantCounter(note_)) {
+            source_ = ClockSource::Realtime;
+            return;
+        }
+        calibrate(true);
+        const double interval = static_cast<double>(std::max<std::int64_t>(resyncInterval.count(), 1)) * 1e6;
+        resyncTicks_ = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(interval / nanosecondsPerTick()));
+    }
+}
+
+std::chrono::system_clock::time_point Clock::now() {
+    std::int64_t nanoseconds = read();
+    // 壁時計が戻された場合や合わせ直しで換算が変わった場合も、これまでに返した時刻より前にはしない
+    std::int64_t latest = latest_.load(std::memory_order_relaxed);
+    while (nanoseconds > latest) {
+        if (latest_.compare_exchange_weak(latest, nanoseconds, std::memory_order_relaxed)) {
+            break;
+        }
+    }
+    nanoseconds = std::max(nanoseconds, latest);
+    return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::nanoseconds(nanoseconds)));
+}
+
+std::int64_t Clock::read() {
+    switch (source_) {
+    case ClockSource::RealtimeCoarse:
+        return coarseNanoseconds();
+    case ClockSource::Tsc:
+        return readTsc();
+    case ClockSource::Realtime:
+        break;
+    }
+    return wallNanoseconds();
+}
+
+std::int64_t Clock::readTsc() {
+    const std::uint64_t ticks = readCounter();
+    while (true) {
+        // 換算の基準を読み、その間に更新されていれば読み直す
+        const std::uint32_t version = version_.load(std::memory_order_acquire);
+        const std::uint64_t baseTicks = baseTicks_.load(std::memory_order_relaxed);
+        const std::int64_t baseNanoseconds = baseNanoseconds_.load(std::memory_order_relaxed);
+        const double rate = nanosecondsPerTick_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((version & 1) != 0 || version != version_.load(std::memory_order_relaxed)) {
+            std::this_thread::yield();
+            continue;
+        }
+        // 他のスレッドが直前に合わせ直していれば、読んだカウンタが基準より前になることがある
+        const std::int64_t elapsed = static_cast<std::int64_t>(ticks - baseTicks);
+        if (elapsed > static_cast<std::int64_t>(resyncTicks_) &&
+            !resyncing_.exchange(true, std::memory_order_acquire)) {
+            calibrate(false);
+            resyncing_.store(false, std::memory_order_release);
+            continue;
+        }
+        return baseNanoseconds + static_cast<std::int64_t>(static_cast<double>(elapsed) * rate);
+    }
+}
+
+void Clock::calibrate(bool initial) {
+    // 壁時計の読み取りをカウンタの読み取りで挟み、その中点を壁時計と同じ時点とみなす
+    auto sample = [](std::uint64_t &ticks) {
+        const std::uint64_t before = readCounter();
+        const std::int64_t wall = wallNanoseconds();
+        const std::uint64_t after = readCounter();
+        ticks = before + (after - before) / 2;
+        return wall;
+    };
+    std::uint64_t ticks = 0;
+    std::int64_t wall = sample(ticks);
+    double rate = nanosecondsPerTick_.load(std::memory_order_relaxed);
+    if (initial) {
+        const std::uint64_t startTicks = ticks;
+        const std::int64_t startWall = wall;
+        std::this_thread::sleep_for(kInitialCalibration);
+        wall = sample(ticks);
+        rate = static_cast<double>(wall - startWall) / static_cast<double>(ticks - startTicks);
+    } else {
+        // 前回の基準からの経過で換算係数を測り直す（壁時計が飛んだ場合は係数を据え置き、基準だけ合わせる）
+        const std::uint64_t baseTicks = baseTicks_.load(std::memory_order_relaxed);
+        const std::int64_t baseNanoseconds = baseNanoseconds_.load(std::memory_order_relaxed);
+        if (ticks > baseTicks) {
+            const double measured =
+                static_cast<double>(wall - baseNanoseconds) / static_cast<double>(ticks - baseTicks);
+            if (measured > rate * (1.0 - kMaxRateDrift) && measured < rate * (1.0 + kMaxRateDrift)) {
+                rate = measured;
+            }
+        }
+    }
+    // 読み手が途中の値を使わないよう、更新中は version_ を奇数にしておく
+    const std::uint32_t version = version_.load(std::memory_order_relaxed);
+    version_.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    baseTicks_.store(ticks, std::memory_order_relaxed);
+    baseNanoseconds_.store(wall, std::memory_order_relaxed);
+    nanosecondsPerTick_.store(rate, std::memory_order_relaxed);
+    version_.store(version + 2, std::memory_order_release);
+}
+
+} // namespace global_buffer
@@ -0,0 +1,47 @@
+#include "framework4cpp/GapDetector.h"
+
+namespace global_buffer {
+
+std::uint64_t GapDetector::observe(SourceId source, std::uint64_t sourceSequence) {
+    if (source >= tracks_.size()) {
+        tracks_.resize(static_cast<std::size_t>(source) + 1);
+    }
+    Track &track = tracks_[source];
+    SourceGapStats &stats = track.stats;
+    ++stats.received;
+    if (!track.seen) {
+        track.seen = true;
+        stats.source = source;
+        stats.next = sourceSequence + 1;
+        return 0;
+    }
+    if (sourceSequence < stats.next) {
+        // 通過済みの番号は抜けを埋めたものとはみなさず、順序の入れ替わりとして数える
+        ++stats.reordered;
+        return 0;
+    }
+    const std::uint64_t missing = sourceSequence - stats.next;
+    if (missing > 0) {
+        ++stats.gaps;
+        stats.missing += missing;
+        missing_ += missing;
+        if (stats.recent.size() == kMaxRecentGaps) {
+            stats.recent.erase(stats.recent.begin());
+        }
+        stats.recent.push_back(SequenceGap{stats.next, sourceSequence - 1});
+    }
+    stats.next = sourceSequence + 1;
+    return missing;
+}
+
+std::vector<SourceGapStats> GapDetector::stats() const {
+    std::vector<SourceGapStats> result;
+    for (const Track &track : tracks_) {
+        if (track.seen) {
+            result.push_back(track.stats);
+        }
+    }
+    return result;
+}
+
+} // namespace global_buffer
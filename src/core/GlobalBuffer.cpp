@@ -1,20 +1,33 @@
 #include "framework4cpp/GlobalBuffer.h"
+#include "framework4cpp/RecordRing.h"
+#include "framework4cpp/SpillFile.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstring>
+#include <limits>
 #include <stdexcept>
+#include <thread>
 
-#ifdef _WIN32
-#include <Windows.h>
-#else
-#include <fcntl.h>
-#include <sys/mman.h>
-#include <unistd.h>
+#ifdef _MSC_VER
+#include <intrin.h>
 #endif
 
 namespace global_buffer {
 
 namespace {
 
+// スピン待機中であることを CPU へ伝え、同じコアの他のハードウェアスレッドへ実行資源を譲る
+inline void cpuRelax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
 // メモリマップト利用時に必要なオプションを検証し、未指定項目を補完する
 Options normalizeOptions(const Options &input) {
     Options result = input;
@@ -30,27 +43,67 @@ Options normalizeOptions(const Options &input) {
     if (result.memoryMapped && result.backingFile.empty()) {
         result.backingFile = Options{}.backingFile;
     }
-    // フィールド名が空の場合はデフォルトのフィールド名を採用する
-    if (result.fieldNames.source.empty()) {
-        result.fieldNames.source = Options{}.fieldNames.source;
-    }
-    if (result.fieldNames.timestamp.empty()) {
-        result.fieldNames.timestamp = Options{}.fieldNames.timestamp;
+    // データ領域のサイズ指定が無ければ、従来どおり capacity 件の最大サイズ分を確保する
+    if (result.memoryMapped && result.sizeBytes == 0) {
+        result.sizeBytes =
+            std::max<std::size_t>(result.capacity, 2) * RecordRing::recordLength(result.maxPayloadSize);
     }
-    if (result.fieldNames.payload.empty()) {
-        result.fieldNames.payload = Options{}.fieldNames.payload;
+    // メモリマップト利用時はデータ領域そのものがバイト数の上限になる
+    if (result.memoryMapped && result.maxBytes != 0) {
+        result.sizeBytes = std::min(result.sizeBytes, result.maxBytes);
     }
     return result;
 }
 
+// タイムスタンプをレコードへ格納するナノ秒表現に変換する
+std::int64_t toNanoseconds(std::chrono::system_clock::time_point timestamp) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp.time_since_epoch()).count();
+}
+
+// レコードに格納したナノ秒表現からタイムスタンプを復元する
+std::chrono::system_clock::time_point fromNanoseconds(std::int64_t nanoseconds) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(nanoseconds)));
+}
+
+// プロセス間で共有する場合に、1 回の待機で眠る最長時間
+constexpr std::chrono::milliseconds kSharedWaitSlice{100};
+
 } // namespace
 
 GlobalBuffer::GlobalBuffer(const Options &options)
-    : options_(normalizeOptions(options)), capacity_(options_.capacity), fieldNames_(options_.fieldNames) {
+    : options_(normalizeOptions(options)), capacity_(options_.capacity), schema_(options_.fieldNames),
+      clock_(options_.clockSource, options_.clockResyncInterval) {
     // 容量が 0 のままならば利用できないため例外を投げる
     if (capacity_ == 0) {
         throw std::invalid_argument("GlobalBuffer capacity must be greater than zero");
     }
+    // 低水位は高水位より下でなければ、通知が切り替わり続けてしまう
+    if (options_.highWatermark < 0.0 || options_.highWatermark > 1.0 ||
+        (options_.highWatermark > 0.0 &&
+         (options_.lowWatermark < 0.0 || options_.lowWatermark >= options_.highWatermark))) {
+        throw std::invalid_argument("Buffer watermarks must satisfy 0 <= low < high <= 1");
+    }
+    if (options_.shareAcrossProcesses) {
+        // 他のプロセスから見えない状態（lane・退避ファイル・水位の判定・最古データの取り出し）に頼る機能は使えない
+        if (!options_.memoryMapped) {
+            throw std::invalid_argument("Sharing a buffer across processes requires memory mapping");
+        }
+        if (options_.overflowPolicy == OverflowPolicy::DropOldest || options_.overflowPolicy == OverflowPolicy::Spill) {
+            throw std::invalid_argument("DropOldest and Spill cannot be used with a buffer shared across processes");
+        }
+        if (options_.highWatermark > 0.0) {
+            throw std::invalid_argument("Watermarks cannot be used with a buffer shared across processes");
+        }
+    }
+    // 占有率はアイテム数（メモリマップト利用時はバイト数）で比較し、生産者は容量の 1/64 ごとに確認する
+    auto setWatermarks = [this](std::uint64_t units) {
+        if (options_.highWatermark > 0.0) {
+            highMark_ = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(options_.highWatermark * units));
+            lowMark_ = static_cast<std::uint64_t>(options_.lowWatermark * units);
+        }
+        pressureStride_ = std::max<std::uint64_t>(1, units / 64);
+    };
     if (options_.memoryMapped) {
         // メモリマップト有効時は必要なパラメータが揃っているかを再確認する
         if (options_.backingFile.empty()) {
@@ -60,9 +113,40 @@ GlobalBuffer::GlobalBuffer(const Options &options)
             throw std::invalid_argument(
                 "Max payload size must be greater than zero when memory mapping is enabled");
         }
-        slotSize_ = sizeof(std::uint32_t) + options_.maxPayloadSize;
-        mappedSize_ = slotSize_ * capacity_;
-        initializeMapping();
+        // lane はメモリ上にのみ置くため、バックファイルの内容と併用できない
+        if (options_.producerLanes) {
+            throw std::invalid_argument("Producer lanes cannot be used with a memory-mapped buffer");
+        }
+        // 長さ付きレコードを詰めて格納するため、データ領域はバイト数で確保する
+        // 引き継いだ未消費レコードは通常のデータと同じく消費者へ順に渡される
+        MapSettings mapping;
+        mapping.prefault = options_.prefaultMapping;
+        mapping.lock = options_.lockMapping;
+        mapping.hugePages = options_.hugePages;
+        mapping.shared = options_.shareAcrossProcesses;
+        ring_ = std::make_unique<RecordRing>(options_.backingFile, options_.sizeBytes, options_.recover, mapping);
+        // 引き継いだレコードの発生元番号を解決できるよう、保存済みの対応を復元する
+        ring_->forEachSource([this](std::uint32_t id, std::string_view name) { sources_.restore(id, name); });
+        if (ring_->maxRecordLength() < RecordRing::recordLength(options_.maxPayloadSize)) {
+            throw std::invalid_argument("Buffer size must be at least twice the maximum record size");
+        }
+        setWatermarks(ring_->dataBytes());
+        return;
+    }
+    setWatermarks(capacity_);
+    sourceSequences_.reset(new std::atomic<std::uint64_t>[SourceRegistry::kMaxSources]());
+    // バイト数の予算を設けた場合は、予算に対する使用量でも同じ割合の水位を判定する
+    if (options_.maxBytes != 0) {
+        if (highMark_ != 0) {
+            byteHighMark_ = std::max<std::size_t>(1, static_cast<std::size_t>(options_.highWatermark * options_.maxBytes));
+            byteLowMark_ = static_cast<std::size_t>(options_.lowWatermark * options_.maxBytes);
+        }
+        byteStride_ = std::max<std::size_t>(1, options_.maxBytes / 64);
+    }
+    // 各セルの sequence を自身の位置で初期化し、全セルを空き状態にする
+    cells_.reset(new Cell[capacity_]);
+    for (std::size_t i = 0; i < capacity_; ++i) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
     }
 }
 
@@ -71,225 +155,2006 @@ GlobalBuffer::GlobalBuffer(std::size_t capacity, bool memoryMapped, const std::s
     : GlobalBuffer(Options{capacity, memoryMapped, backingFile, maxPayloadSize}) {}
 
 GlobalBuffer::~GlobalBuffer() {
-    // 破棄時に待機スレッドを解除する
+    // 破棄時に待機スレッドを解除する（マップの解放は ring_ の破棄で行われる）
     shutdown();
-    releaseMapping();
 }
 
 void GlobalBuffer::push(BufferItem item) {
-    // 排他制御のためにロックを獲得する
-    std::unique_lock<std::mutex> lock(mutex_);
-    // バッファに空きができるか、終了指示が出るまで待機する
-    canPush_.wait(lock, [this]() { return shutdown_ || queue_.size() < capacity_; });
-    if (shutdown_) {
-        // 終了中は新しいデータを受け付けない
+    // 領域確保後に失敗するとリングが詰まるため、検証は確保前に済ませる
+    validateItem(item);
+    stamp(item);
+
+    if (ring_) {
+        // アイテムの大きさに合わせた長さのレコードだけを確保する
+        std::uint64_t position = 0;
+        if (!claimRecord(RecordRing::recordLength(item.payload.size()), position)) {
+            overflow(item);
+            return;
+        }
+        publishRecord(position, item);
+        wake(canPop_, popWaiters_, true);
+        checkHighWatermark(position, position + RecordRing::recordLength(item.payload.size()));
         return;
     }
-    // BufferItem に対してこのバッファで利用するフィールド名を適用する
-    item.fieldNames = fieldNames_;
 
-    std::size_t slotIndex = QueueEntry::kInvalidSlot;
-    std::size_t payloadSize = item.payload.size();
-    if (options_.memoryMapped) {
-        // メモリマップトバッファが初期化済みかを確認する
-        if (!mappedView_) {
-            throw std::runtime_error("Memory-mapped buffer is not initialized");
+    // 空きセルを確保する（確保できなければ満杯時の扱いに従い、終了中は新しいデータを受け付けない）
+    std::size_t position = 0;
+    if (claimCells(1, [&item](std::size_t) { return item.payload.size(); }, position) == 0) {
+        overflow(item);
+        return;
+    }
+    publishCell(position, std::move(item));
+    // 待機中の消費者がいれば起こす
+    wake(canPop_, popWaiters_, true);
+    checkHighWatermark(position, position + 1);
+}
+
+void GlobalBuffer::pushBatch(std::vector<BufferItem> &items) {
+    for (const auto &item : items) {
+        validateItem(item);
+    }
+    stamp(items);
+
+    if (ring_) {
+        // レコード長がアイテムごとに異なるため 1 件ずつ確保し、通知は最後に 1 回だけ行う
+        std::size_t next = 0;
+        for (; next < items.size(); ++next) {
+            std::uint64_t position = 0;
+            if (!claimRecord(RecordRing::recordLength(items[next].payload.size()), position)) {
+                break;
+            }
+            publishRecord(position, items[next]);
+            checkHighWatermark(position, position + RecordRing::recordLength(items[next].payload.size()));
         }
-        // 許容サイズを超えるデータは登録できないため例外を送出する
-        if (payloadSize > options_.maxPayloadSize) {
-            throw std::runtime_error("Payload size exceeds configured maximum for memory-mapped buffer");
+        // 確保できなかった以降のアイテムは満杯時の扱いに従わせる（期限付きの待機を件数分繰り返さない）
+        for (; next < items.size(); ++next) {
+            overflow(items[next]);
+        }
+        wake(canPop_, popWaiters_, true);
+        items.clear();
+        return;
+    }
+
+    std::size_t next = 0;
+    while (next < items.size()) {
+        // 残り件数分の連続セルを 1 回の CAS でまとめて確保する
+        std::size_t position = 0;
+        std::size_t claimed = claimCells(
+            items.size() - next, [&items, next](std::size_t i) { return items[next + i].payload.size(); }, position);
+        if (claimed == 0) {
+            break;
+        }
+        for (std::size_t i = 0; i < claimed; ++i) {
+            publishCell(position + i, std::move(items[next + i]));
+        }
+        next += claimed;
+        // 通知は確保したまとまりごとに 1 回だけ行う
+        wake(canPop_, popWaiters_, true);
+        checkHighWatermark(position, position + claimed);
+    }
+    // 確保できなかった以降のアイテムは満杯時の扱いに従わせる（期限付きの待機を件数分繰り返さない）
+    for (; next < items.size(); ++next) {
+        overflow(items[next]);
+    }
+    items.clear();
+}
+
+template <typename Sink>
+std::size_t GlobalBuffer::tryDrain(std::size_t maxItems, Sink sink) {
+    // 退避中は、退避したデータより古いバッファ内のデータを取り出し終えてから退避ファイルを読む
+    if (spilling_.load(std::memory_order_acquire) && !hasQueued()) {
+        return restoreSpilled(maxItems, sink);
+    }
+    if (options_.producerLanes) {
+        return tryDrainLanes(maxItems, sink);
+    }
+    if (ring_) {
+        std::size_t drained = 0;
+        // 読み飛ばし対象だけを確保した場合は、データに当たるか空になるまで続ける
+        while (drained == 0) {
+            std::uint64_t begin = 0;
+            std::uint64_t end = 0;
+            claimRecords(maxItems, begin, end);
+            if (begin == end) {
+                return 0;
+            }
+            std::uint64_t position = begin;
+            try {
+                while (position < end) {
+                    // 解放後は他のスレッドが領域を再利用し得るため、次の位置を先に求める
+                    std::uint64_t next = ring_->next(position);
+                    if (ring_->header(position).state.load(std::memory_order_acquire) == RecordRing::kCommitted) {
+                        sink(readRecord(position));
+                        ++drained;
+                    }
+                    ring_->release(position);
+                    position = next;
+                }
+            } catch (...) {
+                // 復元に失敗した場合も残りのレコードは解放してリングを詰まらせない
+                while (position < end) {
+                    std::uint64_t next = ring_->next(position);
+                    ring_->release(position);
+                    position = next;
+                }
+                ring_->reclaim();
+                wake(canPush_, pushWaiters_, true);
+                throw;
+            }
+            // 解放した領域をまとめて回収し、満杯で待つ生産者を起こす
+            ring_->reclaim();
+            wake(canPush_, pushWaiters_, true);
+        }
+        return drained;
+    }
+
+    while (true) {
+        // 公開済みのセルを 1 回の CAS でまとめて確保する
+        std::size_t position = 0;
+        std::size_t claimed = tryClaimPublished(maxItems, position);
+        if (claimed == 0) {
+            return 0;
         }
-        // 現在のスロット位置にヘッダ（サイズ情報）とデータ本体を書き込む
-        slotIndex = writeIndex_;
-        std::size_t offset = slotIndex * slotSize_;
-        std::uint32_t storedSize = static_cast<std::uint32_t>(payloadSize);
-        std::memcpy(mappedView_ + offset, &storedSize, sizeof(storedSize));
-        if (payloadSize > 0) {
-            std::memcpy(mappedView_ + offset + sizeof(storedSize), item.payload.data(), payloadSize);
+        std::size_t drained = 0;
+        for (std::size_t i = 0; i < claimed; ++i) {
+            if (isDiscarded(position + i)) {
+                // 取り消された予約は結果に含めずセルだけ返却する
+                releaseCell(position + i);
+                continue;
+            }
+            try {
+                sink(takeCell(position + i));
+                ++drained;
+            } catch (...) {
+                // 復元に失敗した場合も残りのセルは返却してリングを詰まらせない
+                for (std::size_t rest = i + 1; rest < claimed; ++rest) {
+                    releaseCell(position + rest);
+                }
+                wake(canPush_, pushWaiters_, true);
+                throw;
+            }
+        }
+        // 空いたセル数に関わらず通知は 1 回にまとめる
+        wake(canPush_, pushWaiters_, claimed > 1);
+        if (drained > 0) {
+            return drained;
         }
-        // 次回書き込み用にリングインデックスを更新し、バッファ内のペイロードは破棄する
-        writeIndex_ = (writeIndex_ + 1) % capacity_;
-        item.payload.clear();
     }
-    // 受け取ったアイテムを待ち行列に追加する
-    queue_.push_back(QueueEntry{std::move(item), payloadSize, slotIndex});
-    // データが追加されたことを待機中のポップ側へ通知する
-    canPop_.notify_one();
 }
 
 std::optional<BufferItem> GlobalBuffer::pop() {
-    // 排他制御のためにロックを獲得する
-    std::unique_lock<std::mutex> lock(mutex_);
-    // データが入るか終了するまで待機する
-    canPop_.wait(lock, [this]() { return shutdown_ || !queue_.empty(); });
-    if (queue_.empty()) {
-        // 終了処理などで空の場合は nullopt を返す
-        return std::nullopt;
-    }
-    // 先頭のアイテムを取り出して返す
-    QueueEntry entry = std::move(queue_.front());
-    queue_.pop_front();
-    // 空きができたことを push 側に知らせる
-    canPush_.notify_one();
-    return materializeEntry(std::move(entry));
+    while (true) {
+        // まずはロック無しで取り出しを試みる
+        if (auto item = tryPop()) {
+            return item;
+        }
+        if (shutdown_.load(std::memory_order_acquire)) {
+            // 終了後に取り残しが無ければ nullopt を返す
+            return tryPop();
+        }
+        // 本当に空の場合のみ待機する
+        park(canPop_, popWaiters_, [this]() { return hasReadable(); });
+    }
 }
 
 std::optional<BufferItem> GlobalBuffer::tryPop() {
-    // ノンブロッキング取得のため即座にロックを取る
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (queue_.empty()) {
-        return std::nullopt;
+    // ノンブロッキングで先頭を取り出す（取り消された予約は読み飛ばす）
+    std::optional<BufferItem> result;
+    if (tryDrain(1, [&result](BufferItem item) { result = std::move(item); }) > 0) {
+        checkLowWatermark();
+    }
+    return result;
+}
+
+std::size_t GlobalBuffer::popBatch(std::vector<BufferItem> &out, std::size_t maxItems,
+                                   std::chrono::milliseconds maxWait) {
+    if (maxItems == 0) {
+        return 0;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + maxWait;
+    auto sink = [&out](BufferItem item) { out.push_back(std::move(item)); };
+    bool expired = false;
+    while (true) {
+        // 溜まっている分を 1 回の確保でまとめて取り出す
+        std::size_t popped = tryDrain(maxItems, sink);
+        if (popped > 0) {
+            checkLowWatermark();
+        }
+        if (popped > 0 || expired || shutdown_.load(std::memory_order_acquire)) {
+            return popped;
+        }
+        // 空の場合のみ期限まで待機し、期限切れなら最後にもう一度だけ確認する
+        expired = !park(canPop_, popWaiters_, [this]() { return hasReadable(); }, deadline);
+    }
+}
+
+WriteReservation GlobalBuffer::reserve(std::size_t size, SourceId source) {
+    WriteReservation reservation;
+    if (!sources_.contains(source)) {
+        throw std::invalid_argument("Unknown data source id");
+    }
+    if (ring_) {
+        // 1 レコードに収まる範囲までしか直接書き込めない
+        size = std::min(size, options_.maxPayloadSize);
+        std::size_t length = RecordRing::recordLength(size);
+        if (length > ring_->maxRecordLength()) {
+            throw std::runtime_error("Record size exceeds the capacity of the memory-mapped buffer");
+        }
+        std::uint64_t position = 0;
+        if (!claimRecord(length, position)) {
+            return overflowReservation(size, source);
+        }
+        // 発生元はこの時点で書き込み、レコード内のペイロード領域を書き込み先として渡す
+        RecordHeader &record = ring_->header(position);
+        record.sourceId = source;
+        record.payloadSize = 0;
+        reservation.owner_ = this;
+        reservation.source_ = source;
+        reservation.position_ = position;
+        reservation.data_ = ring_->payload(position);
+        reservation.size_ = size;
+        return reservation;
+    }
+
+    std::size_t position = 0;
+    if (claimCells(1, [size](std::size_t) { return size; }, position) == 0) {
+        return overflowReservation(size, source);
+    }
+    QueueEntry &entry = cells_[position % capacity_].entry;
+    entry.item.source = source;
+    entry.discarded = false;
+    // セルが保持するペイロードを書き込み先にする（小さなデータはセル内の領域へ直接書ける）
+    entry.item.payload.resizeForOverwrite(size);
+    reservation.owner_ = this;
+    reservation.source_ = source;
+    reservation.position_ = position;
+    reservation.data_ = entry.item.payload.data();
+    reservation.size_ = size;
+    return reservation;
+}
+
+void GlobalBuffer::commitReservation(WriteReservation &reservation, std::size_t length) {
+    if (length > reservation.size_) {
+        throw std::out_of_range("Committed length exceeds reserved size");
+    }
+    const auto timestamp = clock_.now();
+    // 通し番号は公開する時点で振る（取り消した予約は番号を消費しない）
+    const std::uint64_t sequence = nextSequence(1);
+    const std::uint64_t sourceSequence = nextSourceSequence(reservation.source_, 1);
+    if (reservation.overflow_) {
+        // 一時領域へ書き込まれたデータは満杯時の扱いに従う（退避する場合のみ内容を写す）
+        BufferItem item;
+        item.source = reservation.source_;
+        item.timestamp = timestamp;
+        item.sequence = sequence;
+        item.sourceSequence = sourceSequence;
+        if (options_.overflowPolicy == OverflowPolicy::Spill) {
+            item.payload.assign(reservation.data_, length);
+        }
+        reservation.owner_ = nullptr;
+        overflow(item);
+        return;
+    }
+    if (reservation.lane_ != 0) {
+        // lane では tail を進めるだけで公開できる
+        Lane &lane = *lanes_[reservation.lane_ - 1];
+        BufferItem &item = lane.items[reservation.position_ % capacity_];
+        item.timestamp = timestamp;
+        item.sequence = sequence;
+        item.sourceSequence = sourceSequence;
+        item.payload.resize(length);
+        // 予約時に計上したバイト数のうち、書き込まなかった分を予算へ戻す
+        releaseBytes(reservation.size_ - length);
+        lane.tail.store(reservation.position_ + 1, std::memory_order_release);
+        reservation.owner_ = nullptr;
+        wake(canPop_, popWaiters_, true);
+        checkLaneHighWatermark(lane, reservation.position_ + 1);
+        return;
+    }
+    std::uint64_t end = reservation.position_ + 1;
+    if (ring_) {
+        RecordHeader &record = ring_->header(reservation.position_);
+        record.sequence = sequence;
+        record.sourceSequence = sourceSequence;
+        record.timestamp = toNanoseconds(timestamp);
+        record.payloadSize = static_cast<std::uint32_t>(length);
+        // 実際に書き込んだ長さへ縮め、後続の確保が無ければ余りをリングへ返す
+        ring_->shrink(reservation.position_, RecordRing::recordLength(length));
+        ring_->commit(reservation.position_);
+        end = reservation.position_ + RecordRing::recordLength(length);
+    } else {
+        Cell &cell = cells_[reservation.position_ % capacity_];
+        cell.entry.item.timestamp = timestamp;
+        cell.entry.item.sequence = sequence;
+        cell.entry.item.sourceSequence = sourceSequence;
+        cell.entry.item.payload.resize(length);
+        cell.bytes = length;
+        releaseBytes(reservation.size_ - length);
+        cell.readers.store(readers_, std::memory_order_relaxed);
+        cell.sequence.store(reservation.position_ + 1, std::memory_order_release);
+    }
+    reservation.owner_ = nullptr;
+    wake(canPop_, popWaiters_, true);
+    checkHighWatermark(reservation.position_, end);
+}
+
+void GlobalBuffer::abortReservation(WriteReservation &reservation) {
+    if (reservation.overflow_) {
+        // 一時領域は誰からも見えない（予算にも計上していない）
+        reservation.owner_ = nullptr;
+        return;
+    }
+    // 予約時に計上したバイト数は全て予算へ戻す
+    releaseBytes(reservation.size_);
+    if (reservation.lane_ != 0) {
+        // lane は tail を進めなければ消費者から見えない（次の予約が同じ位置を使う）
+        reservation.owner_ = nullptr;
+        return;
+    }
+    // 確保した位置は消費者が通過するまで再利用できないため、読み飛ばし印を付けて公開する
+    if (ring_) {
+        ring_->shrink(reservation.position_, RecordRing::recordLength(0));
+        ring_->discard(reservation.position_);
+    } else {
+        Cell &cell = cells_[reservation.position_ % capacity_];
+        cell.entry.discarded = true;
+        cell.bytes = 0;
+        cell.readers.store(readers_, std::memory_order_relaxed);
+        cell.sequence.store(reservation.position_ + 1, std::memory_order_release);
+    }
+    reservation.owner_ = nullptr;
+    wake(canPop_, popWaiters_, true);
+}
+
+std::optional<ItemView> GlobalBuffer::peek(std::chrono::milliseconds maxWait) {
+    if (options_.producerLanes) {
+        throw std::logic_error("peek is not supported with producer lanes");
+    }
+    // 退避したデータはバッファ内に無く、ビューで参照させられない
+    if (options_.overflowPolicy == OverflowPolicy::Spill) {
+        throw std::logic_error("peek is not supported with the spill overflow policy");
+    }
+    // 先頭のデータを 1 件確保してビューを作る（読み飛ばし対象はその場で返却する）
+    auto tryClaimView = [this](ItemView &view) {
+        if (ring_) {
+            while (true) {
+                std::uint64_t begin = 0;
+                std::uint64_t end = 0;
+                claimRecords(1, begin, end);
+                if (begin == end) {
+                    return false;
+                }
+                for (std::uint64_t position = begin; position < end;) {
+                    std::uint64_t next = ring_->next(position);
+                    if (ring_->header(position).state.load(std::memory_order_acquire) == RecordRing::kCommitted) {
+                        // データレコードは範囲の末尾にあり、release まで領域を保持する
+                        view = viewRecord(position);
+                        return true;
+                    }
+                    ring_->release(position);
+                    position = next;
+                }
+                ring_->reclaim();
+                wake(canPush_, pushWaiters_, true);
+            }
+        }
+        std::size_t position = 0;
+        while (tryClaimPublished(1, position) > 0) {
+            if (isDiscarded(position)) {
+                releaseCell(position);
+                wake(canPush_, pushWaiters_, false);
+                continue;
+            }
+            // セルは release されるまで返却しないので、内部領域をそのまま参照させる
+            view = viewCell(position);
+            return true;
+        }
+        return false;
+    };
+
+    const auto deadline = std::chrono::steady_clock::now() + maxWait;
+    bool expired = false;
+    ItemView view;
+    while (!tryClaimView(view)) {
+        if (expired || shutdown_.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+        // 空の場合のみ期限まで待機し、期限切れなら最後にもう一度だけ確認する
+        expired = !park(canPop_, popWaiters_, [this]() { return hasReadable(); }, deadline);
+    }
+    return view;
+}
+
+void GlobalBuffer::release(const ItemView &view) {
+    if (ring_) {
+        ring_->release(view.position);
+        ring_->reclaim();
+        wake(canPush_, pushWaiters_, true);
+    } else {
+        releaseCell(static_cast<std::size_t>(view.position));
+        wake(canPush_, pushWaiters_, false);
+    }
+    checkLowWatermark();
+}
+
+std::size_t GlobalBuffer::lease(ReadLease &lease, std::size_t maxItems, std::chrono::milliseconds maxWait) {
+    lease.release();
+    if (maxItems == 0) {
+        return 0;
+    }
+    const auto deadline = std::chrono::steady_clock::now() + maxWait;
+    bool expired = false;
+    while (true) {
+        std::size_t leased = tryLease(lease, maxItems);
+        if (leased > 0 || expired || shutdown_.load(std::memory_order_acquire)) {
+            return leased;
+        }
+        // 空の場合のみ期限まで待機し、期限切れなら最後にもう一度だけ確認する
+        expired = !park(canPop_, popWaiters_, [this]() { return hasReadable(); }, deadline);
     }
-    // データがあれば先頭を返す
-    QueueEntry entry = std::move(queue_.front());
-    queue_.pop_front();
-    canPush_.notify_one();
-    return materializeEntry(std::move(entry));
 }
 
 void GlobalBuffer::shutdown() {
     // 終了フラグを立て待機スレッドを起こす
-    std::lock_guard<std::mutex> lock(mutex_);
-    shutdown_ = true;
+    shutdown_.store(true, std::memory_order_release);
+    if (options_.shareAcrossProcesses) {
+        // 共有時の待機はファイル上のカウンタで行うため、他のプロセスの待機者もまとめて起こす（起きた側は条件を確認し直す）
+        ring_->wakeSignal(false);
+        ring_->wakeSignal(true);
+    }
+    std::lock_guard<std::mutex> lock(waitMutex_);
     canPush_.notify_all();
     canPop_.notify_all();
 }
 
-BufferItem GlobalBuffer::materializeEntry(QueueEntry entry) const {
-    BufferItem item = std::move(entry.item);
-    if (options_.memoryMapped && entry.slotIndex != QueueEntry::kInvalidSlot) {
-        // メモリマップトファイルから指定スロットのデータを読み戻す
-        std::size_t offset = entry.slotIndex * slotSize_;
-        std::uint32_t storedSize = 0;
-        std::memcpy(&storedSize, mappedView_ + offset, sizeof(storedSize));
-        if (storedSize != entry.payloadSize) {
-            throw std::runtime_error("Memory-mapped payload size mismatch detected");
+Subscription GlobalBuffer::subscribe(SinkMode mode) {
+    if (options_.producerLanes) {
+        throw std::logic_error("Subscriptions are not supported with producer lanes");
+    }
+    if (options_.overflowPolicy == OverflowPolicy::Spill) {
+        throw std::logic_error("Subscriptions are not supported with the spill overflow policy");
+    }
+    if (options_.shareAcrossProcesses) {
+        throw std::logic_error("Subscriptions are not supported with a buffer shared across processes");
+    }
+    std::lock_guard<std::mutex> lock(sinkMutex_);
+    // 各データに設定する読み手の数が途中で変わらないよう、投入開始後の登録は受け付けない
+    if (started_.load(std::memory_order_relaxed)) {
+        throw std::logic_error("Subscriptions must be registered before any data is pushed");
+    }
+    std::size_t index = sinkCount_.load(std::memory_order_relaxed);
+    if (index == kMaxSinks) {
+        throw std::logic_error("Too many subscriptions for GlobalBuffer");
+    }
+    // 引き継いだ未消費データは消費者だけが読み出すため、購読者は新しく投入されるデータから読む
+    SinkState &sink = sinks_[index];
+    sink.cursor.store(ring_ ? ring_->tail() : enqueuePos_.value.load(std::memory_order_relaxed),
+                      std::memory_order_relaxed);
+    sink.lossy.store(mode == SinkMode::Lossy, std::memory_order_relaxed);
+    sink.dropped.store(0, std::memory_order_relaxed);
+    readers_ = static_cast<std::uint32_t>(index + 2);
+    if (ring_) {
+        ring_->setReaders(readers_);
+    }
+    sinkCount_.store(index + 1, std::memory_order_release);
+
+    Subscription subscription;
+    subscription.owner_ = this;
+    subscription.index_ = index;
+    return subscription;
+}
+
+ProducerLane GlobalBuffer::openLane(SourceId source) {
+    if (!sources_.contains(source)) {
+        throw std::invalid_argument("Unknown data source id");
+    }
+    ProducerLane producer;
+    producer.owner_ = this;
+    producer.source_ = source;
+    if (!options_.producerLanes) {
+        // lane を使わない場合は共有リングへの投入口になる
+        return producer;
+    }
+
+    std::lock_guard<std::mutex> lock(laneMutex_);
+    std::size_t count = laneCount_.load(std::memory_order_relaxed);
+    // 閉じられて空になった lane があれば再利用する
+    for (std::size_t index = 0; index < count; ++index) {
+        Lane &lane = *lanes_[index];
+        if (!lane.open.load(std::memory_order_acquire) &&
+            lane.head.load(std::memory_order_acquire) == lane.tail.load(std::memory_order_relaxed)) {
+            lane.cachedHead = lane.head.load(std::memory_order_relaxed);
+            lane.open.store(true, std::memory_order_release);
+            producer.lane_ = index + 1;
+            return producer;
         }
-        item.payload.resize(entry.payloadSize);
-        if (entry.payloadSize > 0) {
-            std::memcpy(item.payload.data(), mappedView_ + offset + sizeof(storedSize), entry.payloadSize);
+    }
+    if (count == kMaxLanes) {
+        throw std::logic_error("Too many producer lanes for GlobalBuffer");
+    }
+    auto lane = std::make_unique<Lane>();
+    lane->items.reset(new BufferItem[capacity_]);
+    lane->open.store(true, std::memory_order_relaxed);
+    lanes_[count] = std::move(lane);
+    // 消費者は laneCount_ を読んでから lane を参照するため、作成を終えてから数を公開する
+    laneCount_.store(count + 1, std::memory_order_release);
+    producer.lane_ = count + 1;
+    return producer;
+}
+
+SourceId GlobalBuffer::registerSource(std::string_view name) {
+    if (options_.shareAcrossProcesses) {
+        // 番号はレコードに入ってプロセス間を渡るため、ファイル上の一覧で全プロセス共通に採番する
+        return ring_->internSource(name, sources_);
+    }
+    bool added = false;
+    SourceId id = sources_.intern(name, &added);
+    if (added && ring_) {
+        // 引き継ぎ後も同じ番号で名前を引けるよう、新しい対応はファイルにも残す
+        ring_->storeSource(id, name);
+    }
+    return id;
+}
+
+std::string_view GlobalBuffer::sourceName(SourceId id) const {
+    if (options_.shareAcrossProcesses && !sources_.contains(id)) {
+        // 他のプロセスが後から登録した番号は、ファイル上の一覧から取り込む
+        ring_->syncSources(sources_);
+    }
+    return sources_.name(id);
+}
+
+std::size_t GlobalBuffer::recoveredCount() const {
+    return ring_ ? ring_->recoveredRecords() : 0;
+}
+
+MappingReport GlobalBuffer::mappingReport() const {
+    return ring_ ? ring_->mappingReport() : MappingReport{};
+}
+
+void GlobalBuffer::acquireConsumer() {
+    if (options_.shareAcrossProcesses) {
+        ring_->acquireConsumer();
+    }
+}
+
+OverflowStats GlobalBuffer::overflowStats() const {
+    OverflowStats stats;
+    stats.droppedNewest = droppedNewest_.load(std::memory_order_relaxed);
+    stats.droppedOldest = droppedOldest_.load(std::memory_order_relaxed);
+    stats.timedOut = timedOut_.load(std::memory_order_relaxed);
+    stats.spilled = spilled_.load(std::memory_order_relaxed);
+    stats.restored = restored_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::size_t GlobalBuffer::addPressureListener(PressureListener listener) {
+    std::lock_guard<std::mutex> lock(pressureMutex_);
+    std::size_t id = nextListenerId_++;
+    pressureListeners_.emplace_back(id, std::move(listener));
+    return id;
+}
+
+void GlobalBuffer::removePressureListener(std::size_t id) {
+    std::lock_guard<std::mutex> lock(pressureMutex_);
+    pressureListeners_.erase(std::remove_if(pressureListeners_.begin(), pressureListeners_.end(),
+                                            [id](const auto &entry) { return entry.first == id; }),
+                             pressureListeners_.end());
+}
+
+double GlobalBuffer::occupancy() const {
+    const double units = ring_ ? static_cast<double>(ring_->dataBytes()) : static_cast<double>(capacity_);
+    double ratio = static_cast<double>(occupied()) / units;
+    if (!ring_ && options_.maxBytes != 0) {
+        ratio = std::max(ratio, static_cast<double>(queuedBytes()) / static_cast<double>(options_.maxBytes));
+    }
+    return std::min(1.0, ratio);
+}
+
+WaitStats GlobalBuffer::waitStats() const {
+    WaitStats stats;
+    stats.spinHits = spinHits_.load(std::memory_order_relaxed);
+    stats.yieldHits = yieldHits_.load(std::memory_order_relaxed);
+    stats.parks = parks_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void GlobalBuffer::validateItem(const BufferItem &item) const {
+    if (!sources_.contains(item.source)) {
+        throw std::invalid_argument("Unknown data source id");
+    }
+    if (ring_) {
+        // 許容サイズを超えるデータは登録できないため例外を送出する
+        if (item.payload.size() > options_.maxPayloadSize) {
+            throw std::runtime_error("Payload size exceeds configured maximum for memory-mapped buffer");
+        }
+        if (RecordRing::recordLength(item.payload.size()) > ring_->maxRecordLength()) {
+            throw std::runtime_error("Record size exceeds the capacity of the memory-mapped buffer");
+        }
+    }
+}
+
+std::uint64_t GlobalBuffer::nextSequence(std::uint64_t count) {
+    if (ring_) {
+        return ring_->nextSequence(count);
+    }
+    return nextSequence_.fetch_add(count, std::memory_order_relaxed);
+}
+
+std::uint64_t GlobalBuffer::nextSourceSequence(SourceId source, std::uint64_t count) {
+    if (ring_) {
+        return ring_->nextSourceSequence(source, count);
+    }
+    return sourceSequences_[source].fetch_add(count, std::memory_order_relaxed);
+}
+
+void GlobalBuffer::stamp(BufferItem &item) {
+    item.sequence = nextSequence(1);
+    item.sourceSequence = nextSourceSequence(item.source, 1);
+}
+
+void GlobalBuffer::stamp(std::vector<BufferItem> &items) {
+    // 全体の番号はまとめて 1 回で、発生元の番号は同じ発生元が続く範囲ごとに 1 回で確保する
+    std::uint64_t sequence = nextSequence(items.size());
+    for (std::size_t begin = 0; begin < items.size();) {
+        const SourceId source = items[begin].source;
+        std::size_t end = begin + 1;
+        while (end < items.size() && items[end].source == source) {
+            ++end;
+        }
+        std::uint64_t sourceSequence = nextSourceSequence(source, end - begin);
+        for (; begin < end; ++begin) {
+            items[begin].sequence = sequence++;
+            items[begin].sourceSequence = sourceSequence++;
+        }
+    }
+}
+
+template <typename SizeOf>
+std::size_t GlobalBuffer::claimCells(std::size_t count, SizeOf sizeOf, std::size_t &position) {
+    markStarted();
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    while (!shutdown_.load(std::memory_order_acquire)) {
+        // 退避中は、退避したデータより先に新しいデータが取り出されないよう全て退避させる
+        if (spilling_.load(std::memory_order_acquire)) {
+            return 0;
+        }
+        // 先にバイト数の予算を確保し、予算に収まった件数だけセルを確保する
+        std::size_t bytes = 0;
+        std::size_t fit = tryClaimBytes(count, sizeOf, bytes);
+        if (fit == 0) {
+            if (evictForBytes()) {
+                continue;
+            }
+            // 予算を使い切っている間は、読み手がデータを返却するか読み飛ばし可能な購読者が遅れるまで待機する
+            const std::size_t first = sizeOf(0);
+            if (!awaitSpace([this, first]() { return hasByteRoom(first) || hasLaggingSink(); }, deadline)) {
+                return 0;
+            }
+            continue;
+        }
+        if (std::size_t claimed = tryClaimCells(fit, position)) {
+            // セルが足りずに確保できなかったアイテムの分は予算へ戻す
+            std::size_t unused = 0;
+            for (std::size_t i = claimed; i < fit; ++i) {
+                unused += sizeOf(i);
+            }
+            releaseBytes(unused);
+            return claimed;
+        }
+        releaseBytes(bytes);
+        // 満杯の間は全ての読み手がセルを返却するか、読み飛ばし可能な購読者が最古のセルに留まるまで待機する
+        if (!awaitSpace([this]() { return hasFreeCell() || hasEvictableSink(); }, deadline)) {
+            return 0;
         }
     }
+    return 0;
+}
+
+std::size_t GlobalBuffer::tryClaimCells(std::size_t count, std::size_t &position) {
+    std::size_t pos = enqueuePos_.value.load(std::memory_order_relaxed);
+    while (true) {
+        std::size_t sequence = cells_[pos % capacity_].sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(sequence - pos);
+        if (diff == 0) {
+            // 先頭が空きなら、続くセルも空いている範囲まで確保対象を広げる
+            std::size_t available = 1;
+            while (available < count &&
+                   cells_[(pos + available) % capacity_].sequence.load(std::memory_order_acquire) ==
+                       pos + available) {
+                ++available;
+            }
+            // CAS で位置を確保する（失敗時は pos が最新値に更新される）
+            if (enqueuePos_.value.compare_exchange_weak(pos, pos + available, std::memory_order_relaxed)) {
+                position = pos;
+                return available;
+            }
+        } else if (diff < 0) {
+            // 1 周前のデータが未消費のままなので満杯
+            // Lossy の購読者だけが保持していれば読み飛ばさせ、DropOldest なら消費者の分を捨ててから再試行する
+            std::size_t oldest = pos - capacity_;
+            if (!evictLossySinks(oldest) &&
+                !(options_.overflowPolicy == OverflowPolicy::DropOldest && evictOldestCell(oldest))) {
+                return 0;
+            }
+            pos = enqueuePos_.value.load(std::memory_order_relaxed);
+        } else {
+            // 他の生産者に先を越されたので最新位置から再試行する
+            pos = enqueuePos_.value.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void GlobalBuffer::publishCell(std::size_t position, BufferItem item) {
+    Cell &cell = cells_[position % capacity_];
+    cell.bytes = item.payload.size();
+    cell.entry = QueueEntry{std::move(item), false};
+    cell.readers.store(readers_, std::memory_order_relaxed);
+    // sequence を進めてセルを公開する
+    cell.sequence.store(position + 1, std::memory_order_release);
+}
+
+std::size_t GlobalBuffer::tryClaimPublished(std::size_t count, std::size_t &position) {
+    std::size_t pos = dequeuePos_.value.load(std::memory_order_relaxed);
+    while (true) {
+        std::size_t sequence = cells_[pos % capacity_].sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(sequence - (pos + 1));
+        if (diff == 0) {
+            // 先頭に続いて公開済みのセルをまとめて確保対象にする
+            std::size_t available = 1;
+            while (available < count &&
+                   cells_[(pos + available) % capacity_].sequence.load(std::memory_order_acquire) ==
+                       pos + available + 1) {
+                ++available;
+            }
+            if (dequeuePos_.value.compare_exchange_weak(pos, pos + available, std::memory_order_relaxed)) {
+                position = pos;
+                return available;
+            }
+        } else if (diff < 0) {
+            // 公開済みのセルが無いので空
+            return 0;
+        } else {
+            pos = dequeuePos_.value.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+BufferItem GlobalBuffer::takeCell(std::size_t position) {
+    // アイテムを取り出してからセルを返却する（購読者がまだ参照している間はコピーで取り出す）
+    Cell &cell = cells_[position % capacity_];
+    BufferItem item;
+    if (cell.readers.load(std::memory_order_acquire) == 1) {
+        item = std::move(cell.entry.item);
+    } else {
+        item = cell.entry.item;
+    }
+    releaseCell(position);
     return item;
 }
 
-void GlobalBuffer::initializeMapping() {
-#ifdef _WIN32
-    // バックファイルを開き、指定サイズに拡張してからマップする
-    openFileHandle();
-    ensureFileSize(mappedSize_);
-    mapView(mappedSize_);
-#else
-    // POSIX システムでは open/ftruncate/mmap で共有領域を確保する
-    fileDescriptor_ = ::open(options_.backingFile.c_str(), O_RDWR | O_CREAT, 0666);
-    if (fileDescriptor_ == -1) {
-        throw std::runtime_error("Failed to open backing file for memory-mapped buffer");
-    }
-    if (::ftruncate(fileDescriptor_, static_cast<off_t>(mappedSize_)) == -1) {
-        ::close(fileDescriptor_);
-        fileDescriptor_ = -1;
-        throw std::runtime_error("Failed to resize backing file for memory-mapped buffer");
-    }
-    void *view = ::mmap(nullptr, mappedSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor_, 0);
-    if (view == MAP_FAILED) {
-        ::close(fileDescriptor_);
-        fileDescriptor_ = -1;
-        throw std::runtime_error("Failed to map backing file into memory");
-    }
-    mappedView_ = static_cast<std::uint8_t *>(view);
-#endif
+bool GlobalBuffer::isDiscarded(std::size_t position) const {
+    return cells_[position % capacity_].entry.discarded;
 }
 
-void GlobalBuffer::releaseMapping() {
-    if (!options_.memoryMapped) {
+void GlobalBuffer::releaseCell(std::size_t position) {
+    // 最後の読み手が返却した時点で、次周回の位置を書き込んで空きセルに戻す
+    Cell &cell = cells_[position % capacity_];
+    if (cell.readers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // 返却後は次周回の生産者が上書きするため、計上したバイト数は先に戻す
+        releaseBytes(cell.bytes);
+        cell.sequence.store(position + capacity_, std::memory_order_release);
+    }
+}
+
+template <typename SizeOf>
+std::size_t GlobalBuffer::tryClaimBytes(std::size_t count, SizeOf sizeOf, std::size_t &bytes) {
+    bytes = 0;
+    if (options_.maxBytes == 0) {
+        return count;
+    }
+    std::size_t used = queuedBytes_.load(std::memory_order_relaxed);
+    while (true) {
+        // 予算に収まる先頭からの件数と合計を求める
+        std::size_t fit = 0;
+        std::size_t total = 0;
+        while (fit < count) {
+            std::size_t size = sizeOf(fit);
+            // 空のときは上限を超える 1 件も受け入れ、大きなデータで詰まらないようにする
+            if (used + total != 0 && used + total + size > options_.maxBytes) {
+                break;
+            }
+            total += size;
+            ++fit;
+        }
+        if (fit == 0) {
+            return 0;
+        }
+        // CAS で使用量を加える（失敗時は used が最新値に更新される）
+        if (queuedBytes_.compare_exchange_weak(used, used + total, std::memory_order_relaxed)) {
+            bytes = total;
+            checkByteHighWatermark(used, used + total);
+            return fit;
+        }
+    }
+}
+
+void GlobalBuffer::releaseBytes(std::size_t bytes) {
+    if (options_.maxBytes == 0 || bytes == 0) {
         return;
     }
-#ifdef _WIN32
-    // Windows ではビュー→マッピング→ファイルの順でクローズする
-    unmapView();
-    closeMappingHandle();
-    closeFileHandle();
-#else
-    // POSIX ではマップ解除とファイルディスクリプタのクローズを行う
-    if (mappedView_ && mappedView_ != MAP_FAILED) {
-        ::munmap(mappedView_, mappedSize_);
+    queuedBytes_.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+bool GlobalBuffer::hasByteRoom(std::size_t size) const {
+    std::size_t used = queuedBytes_.load(std::memory_order_relaxed);
+    return used == 0 || used + size <= options_.maxBytes;
+}
+
+bool GlobalBuffer::evictForBytes() {
+    // 最も遅い Lossy の購読者が消費者と Blocking の購読者より遅れていれば、その位置のデータを読み飛ばさせる
+    std::size_t sinkCount = sinkCount_.load(std::memory_order_acquire);
+    if (sinkCount > 0) {
+        const std::uint64_t slowest = slowestReader();
+        std::uint64_t lagging = slowest;
+        for (std::size_t index = 0; index < sinkCount; ++index) {
+            if (sinks_[index].lossy.load(std::memory_order_acquire)) {
+                lagging = std::min<std::uint64_t>(lagging, sinks_[index].cursor.load(std::memory_order_acquire));
+            }
+        }
+        if (lagging < slowest && evictLossySinks(lagging)) {
+            return true;
+        }
+    }
+    // DropOldest なら、消費者がまだ取り出していない最古のデータを捨てる
+    return options_.overflowPolicy == OverflowPolicy::DropOldest &&
+           evictOldestCell(dequeuePos_.value.load(std::memory_order_relaxed));
+}
+
+bool GlobalBuffer::hasLaggingSink() const {
+    std::size_t sinkCount = sinkCount_.load(std::memory_order_acquire);
+    if (sinkCount == 0) {
+        return false;
     }
-    if (fileDescriptor_ != -1) {
-        ::close(fileDescriptor_);
+    const std::uint64_t slowest = slowestReader();
+    for (std::size_t index = 0; index < sinkCount; ++index) {
+        const SinkState &sink = sinks_[index];
+        if (sink.lossy.load(std::memory_order_acquire) && sink.cursor.load(std::memory_order_acquire) < slowest) {
+            return true;
+        }
     }
-#endif
-    mappedView_ = nullptr;
-    mappedSize_ = 0;
-    writeIndex_ = 0;
+    return false;
+}
+
+bool GlobalBuffer::hasFreeCell() const {
+    std::size_t pos = enqueuePos_.value.load(std::memory_order_relaxed);
+    std::size_t sequence = cells_[pos % capacity_].sequence.load(std::memory_order_acquire);
+    return static_cast<std::ptrdiff_t>(sequence - pos) >= 0;
 }
 
-#ifdef _WIN32
-void GlobalBuffer::openFileHandle() {
-    // Windows API でバックファイルを開く（存在しなければ作成）
-    HANDLE handle = CreateFileA(options_.backingFile.c_str(), GENERIC_READ | GENERIC_WRITE,
-                                FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (handle == INVALID_HANDLE_VALUE) {
-        throw std::runtime_error("Failed to open backing file for memory-mapped buffer");
+bool GlobalBuffer::hasPublishedCell() const {
+    std::size_t pos = dequeuePos_.value.load(std::memory_order_relaxed);
+    std::size_t sequence = cells_[pos % capacity_].sequence.load(std::memory_order_acquire);
+    return static_cast<std::ptrdiff_t>(sequence - (pos + 1)) >= 0;
+}
+
+bool GlobalBuffer::claimRecord(std::size_t length, std::uint64_t &position) {
+    markStarted();
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    while (!shutdown_.load(std::memory_order_acquire)) {
+        // 退避中は、退避したデータより先に新しいデータが取り出されないよう全て退避させる
+        if (spilling_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        if (ring_->tryClaim(length, position)) {
+            return true;
+        }
+        // 最古のレコードを Lossy の購読者が保持しているなら、読み飛ばさせてから再試行する
+        if (evictLossySinks(ring_->head())) {
+            continue;
+        }
+        if (options_.overflowPolicy == OverflowPolicy::DropOldest && evictOldestRecord()) {
+            continue;
+        }
+        // まとめて投入中の未通知レコードで消費者が眠ったままにならないよう、待機前に起こしておく
+        wake(canPop_, popWaiters_, true);
+        // 満杯の間は全ての読み手がレコードを解放するか、読み飛ばし可能な購読者が最古のレコードに留まるまで待機する
+        if (!awaitSpace([this, length]() { return ring_->canClaim(length) || hasEvictableSink(); }, deadline)) {
+            return false;
+        }
     }
-    fileHandle_ = handle;
+    return false;
 }
 
-void GlobalBuffer::ensureFileSize(std::uint64_t size) {
-    // ファイルポインタを移動して指定サイズに切り上げる
-    LARGE_INTEGER li{};
-    li.QuadPart = size;
-    if (SetFilePointerEx(static_cast<HANDLE>(fileHandle_), li, nullptr, FILE_BEGIN) == 0 ||
-        SetEndOfFile(static_cast<HANDLE>(fileHandle_)) == 0) {
-        CloseHandle(static_cast<HANDLE>(fileHandle_));
-        fileHandle_ = reinterpret_cast<void *>(-1);
-        throw std::runtime_error("Failed to resize backing file for memory-mapped buffer");
+void GlobalBuffer::publishRecord(std::uint64_t position, const BufferItem &item) {
+    // ヘッダ・発生元・ペイロードの順に書き込み、最後に状態を公開する
+    RecordHeader &record = ring_->header(position);
+    record.sequence = item.sequence;
+    record.sourceSequence = item.sourceSequence;
+    record.timestamp = toNanoseconds(item.timestamp);
+    record.sourceId = item.source;
+    record.payloadSize = static_cast<std::uint32_t>(item.payload.size());
+    if (!item.payload.empty()) {
+        std::memcpy(ring_->payload(position), item.payload.data(), item.payload.size());
     }
+    ring_->commit(position);
 }
 
-void GlobalBuffer::mapView(std::uint64_t size) {
-    // 指定サイズでファイルマッピングを作成し、全域をマップする
-    HANDLE mapping = CreateFileMappingA(static_cast<HANDLE>(fileHandle_), nullptr, PAGE_READWRITE,
-                                        static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFF), nullptr);
-    if (!mapping) {
-        CloseHandle(static_cast<HANDLE>(fileHandle_));
-        fileHandle_ = reinterpret_cast<void *>(-1);
-        throw std::runtime_error("Failed to create file mapping for memory-mapped buffer");
+BufferItem GlobalBuffer::readRecord(std::uint64_t position) const {
+    const RecordHeader &record = ring_->header(position);
+    const std::uint8_t *payload = ring_->payload(position);
+    BufferItem item;
+    item.source = record.sourceId;
+    item.timestamp = fromNanoseconds(record.timestamp);
+    item.payload.assign(payload, record.payloadSize);
+    item.sequence = record.sequence;
+    item.sourceSequence = record.sourceSequence;
+    return item;
+}
+
+template <typename SizeOf>
+std::size_t GlobalBuffer::claimLaneSlots(Lane &lane, std::size_t count, SizeOf sizeOf, std::size_t &position) {
+    // tail は自分しか更新しないため、読み込みだけで位置が決まる
+    const std::size_t tail = lane.tail.load(std::memory_order_relaxed);
+    auto deadline = std::chrono::steady_clock::time_point::max();
+    while (!shutdown_.load(std::memory_order_acquire)) {
+        // 退避中は、退避したデータより先に新しいデータが取り出されないよう全て退避させる
+        if (spilling_.load(std::memory_order_acquire)) {
+            return 0;
+        }
+        std::size_t free = capacity_ - (tail - lane.cachedHead);
+        if (free == 0) {
+            // キャッシュした head で満杯に見える場合だけ消費者の位置を読み直す
+            lane.cachedHead = lane.head.load(std::memory_order_acquire);
+            free = capacity_ - (tail - lane.cachedHead);
+        }
+        if (free > 0) {
+            // 空いている範囲のうち、バイト数の予算に収まる件数だけ確保する
+            std::size_t bytes = 0;
+            if (std::size_t fit = tryClaimBytes(std::min(free, count), sizeOf, bytes)) {
+                position = tail;
+                return fit;
+            }
+            // 予算は全ての lane と共有リングで共有するため、DropOldest では自分の lane の先頭か共有リングの最古を捨てる
+            if (options_.overflowPolicy == OverflowPolicy::DropOldest && (evictLaneHead(lane, tail) || evictForBytes())) {
+                continue;
+            }
+            wake(canPop_, popWaiters_, true);
+            const std::size_t first = sizeOf(0);
+            if (!awaitSpace([this, first]() { return hasByteRoom(first); }, deadline)) {
+                return 0;
+            }
+            continue;
+        }
+        if (options_.overflowPolicy == OverflowPolicy::DropOldest && evictLaneHead(lane, tail)) {
+            continue;
+        }
+        // 満杯の間は消費者がこの lane から取り出すまで待機する
+        wake(canPop_, popWaiters_, true);
+        if (!awaitSpace([this, &lane, tail]() { return tail - lane.head.load(std::memory_order_acquire) < capacity_; },
+                        deadline)) {
+            return 0;
+        }
     }
-    mappingHandle_ = mapping;
-    void *view = MapViewOfFile(mappingHandle_, FILE_MAP_ALL_ACCESS, 0, 0, size);
-    if (!view) {
-        CloseHandle(mappingHandle_);
-        mappingHandle_ = nullptr;
-        CloseHandle(static_cast<HANDLE>(fileHandle_));
-        fileHandle_ = reinterpret_cast<void *>(-1);
-        throw std::runtime_error("Failed to map backing file into memory");
+    return 0;
+}
+
+bool GlobalBuffer::evictLaneHead(Lane &lane, std::size_t tail) {
+    // 消費者が取り出し中なら、消費者自身が空きを作って生産者を起こす
+    std::unique_lock<std::mutex> lock(laneConsumerMutex_, std::try_to_lock);
+    if (!lock) {
+        return false;
+    }
+    std::size_t head = lane.head.load(std::memory_order_relaxed);
+    if (head == tail) {
+        return false;
     }
-    mappedView_ = static_cast<std::uint8_t *>(view);
+    BufferItem &item = lane.items[head % capacity_];
+    releaseBytes(item.payload.size());
+    item = BufferItem{};
+    lane.head.store(head + 1, std::memory_order_release);
+    // 消費者がキャッシュした tail を head が追い越さないよう、消費者に代わって更新しておく
+    lane.cachedTail = tail;
+    droppedOldest_.fetch_add(1, std::memory_order_relaxed);
+    return true;
 }
 
-void GlobalBuffer::unmapView() {
-    // マップ済みビューを解放する
-    if (mappedView_) {
-        UnmapViewOfFile(mappedView_);
-        mappedView_ = nullptr;
+void GlobalBuffer::lanePush(const ProducerLane &producer, BufferItem item) {
+    if (producer.lane_ == 0) {
+        push(std::move(item));
+        return;
     }
+    validateItem(item);
+    stamp(item);
+    Lane &lane = *lanes_[producer.lane_ - 1];
+    std::size_t position = 0;
+    if (claimLaneSlots(lane, 1, [&item](std::size_t) { return item.payload.size(); }, position) == 0) {
+        overflow(item);
+        return;
+    }
+    lane.items[position % capacity_] = std::move(item);
+    lane.tail.store(position + 1, std::memory_order_release);
+    wake(canPop_, popWaiters_, true);
+    checkLaneHighWatermark(lane, position + 1);
 }
 
-void GlobalBuffer::closeMappingHandle() {
-    // ファイルマッピングハンドルをクローズする
-    if (mappingHandle_) {
-        CloseHandle(static_cast<HANDLE>(mappingHandle_));
-        mappingHandle_ = nullptr;
+void GlobalBuffer::lanePushBatch(const ProducerLane &producer, std::vector<BufferItem> &items) {
+    if (producer.lane_ == 0) {
+        pushBatch(items);
+        return;
+    }
+    for (const auto &item : items) {
+        validateItem(item);
     }
+    stamp(items);
+    Lane &lane = *lanes_[producer.lane_ - 1];
+    std::size_t next = 0;
+    while (next < items.size()) {
+        // 空いている分をまとめて書き込み、tail の更新と通知は 1 回にまとめる
+        std::size_t position = 0;
+        std::size_t claimed = claimLaneSlots(
+            lane, items.size() - next, [&items, next](std::size_t i) { return items[next + i].payload.size(); },
+            position);
+        if (claimed == 0) {
+            break;
+        }
+        for (std::size_t i = 0; i < claimed; ++i) {
+            lane.items[(position + i) % capacity_] = std::move(items[next + i]);
+        }
+        lane.tail.store(position + claimed, std::memory_order_release);
+        next += claimed;
+        wake(canPop_, popWaiters_, true);
+        checkLaneHighWatermark(lane, position + claimed);
+    }
+    for (; next < items.size(); ++next) {
+        overflow(items[next]);
+    }
+    items.clear();
 }
 
-void GlobalBuffer::closeFileHandle() {
-    // 元のファイルハンドルをクローズする
-    if (fileHandle_ != reinterpret_cast<void *>(-1)) {
-        CloseHandle(static_cast<HANDLE>(fileHandle_));
-        fileHandle_ = reinterpret_cast<void *>(-1);
+WriteReservation GlobalBuffer::laneReserve(const ProducerLane &producer, std::size_t size) {
+    if (producer.lane_ == 0) {
+        return reserve(size, producer.source_);
+    }
+    WriteReservation reservation;
+    Lane &lane = *lanes_[producer.lane_ - 1];
+    std::size_t position = 0;
+    if (claimLaneSlots(lane, 1, [size](std::size_t) { return size; }, position) == 0) {
+        return overflowReservation(size, producer.source_);
+    }
+    // lane が保持するペイロードを書き込み先にする
+    BufferItem &item = lane.items[position % capacity_];
+    item.source = producer.source_;
+    item.payload.resizeForOverwrite(size);
+    reservation.owner_ = this;
+    reservation.source_ = producer.source_;
+    reservation.lane_ = producer.lane_;
+    reservation.position_ = position;
+    reservation.data_ = item.payload.data();
+    reservation.size_ = size;
+    return reservation;
+}
+
+void GlobalBuffer::closeLane(ProducerLane &producer) noexcept {
+    if (producer.lane_ != 0) {
+        lanes_[producer.lane_ - 1]->open.store(false, std::memory_order_release);
+    }
+}
+
+template <typename Sink>
+std::size_t GlobalBuffer::tryDrainLanes(std::size_t maxItems, Sink sink) {
+    // lane は単一消費者を前提とするため、取り出しは 1 スレッドずつ行う
+    std::lock_guard<std::mutex> lock(laneConsumerMutex_);
+    // 入力は各 lane と、投入口を介さずに投入されたデータの入る共有リング（末尾）
+    const std::size_t inputs = laneCount_.load(std::memory_order_acquire) + 1;
+    std::size_t drained = 0;
+    if (options_.laneOrder == LaneOrder::RoundRobin) {
+        // 全ての入力が続けて空になるまで、入力を順に巡って 1 件ずつ取り出す
+        std::size_t idle = 0;
+        while (drained < maxItems && idle < inputs) {
+            std::size_t input = nextInput_ % inputs;
+            nextInput_ = input + 1;
+            if (takeInput(input, inputs, sink)) {
+                ++drained;
+                idle = 0;
+            } else {
+                ++idle;
+            }
+        }
+    } else {
+        while (drained < maxItems) {
+            // 各入力の先頭のうち受信時刻が最も古いものを選ぶ
+            std::size_t oldest = inputs;
+            std::chrono::system_clock::time_point oldestTime;
+            for (std::size_t input = 0; input < inputs; ++input) {
+                const BufferItem *head = peekInput(input, inputs);
+                if (head && (oldest == inputs || head->timestamp < oldestTime)) {
+                    oldest = input;
+                    oldestTime = head->timestamp;
+                }
+            }
+            if (oldest == inputs) {
+                break;
+            }
+            takeInput(oldest, inputs, sink);
+            ++drained;
+        }
+    }
+    if (drained > 0) {
+        wake(canPush_, pushWaiters_, true);
+    }
+    return drained;
+}
+
+const BufferItem *GlobalBuffer::peekInput(std::size_t input, std::size_t inputs) {
+    if (input + 1 < inputs) {
+        Lane &lane = *lanes_[input];
+        std::size_t head = lane.head.load(std::memory_order_relaxed);
+        if (head == lane.cachedTail) {
+            lane.cachedTail = lane.tail.load(std::memory_order_acquire);
+            if (head == lane.cachedTail) {
+                return nullptr;
+            }
+        }
+        return &lane.items[head % capacity_];
+    }
+    // 共有リングも消費者は 1 スレッドだけなので、確保せずに先頭を参照できる
+    while (hasPublishedCell()) {
+        std::size_t position = dequeuePos_.value.load(std::memory_order_relaxed);
+        if (!isDiscarded(position)) {
+            return &cells_[position % capacity_].entry.item;
+        }
+        // 取り消された予約はこの場で返却する
+        tryClaimPublished(1, position);
+        releaseCell(position);
+    }
+    return nullptr;
+}
+
+template <typename Sink>
+bool GlobalBuffer::takeInput(std::size_t input, std::size_t inputs, Sink &sink) {
+    if (!peekInput(input, inputs)) {
+        return false;
+    }
+    if (input + 1 < inputs) {
+        // 取り出してから head を進め、sink が例外を投げても同じアイテムを重複して渡さない
+        Lane &lane = *lanes_[input];
+        std::size_t head = lane.head.load(std::memory_order_relaxed);
+        BufferItem item = std::move(lane.items[head % capacity_]);
+        releaseBytes(item.payload.size());
+        lane.head.store(head + 1, std::memory_order_release);
+        sink(std::move(item));
+        return true;
+    }
+    std::size_t position = 0;
+    tryClaimPublished(1, position);
+    sink(takeCell(position));
+    return true;
+}
+
+void GlobalBuffer::markStarted() {
+    if (started_.load(std::memory_order_acquire)) {
+        return;
+    }
+    // 登録中の購読者が読み手の数へ反映されてから投入を始める
+    std::lock_guard<std::mutex> lock(sinkMutex_);
+    started_.store(true, std::memory_order_release);
+}
+
+ItemView GlobalBuffer::viewItem(const BufferItem &item, std::uint64_t position) {
+    ItemView view;
+    view.source = item.source;
+    view.timestamp = item.timestamp;
+    view.payload = item.payload.data();
+    view.payloadSize = item.payload.size();
+    view.sequence = item.sequence;
+    view.sourceSequence = item.sourceSequence;
+    view.position = position;
+    return view;
+}
+
+ItemView GlobalBuffer::viewCell(std::size_t position) const {
+    return viewItem(cells_[position % capacity_].entry.item, position);
+}
+
+ItemView GlobalBuffer::viewRecord(std::uint64_t position) const {
+    const RecordHeader &record = ring_->header(position);
+    ItemView view;
+    view.source = record.sourceId;
+    view.timestamp = fromNanoseconds(record.timestamp);
+    view.payload = ring_->payload(position);
+    view.payloadSize = record.payloadSize;
+    view.sequence = record.sequence;
+    view.sourceSequence = record.sourceSequence;
+    view.position = position;
+    return view;
+}
+
+void GlobalBuffer::releaseRange(std::uint64_t begin, std::uint64_t end) {
+    if (ring_) {
+        for (std::uint64_t position = begin; position < end;) {
+            // 解放後は他のスレッドが領域を再利用し得るため、次の位置を先に求める
+            std::uint64_t next = ring_->next(position);
+            ring_->release(position);
+            position = next;
+        }
+        ring_->reclaim();
+        return;
+    }
+    for (std::uint64_t position = begin; position < end; ++position) {
+        releaseCell(static_cast<std::size_t>(position));
+    }
+}
+
+std::size_t GlobalBuffer::tryReadSink(SinkState &sink, std::size_t maxItems, std::vector<ItemView> &out,
+                                      std::uint64_t &begin, std::uint64_t &end) {
+    while (true) {
+        std::uint64_t first = 0;
+        std::uint64_t last = 0;
+        if (ring_) {
+            std::lock_guard<std::mutex> lock(sink.claimMutex);
+            ring_->tryClaimRead(sink.cursor, maxItems, first, last);
+        } else {
+            // 購読者の位置から公開済みのセルをまとめて確保する（生産者による読み飛ばしと CAS で競合する）
+            std::uint64_t cursor = sink.cursor.load(std::memory_order_acquire);
+            while (true) {
+                std::uint64_t available = 0;
+                while (available < maxItems &&
+                       cells_[(cursor + available) % capacity_].sequence.load(std::memory_order_acquire) ==
+                           cursor + available + 1) {
+                    ++available;
+                }
+                if (available == 0) {
+                    break;
+                }
+                if (sink.cursor.compare_exchange_weak(cursor, cursor + available, std::memory_order_acq_rel)) {
+                    first = cursor;
+                    last = cursor + available;
+                    break;
+                }
+            }
+        }
+        if (first == last) {
+            return 0;
+        }
+        // ビューの追加に失敗しても返却できるよう、確保した範囲を先に記録する
+        begin = first;
+        end = last;
+        std::size_t read = 0;
+        if (ring_) {
+            for (std::uint64_t position = first; position < last; position = ring_->next(position)) {
+                if (ring_->header(position).state.load(std::memory_order_acquire) == RecordRing::kCommitted) {
+                    out.push_back(viewRecord(position));
+                    ++read;
+                }
+            }
+        } else {
+            for (std::uint64_t position = first; position < last; ++position) {
+                if (!isDiscarded(static_cast<std::size_t>(position))) {
+                    out.push_back(viewCell(static_cast<std::size_t>(position)));
+                    ++read;
+                }
+            }
+        }
+        if (read > 0) {
+            return read;
+        }
+        // 読み飛ばし対象だけを確保した場合は返却して続ける
+        releaseRange(first, last);
+        begin = end = 0;
+        wake(canPush_, pushWaiters_, true);
+    }
+}
+
+bool GlobalBuffer::hasSinkReadable(const SinkState &sink) const {
+    if (ring_) {
+        std::lock_guard<std::mutex> lock(sink.claimMutex);
+        return ring_->hasReadable(sink.cursor);
+    }
+    std::uint64_t cursor = sink.cursor.load(std::memory_order_acquire);
+    return cells_[cursor % capacity_].sequence.load(std::memory_order_acquire) == cursor + 1;
+}
+
+bool GlobalBuffer::evictLossySinks(std::uint64_t oldest) {
+    bool evicted = false;
+    std::size_t count = sinkCount_.load(std::memory_order_acquire);
+    for (std::size_t index = 0; index < count; ++index) {
+        SinkState &sink = sinks_[index];
+        if (!sink.lossy.load(std::memory_order_acquire) || sink.cursor.load(std::memory_order_acquire) != oldest) {
+            continue;
+        }
+        if (ring_) {
+            // 購読者が読み出し中なら、購読者自身が先へ進むので読み飛ばさせない
+            std::unique_lock<std::mutex> lock(sink.claimMutex, std::try_to_lock);
+            if (!lock || sink.cursor.load(std::memory_order_relaxed) != oldest) {
+                continue;
+            }
+            // 購読者の代わりに先頭のデータレコード 1 件（と手前の読み飛ばし対象）を確保して返却する
+            std::uint64_t begin = 0;
+            std::uint64_t end = 0;
+            std::size_t records = ring_->tryClaimRead(sink.cursor, 1, begin, end);
+            lock.unlock();
+            if (begin == end) {
+                continue;
+            }
+            sink.dropped.fetch_add(records, std::memory_order_relaxed);
+            releaseRange(begin, end);
+            evicted = true;
+            continue;
+        }
+        // 公開済みのセルだけを、購読者の位置を 1 つ進めて購読者の代わりに返却する
+        std::size_t position = static_cast<std::size_t>(oldest);
+        if (cells_[position % capacity_].sequence.load(std::memory_order_acquire) != position + 1) {
+            continue;
+        }
+        std::uint64_t expected = oldest;
+        if (sink.cursor.compare_exchange_strong(expected, oldest + 1, std::memory_order_acq_rel)) {
+            if (!isDiscarded(position)) {
+                sink.dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            releaseCell(position);
+            evicted = true;
+        }
+    }
+    return evicted;
+}
+
+bool GlobalBuffer::hasEvictableSink() const {
+    std::size_t count = sinkCount_.load(std::memory_order_acquire);
+    if (count == 0) {
+        return false;
+    }
+    std::uint64_t oldest = ring_ ? ring_->head() : enqueuePos_.value.load(std::memory_order_relaxed) - capacity_;
+    for (std::size_t index = 0; index < count; ++index) {
+        const SinkState &sink = sinks_[index];
+        if (!sink.lossy.load(std::memory_order_acquire)) {
+            continue;
+        }
+        if (ring_) {
+            // 購読者が読み出し中なら、購読者自身が先へ進んで生産者を起こす
+            std::unique_lock<std::mutex> lock(sink.claimMutex, std::try_to_lock);
+            if (lock && sink.cursor.load(std::memory_order_relaxed) == oldest && ring_->hasReadable(sink.cursor)) {
+                return true;
+            }
+            continue;
+        }
+        if (sink.cursor.load(std::memory_order_acquire) == oldest && hasSinkReadable(sink)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t GlobalBuffer::readSink(Subscription &subscription, std::vector<ItemView> &out, std::size_t maxItems,
+                                   std::chrono::milliseconds maxWait) {
+    // 前回受け取った範囲を返却してから次を読む
+    releaseSink(subscription);
+    if (maxItems == 0) {
+        return 0;
+    }
+    SinkState &sink = sinks_[subscription.index_];
+    const auto deadline = std::chrono::steady_clock::now() + maxWait;
+    bool expired = false;
+    while (true) {
+        std::size_t read = tryReadSink(sink, maxItems, out, subscription.begin_, subscription.end_);
+        if (read > 0 || expired || shutdown_.load(std::memory_order_acquire)) {
+            return read;
+        }
+        // 空の場合のみ期限まで待機し、期限切れなら最後にもう一度だけ確認する
+        expired = !park(canPop_, popWaiters_, [this, &sink]() { return hasSinkReadable(sink); }, deadline);
+    }
+}
+
+void GlobalBuffer::releaseSink(Subscription &subscription) {
+    if (subscription.begin_ == subscription.end_) {
+        return;
+    }
+    releaseRange(subscription.begin_, subscription.end_);
+    subscription.begin_ = subscription.end_ = 0;
+    wake(canPush_, pushWaiters_, true);
+    checkLowWatermark();
+}
+
+std::size_t GlobalBuffer::tryLease(ReadLease &lease, std::size_t maxItems) {
+    // lane の k-way マージと退避ファイルの読み出しは取り出し順の決定に先頭の移動を伴うため、lease へ移して参照させる
+    if (options_.producerLanes || (spilling_.load(std::memory_order_acquire) && !hasQueued())) {
+        lease.owner_ = this;
+        std::size_t drained = tryDrain(maxItems, [&lease](BufferItem item) { lease.owned_.push_back(std::move(item)); });
+        for (const BufferItem &item : lease.owned_) {
+            lease.views_.push_back(viewItem(item, 0));
+        }
+        if (drained > 0) {
+            checkLowWatermark();
+        }
+        return drained;
+    }
+    while (true) {
+        // 公開済みのデータをまとめて確保し、返却するまでの範囲を先に記録してからビューを作る
+        std::uint64_t begin = 0;
+        std::uint64_t end = 0;
+        if (ring_) {
+            claimRecords(maxItems, begin, end);
+        } else {
+            std::size_t position = 0;
+            std::size_t claimed = tryClaimPublished(maxItems, position);
+            begin = position;
+            end = position + claimed;
+        }
+        if (begin == end) {
+            return 0;
+        }
+        lease.owner_ = this;
+        lease.begin_ = begin;
+        lease.end_ = end;
+        if (ring_) {
+            for (std::uint64_t position = begin; position < end; position = ring_->next(position)) {
+                if (ring_->header(position).state.load(std::memory_order_acquire) == RecordRing::kCommitted) {
+                    lease.views_.push_back(viewRecord(position));
+                }
+            }
+        } else {
+            for (std::uint64_t position = begin; position < end; ++position) {
+                if (!isDiscarded(static_cast<std::size_t>(position))) {
+                    lease.views_.push_back(viewCell(static_cast<std::size_t>(position)));
+                }
+            }
+        }
+        if (!lease.views_.empty()) {
+            return lease.views_.size();
+        }
+        // 読み飛ばし対象だけを確保した場合は返却し、データに当たるか空になるまで続ける
+        releaseLease(lease);
+    }
+}
+
+void GlobalBuffer::releaseLease(ReadLease &lease) {
+    lease.views_.clear();
+    lease.owned_.clear();
+    if (lease.begin_ != lease.end_) {
+        releaseRange(lease.begin_, lease.end_);
+        lease.begin_ = lease.end_ = 0;
+        wake(canPush_, pushWaiters_, true);
+        checkLowWatermark();
+    }
+}
+
+void GlobalBuffer::closeSink(Subscription &subscription) noexcept {
+    releaseSink(subscription);
+    // 以降に届くデータは誰も読まないため、満杯時に生産者が読み飛ばさせて先へ進めるようにする
+    sinks_[subscription.index_].lossy.store(true, std::memory_order_release);
+}
+
+std::uint64_t GlobalBuffer::sinkDropped(std::size_t index) const {
+    return sinks_[index].dropped.load(std::memory_order_relaxed);
+}
+
+bool GlobalBuffer::hasReadable() const {
+    return spilling_.load(std::memory_order_acquire) || hasQueued();
+}
+
+bool GlobalBuffer::hasQueued() const {
+    if (ring_) {
+        return ring_->hasReadable();
+    }
+    std::size_t count = laneCount_.load(std::memory_order_acquire);
+    for (std::size_t index = 0; index < count; ++index) {
+        const Lane &lane = *lanes_[index];
+        if (lane.head.load(std::memory_order_acquire) != lane.tail.load(std::memory_order_acquire)) {
+            return true;
+        }
+    }
+    return hasPublishedCell();
+}
+
+std::uint64_t GlobalBuffer::occupied() const {
+    if (ring_) {
+        // head は全ての読み手が処理を終えた位置なので、購読者の遅れも含まれる
+        return ring_->tail() - ring_->head();
+    }
+    // 共有リングは、消費者と Blocking の購読者のうち最も遅い読み手からの件数で求める
+    std::uint64_t oldest = slowestReader();
+    std::uint64_t newest = enqueuePos_.value.load(std::memory_order_acquire);
+    std::uint64_t used = newest > oldest ? newest - oldest : 0;
+    std::size_t laneCount = laneCount_.load(std::memory_order_acquire);
+    for (std::size_t index = 0; index < laneCount; ++index) {
+        const Lane &lane = *lanes_[index];
+        std::size_t head = lane.head.load(std::memory_order_acquire);
+        std::size_t tail = lane.tail.load(std::memory_order_acquire);
+        used = std::max<std::uint64_t>(used, tail > head ? tail - head : 0);
+    }
+    return used;
+}
+
+std::uint64_t GlobalBuffer::slowestReader() const {
+    // Lossy の購読者は満杯時に読み飛ばされるため、遅れていても数えない
+    std::uint64_t oldest = dequeuePos_.value.load(std::memory_order_acquire);
+    std::size_t sinkCount = sinkCount_.load(std::memory_order_acquire);
+    for (std::size_t index = 0; index < sinkCount; ++index) {
+        if (!sinks_[index].lossy.load(std::memory_order_relaxed)) {
+            oldest = std::min<std::uint64_t>(oldest, sinks_[index].cursor.load(std::memory_order_acquire));
+        }
+    }
+    return oldest;
+}
+
+void GlobalBuffer::checkHighWatermark(std::uint64_t begin, std::uint64_t end) {
+    if (highMark_ == 0 || pressured_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // 消費者側のカーソルを毎回読まないよう、投入位置が確認間隔の境界を跨いだときだけ確認する
+    if (begin / pressureStride_ == end / pressureStride_) {
+        return;
+    }
+    if (occupied() >= highMark_) {
+        setPressure(true);
+    }
+}
+
+void GlobalBuffer::checkLaneHighWatermark(Lane &lane, std::size_t end) {
+    if (highMark_ == 0 || pressured_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // キャッシュした head は実際より古い（多めに見積もる）ため、達して見える場合だけ読み直す
+    if (end - lane.cachedHead < highMark_) {
+        return;
+    }
+    lane.cachedHead = lane.head.load(std::memory_order_acquire);
+    if (end - lane.cachedHead >= highMark_) {
+        setPressure(true);
+    }
+}
+
+void GlobalBuffer::checkByteHighWatermark(std::size_t before, std::size_t after) {
+    if (byteHighMark_ == 0 || pressured_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    // 件数と同様に、使用量が確認間隔の境界を跨いだときだけ判定する
+    if (before / byteStride_ == after / byteStride_) {
+        return;
+    }
+    if (after >= byteHighMark_) {
+        setPressure(true);
+    }
+}
+
+void GlobalBuffer::checkLowWatermark() {
+    // 退避中のデータが残っている間は、バッファが空いても高水位のままにする
+    if (!pressured_.load(std::memory_order_relaxed) || spilling_.load(std::memory_order_acquire)) {
+        return;
+    }
+    // 件数とバイト数の両方が低水位まで下がってから解除する
+    if (occupied() <= lowMark_ && (byteHighMark_ == 0 || queuedBytes() <= byteLowMark_)) {
+        setPressure(false);
+    }
+}
+
+void GlobalBuffer::setPressure(bool pressured) {
+    // 状態の切り替えと通知を直列化し、通知先が最後に受け取る値を実際の状態と一致させる
+    std::lock_guard<std::mutex> lock(pressureMutex_);
+    if (pressured_.load(std::memory_order_relaxed) == pressured) {
+        return;
+    }
+    pressured_.store(pressured, std::memory_order_release);
+    for (const auto &entry : pressureListeners_) {
+        entry.second(pressured);
+    }
+}
+
+template <typename Predicate>
+bool GlobalBuffer::awaitSpace(Predicate ready, std::chrono::steady_clock::time_point &deadline) {
+    switch (options_.overflowPolicy) {
+    case OverflowPolicy::DropNewest:
+    case OverflowPolicy::Spill:
+        return false;
+    case OverflowPolicy::BlockWithTimeout:
+        // 期限は初めて待機するときに決める（空きがある間は時刻を読まない）
+        if (deadline == std::chrono::steady_clock::time_point::max()) {
+            deadline = std::chrono::steady_clock::now() + options_.overflowTimeout;
+        }
+        break;
+    case OverflowPolicy::Block:
+    case OverflowPolicy::DropOldest:
+        // DropOldest でも、最古のデータを消費者や購読者が処理中なら空くまで待つ
+        break;
+    }
+    return park(canPush_, pushWaiters_, ready, deadline);
+}
+
+void GlobalBuffer::overflow(const BufferItem &item) {
+    // 終了中に投入されたデータは従来どおり黙って捨てる
+    if (shutdown_.load(std::memory_order_acquire)) {
+        return;
+    }
+    switch (options_.overflowPolicy) {
+    case OverflowPolicy::Spill:
+        spill(item);
+        break;
+    case OverflowPolicy::BlockWithTimeout:
+        timedOut_.fetch_add(1, std::memory_order_relaxed);
+        break;
+    default:
+        droppedNewest_.fetch_add(1, std::memory_order_relaxed);
+        break;
+    }
+}
+
+WriteReservation GlobalBuffer::overflowReservation(std::size_t size, SourceId source) {
+    WriteReservation reservation;
+    if (shutdown_.load(std::memory_order_acquire)) {
+        // 終了中は無効な予約を返す
+        return reservation;
+    }
+    // 呼び出し元がデータを読み進められるよう、スレッドごとの一時領域を書き込み先として渡す
+    // （1 スレッドが同時に保持する予約は 1 つまでのため、スレッドごとに 1 つあれば足りる）
+    thread_local Payload scratch;
+    scratch.resizeForOverwrite(size);
+    reservation.owner_ = this;
+    reservation.overflow_ = true;
+    reservation.source_ = source;
+    reservation.data_ = scratch.data();
+    reservation.size_ = size;
+    return reservation;
+}
+
+void GlobalBuffer::spill(const BufferItem &item) {
+    {
+        std::lock_guard<std::mutex> lock(spillMutex_);
+        if (!spill_) {
+            spill_ = std::make_unique<SpillFile>(options_.spillFile);
+        }
+        spill_->append(item);
+        spilling_.store(true, std::memory_order_release);
+    }
+    spilled_.fetch_add(1, std::memory_order_relaxed);
+    wake(canPop_, popWaiters_, true);
+    // 退避が始まるほど溢れているなら、占有率に関わらず高水位として扱う
+    if (highMark_ != 0 && !pressured_.load(std::memory_order_acquire)) {
+        setPressure(true);
+    }
+}
+
+template <typename Sink>
+std::size_t GlobalBuffer::restoreSpilled(std::size_t maxItems, Sink &sink) {
+    std::lock_guard<std::mutex> lock(spillMutex_);
+    std::size_t restored = 0;
+    BufferItem item;
+    while (restored < maxItems && spill_->read(item)) {
+        sink(std::move(item));
+        ++restored;
+    }
+    restored_.fetch_add(restored, std::memory_order_relaxed);
+    // 全て渡し終えたら、以降の投入はバッファへ戻す
+    if (spill_->empty()) {
+        spilling_.store(false, std::memory_order_release);
+    }
+    return restored;
+}
+
+bool GlobalBuffer::evictOldestCell(std::size_t oldest) {
+    // lane 利用時の共有リングは消費者が確保せずに先頭を参照するため、取り出し中でない場合に限る
+    std::unique_lock<std::mutex> lock(laneConsumerMutex_, std::defer_lock);
+    if (options_.producerLanes && !lock.try_lock()) {
+        return false;
+    }
+    // 公開済みで購読者が全て処理を終えたセルに限る（購読者が保持していると、消費者の分を捨てても空かない）
+    Cell &cell = cells_[oldest % capacity_];
+    if (cell.sequence.load(std::memory_order_acquire) != oldest + 1 ||
+        cell.readers.load(std::memory_order_acquire) != 1) {
+        return false;
+    }
+    // 消費者の位置を進めて、消費者の代わりに返却する（消費者が先に確保していれば CAS が失敗する）
+    std::size_t expected = oldest;
+    if (!dequeuePos_.value.compare_exchange_strong(expected, oldest + 1, std::memory_order_relaxed)) {
+        return false;
+    }
+    if (!isDiscarded(oldest)) {
+        droppedOldest_.fetch_add(1, std::memory_order_relaxed);
+    }
+    releaseCell(oldest);
+    return true;
+}
+
+bool GlobalBuffer::evictOldestRecord() {
+    std::uint64_t begin = 0;
+    std::uint64_t end = 0;
+    std::size_t records = 0;
+    {
+        // 消費者が確保中なら、消費者自身が領域を空けて生産者を起こす
+        std::unique_lock<std::mutex> lock(readMutex_, std::try_to_lock);
+        if (!lock) {
+            return false;
+        }
+        // 最古のレコードを消費者がまだ確保しておらず、購読者が全て処理を終えている場合に限る
+        std::uint64_t head = ring_->head();
+        if (ring_->readCursor() != head || !ring_->hasReadable() ||
+            ring_->header(head).readers.load(std::memory_order_acquire) != 1) {
+            return false;
+        }
+        records = ring_->tryClaimRead(1, begin, end);
+    }
+    if (begin == end) {
+        return false;
+    }
+    droppedOldest_.fetch_add(records, std::memory_order_relaxed);
+    releaseRange(begin, end);
+    return true;
+}
+
+std::size_t GlobalBuffer::claimRecords(std::size_t maxRecords, std::uint64_t &begin, std::uint64_t &end) {
+    if (options_.shareAcrossProcesses) {
+        // 読み出し位置は 1 つのプロセスだけが進める
+        ring_->acquireConsumer();
+        return ring_->tryClaimRead(maxRecords, begin, end);
+    }
+    if (options_.overflowPolicy != OverflowPolicy::DropOldest) {
+        return ring_->tryClaimRead(maxRecords, begin, end);
+    }
+    std::lock_guard<std::mutex> lock(readMutex_);
+    return ring_->tryClaimRead(maxRecords, begin, end);
+}
+
+template <typename Predicate>
+bool GlobalBuffer::park(std::condition_variable &condition, std::atomic<std::size_t> &waiters, Predicate ready,
+                        std::chrono::steady_clock::time_point deadline) {
+    if (options_.waitStrategy != WaitStrategy::Blocking) {
+        auto done = [&]() { return shutdown_.load(std::memory_order_acquire) || ready(); };
+        const bool bounded = deadline != std::chrono::steady_clock::time_point::max();
+        // まずはシステムコールを伴わずにスピンする（時刻の確認は間引いて行う）
+        const std::size_t spins = options_.waitStrategy == WaitStrategy::BusySpin
+                                      ? std::numeric_limits<std::size_t>::max()
+                                      : options_.spinCount;
+        for (std::size_t i = 0; i < spins; ++i) {
+            if (done()) {
+                spinHits_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            if (bounded && (i % 64) == 63 && std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            cpuRelax();
+        }
+        // 次に CPU を他のスレッドへ譲りながら確認する
+        for (std::size_t i = 0; i < options_.yieldCount; ++i) {
+            if (done()) {
+                yieldHits_.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            if (bounded && std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+    }
+    parks_.fetch_add(1, std::memory_order_relaxed);
+    if (options_.shareAcrossProcesses) {
+        return parkShared(&condition == &canPop_, ready, deadline);
+    }
+    std::unique_lock<std::mutex> lock(waitMutex_);
+    // 待機者数を先に公開してから条件を再確認し、通知の取りこぼしを防ぐ
+    waiters.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto predicate = [&]() { return shutdown_.load(std::memory_order_acquire) || ready(); };
+    bool satisfied = true;
+    if (deadline == std::chrono::steady_clock::time_point::max()) {
+        condition.wait(lock, predicate);
+    } else {
+        satisfied = condition.wait_until(lock, deadline, predicate);
+    }
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+    return satisfied;
+}
+
+void GlobalBuffer::wake(std::condition_variable &condition, const std::atomic<std::size_t> &waiters, bool all) {
+    if (options_.shareAcrossProcesses) {
+        // 他のプロセスの待機者もいるため、常に全員を起こす
+        ring_->wakeSignal(&condition == &canPop_);
+        return;
+    }
+    // 公開したセルと待機者数の読み取り順序を保証する
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) == 0) {
+        // 誰も待っていなければシステムコールを発生させない
+        return;
+    }
+    std::lock_guard<std::mutex> lock(waitMutex_);
+    if (all) {
+        condition.notify_all();
+    } else {
+        condition.notify_one();
+    }
+}
+
+template <typename Predicate>
+bool GlobalBuffer::parkShared(bool popSide, Predicate ready, std::chrono::steady_clock::time_point deadline) {
+    auto predicate = [&]() { return shutdown_.load(std::memory_order_acquire) || ready(); };
+    std::atomic<std::uint32_t> &waiters = ring_->sharedWaiters(popSide);
+    while (true) {
+        // カウンタを読んでから待機者数を公開し、条件を再確認する（以降の通知はカウンタの変化で検出できる）
+        const std::uint32_t observed = ring_->sharedSignal(popSide);
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (predicate()) {
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+        ring_->waitSignal(popSide, observed,
+                          std::min<std::chrono::steady_clock::duration>(deadline - now, kSharedWaitSlice));
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        // 相手のプロセスが停止して通知が来ない場合に備え、起きるたびに後始末を試みる
+        ring_->recoverStalled();
+    }
+}
+
+WriteReservation::WriteReservation(WriteReservation &&other) noexcept
+    : owner_(other.owner_), lane_(other.lane_), position_(other.position_), data_(other.data_), size_(other.size_),
+      overflow_(other.overflow_), source_(other.source_) {
+    other.owner_ = nullptr;
+}
+
+WriteReservation &WriteReservation::operator=(WriteReservation &&other) noexcept {
+    if (this != &other) {
+        // 上書きされる側が未確定なら先に取り消しておく
+        abort();
+        owner_ = other.owner_;
+        lane_ = other.lane_;
+        position_ = other.position_;
+        data_ = other.data_;
+        size_ = other.size_;
+        overflow_ = other.overflow_;
+        source_ = other.source_;
+        other.owner_ = nullptr;
+    }
+    return *this;
+}
+
+WriteReservation::~WriteReservation() {
+    abort();
+}
+
+void WriteReservation::commit(std::size_t length) {
+    if (!owner_) {
+        throw std::logic_error("Cannot commit an empty write reservation");
+    }
+    owner_->commitReservation(*this, length);
+}
+
+void WriteReservation::abort() {
+    if (owner_) {
+        owner_->abortReservation(*this);
+    }
+}
+
+Subscription::Subscription(Subscription &&other) noexcept
+    : owner_(other.owner_), index_(other.index_), begin_(other.begin_), end_(other.end_) {
+    other.owner_ = nullptr;
+}
+
+Subscription &Subscription::operator=(Subscription &&other) noexcept {
+    if (this != &other) {
+        // 上書きされる側の購読は先に終了しておく
+        close();
+        owner_ = other.owner_;
+        index_ = other.index_;
+        begin_ = other.begin_;
+        end_ = other.end_;
+        other.owner_ = nullptr;
+    }
+    return *this;
+}
+
+Subscription::~Subscription() {
+    close();
+}
+
+std::size_t Subscription::read(std::vector<ItemView> &out, std::size_t maxItems, std::chrono::milliseconds maxWait) {
+    if (!owner_) {
+        throw std::logic_error("Cannot read from an empty subscription");
+    }
+    return owner_->readSink(*this, out, maxItems, maxWait);
+}
+
+void Subscription::release() {
+    if (owner_) {
+        owner_->releaseSink(*this);
+    }
+}
+
+std::uint64_t Subscription::dropped() const {
+    return owner_ ? owner_->sinkDropped(index_) : 0;
+}
+
+void Subscription::close() noexcept {
+    if (owner_) {
+        owner_->closeSink(*this);
+        owner_ = nullptr;
+    }
+}
+
+ReadLease::ReadLease(ReadLease &&other) noexcept
+    : owner_(other.owner_), views_(std::move(other.views_)), begin_(other.begin_), end_(other.end_),
+      owned_(std::move(other.owned_)) {
+    other.owner_ = nullptr;
+    other.begin_ = other.end_ = 0;
+}
+
+ReadLease &ReadLease::operator=(ReadLease &&other) noexcept {
+    if (this != &other) {
+        // 上書きされる側が保持していたデータは先に返却しておく
+        release();
+        owner_ = other.owner_;
+        views_ = std::move(other.views_);
+        begin_ = other.begin_;
+        end_ = other.end_;
+        owned_ = std::move(other.owned_);
+        other.owner_ = nullptr;
+        other.begin_ = other.end_ = 0;
+    }
+    return *this;
+}
+
+ReadLease::~ReadLease() {
+    release();
+}
+
+void ReadLease::release() {
+    if (owner_) {
+        owner_->releaseLease(*this);
+        owner_ = nullptr;
+    }
+}
+
+ProducerLane::ProducerLane(ProducerLane &&other) noexcept
+    : owner_(other.owner_), lane_(other.lane_), source_(other.source_) {
+    other.owner_ = nullptr;
+}
+
+ProducerLane &ProducerLane::operator=(ProducerLane &&other) noexcept {
+    if (this != &other) {
+        // 上書きされる側の lane は先に閉じておく
+        close();
+        owner_ = other.owner_;
+        lane_ = other.lane_;
+        source_ = other.source_;
+        other.owner_ = nullptr;
+    }
+    return *this;
+}
+
+ProducerLane::~ProducerLane() {
+    close();
+}
+
+void ProducerLane::push(BufferItem item) {
+    if (!owner_) {
+        throw std::logic_error("Cannot push to an empty producer lane");
+    }
+    owner_->lanePush(*this, std::move(item));
+}
+
+void ProducerLane::pushBatch(std::vector<BufferItem> &items) {
+    if (!owner_) {
+        throw std::logic_error("Cannot push to an empty producer lane");
+    }
+    owner_->lanePushBatch(*this, items);
+}
+
+WriteReservation ProducerLane::reserve(std::size_t size) {
+    if (!owner_) {
+        throw std::logic_error("Cannot reserve from an empty producer lane");
+    }
+    return owner_->laneReserve(*this, size);
+}
+
+void ProducerLane::close() noexcept {
+    if (owner_) {
+        owner_->closeLane(*this);
+        owner_ = nullptr;
     }
 }
-#endif
 
 } // namespace global_buffer
@@ -0,0 +1,105 @@
+#include "framework4cpp/Payload.h"
+#include "framework4cpp/PayloadPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace global_buffer {
+
+Payload::Payload(const std::uint8_t *data, std::size_t size) {
+    assign(data, size);
+}
+
+Payload::Payload(std::initializer_list<std::uint8_t> bytes) {
+    assign(bytes.begin(), bytes.end());
+}
+
+Payload::Payload(const Payload &other) {
+    assign(other.data_, other.size_);
+}
+
+Payload::Payload(Payload &&other) noexcept {
+    *this = std::move(other);
+}
+
+Payload &Payload::operator=(const Payload &other) {
+    if (this != &other) {
+        assign(other.data_, other.size_);
+    }
+    return *this;
+}
+
+Payload &Payload::operator=(Payload &&other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    releaseHeap();
+    if (other.isInline()) {
+        // 内部の領域にある小さなデータはコピーする
+        std::memcpy(inline_, other.inline_, other.size_);
+    } else {
+        // プールから得た領域は所有権ごと引き継ぐ
+        data_ = other.data_;
+        capacity_ = other.capacity_;
+        other.data_ = other.inline_;
+        other.capacity_ = kInlineCapacity;
+    }
+    size_ = other.size_;
+    other.size_ = 0;
+    return *this;
+}
+
+Payload::~Payload() {
+    releaseHeap();
+}
+
+void Payload::assign(const std::uint8_t *data, std::size_t size) {
+    resizeForOverwrite(size);
+    if (size > 0) {
+        std::memmove(data_, data, size);
+    }
+}
+
+void Payload::assign(std::size_t count, std::uint8_t value) {
+    resizeForOverwrite(count);
+    std::memset(data_, value, count);
+}
+
+void Payload::resize(std::size_t size) {
+    std::size_t previous = size_;
+    resizeForOverwrite(size);
+    if (size > previous) {
+        std::memset(data_ + previous, 0, size - previous);
+    }
+}
+
+void Payload::resizeForOverwrite(std::size_t size) {
+    if (size > capacity_) {
+        // 繰り返し伸ばす場合に備えて現在の 2 倍以上を確保する
+        grow(std::max(size, capacity_ * 2), size_);
+    }
+    size_ = size;
+}
+
+void Payload::grow(std::size_t capacity, std::size_t preserve) {
+    // サイズ区分の端数も使えるよう、プールのブロックサイズへ切り上げる
+    capacity = PayloadPool::roundUp(capacity);
+    auto *block = static_cast<std::uint8_t *>(PayloadPool::instance().allocate(capacity));
+    if (preserve > 0) {
+        std::memcpy(block, data_, preserve);
+    }
+    releaseHeap();
+    data_ = block;
+    capacity_ = capacity;
+}
+
+void Payload::releaseHeap() noexcept {
+    if (!isInline()) {
+        PayloadPool::instance().deallocate(data_, capacity_);
+        data_ = inline_;
+        capacity_ = kInlineCapacity;
+    }
+}
+
+} // namespace global_buffer
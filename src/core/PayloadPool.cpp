@@ -0,0 +1,149 @@
+#include "framework4cpp/PayloadPool.h"
+
+#include <algorithm>
+#include <new>
+
+namespace global_buffer {
+
+// スレッドごとのブロックキャッシュ（ロック無しで払い出し・返却できる）
+struct PayloadPool::ThreadCache {
+    std::array<std::array<void *, kThreadCacheBlocks>, kClassCount> blocks{};
+    std::array<std::size_t, kClassCount> counts{};
+
+    ~ThreadCache() {
+        // スレッド終了時は保持していたブロックを共有フリーリストへ戻す
+        for (std::size_t index = 0; index < kClassCount; ++index) {
+            if (counts[index] > 0) {
+                PayloadPool::instance().giveShared(index, blocks[index].data(), counts[index]);
+            }
+        }
+    }
+};
+
+PayloadPool &PayloadPool::instance() {
+    // 終了処理中に破棄されたペイロードも返却できるよう、プール自体は破棄しない
+    static PayloadPool *pool = new PayloadPool();
+    return *pool;
+}
+
+PayloadPool::ThreadCache &PayloadPool::localCache() {
+    thread_local ThreadCache cache;
+    return cache;
+}
+
+std::size_t PayloadPool::classIndex(std::size_t size) {
+    if (size > kMaxBlockSize) {
+        return kClassCount;
+    }
+    std::size_t index = 0;
+    while (blockSize(index) < size) {
+        ++index;
+    }
+    return index;
+}
+
+std::size_t PayloadPool::roundUp(std::size_t size) {
+    std::size_t index = classIndex(size);
+    return index == kClassCount ? size : blockSize(index);
+}
+
+void *PayloadPool::allocate(std::size_t size) {
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+    std::size_t index = classIndex(size);
+    if (index == kClassCount) {
+        // サイズ区分を超える確保はプールを通さない
+        heapAllocations_.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+
+    ThreadCache &cache = localCache();
+    std::size_t &count = cache.counts[index];
+    if (count > 0) {
+        threadCacheHits_.fetch_add(1, std::memory_order_relaxed);
+        return cache.blocks[index][--count];
+    }
+    // キャッシュが空なら共有フリーリストからまとめて補充する
+    count = takeShared(index, cache.blocks[index].data(), kThreadCacheBlocks / 2);
+    if (count > 0) {
+        sharedHits_.fetch_add(1, std::memory_order_relaxed);
+        return cache.blocks[index][--count];
+    }
+    heapAllocations_.fetch_add(1, std::memory_order_relaxed);
+    return ::operator new(blockSize(index));
+}
+
+void PayloadPool::deallocate(void *block, std::size_t size) noexcept {
+    if (!block) {
+        return;
+    }
+    releases_.fetch_add(1, std::memory_order_relaxed);
+    std::size_t index = classIndex(size);
+    if (index == kClassCount) {
+        ::operator delete(block);
+        return;
+    }
+
+    ThreadCache &cache = localCache();
+    std::size_t &count = cache.counts[index];
+    if (count == kThreadCacheBlocks) {
+        // キャッシュが満杯なら後半を共有フリーリストへ移し、他のスレッドが再利用できるようにする
+        std::size_t keep = kThreadCacheBlocks / 2;
+        giveShared(index, cache.blocks[index].data() + keep, kThreadCacheBlocks - keep);
+        count = keep;
+    }
+    cache.blocks[index][count++] = block;
+}
+
+PayloadPoolStats PayloadPool::stats() const {
+    PayloadPoolStats result;
+    result.allocations = allocations_.load(std::memory_order_relaxed);
+    result.threadCacheHits = threadCacheHits_.load(std::memory_order_relaxed);
+    result.sharedHits = sharedHits_.load(std::memory_order_relaxed);
+    result.heapAllocations = heapAllocations_.load(std::memory_order_relaxed);
+    result.releases = releases_.load(std::memory_order_relaxed);
+    result.sharedBytes = sharedBytes_.load(std::memory_order_relaxed);
+    return result;
+}
+
+void PayloadPool::trim() {
+    for (std::size_t index = 0; index < kClassCount; ++index) {
+        FreeList &list = freeLists_[index];
+        std::lock_guard<std::mutex> lock(list.mutex);
+        for (void *block : list.blocks) {
+            ::operator delete(block);
+        }
+        sharedBytes_.fetch_sub(list.blocks.size() * blockSize(index), std::memory_order_relaxed);
+        list.blocks.clear();
+        list.blocks.shrink_to_fit();
+    }
+}
+
+std::size_t PayloadPool::takeShared(std::size_t index, void **out, std::size_t count) {
+    FreeList &list = freeLists_[index];
+    std::lock_guard<std::mutex> lock(list.mutex);
+    std::size_t taken = std::min(count, list.blocks.size());
+    std::copy(list.blocks.end() - static_cast<std::ptrdiff_t>(taken), list.blocks.end(), out);
+    list.blocks.resize(list.blocks.size() - taken);
+    sharedBytes_.fetch_sub(taken * blockSize(index), std::memory_order_relaxed);
+    return taken;
+}
+
+void PayloadPool::giveShared(std::size_t index, void *const *blocks, std::size_t count) noexcept {
+    FreeList &list = freeLists_[index];
+    const std::size_t limit = std::max<std::size_t>(1, kSharedBytesPerClass / blockSize(index));
+    std::lock_guard<std::mutex> lock(list.mutex);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (list.blocks.size() < limit) {
+            try {
+                list.blocks.push_back(blocks[i]);
+                sharedBytes_.fetch_add(blockSize(index), std::memory_order_relaxed);
+                continue;
+            } catch (const std::bad_alloc &) {
+                // フリーリストを伸ばせない場合はヒープへ返す
+            }
+        }
+        ::operator delete(blocks[i]);
+    }
+}
+
+} // namespace global_buffer
@@ -0,0 +1,1221 @@
+#include "framework4cpp/RecordRing.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/vfs.h>
+#endif
+
+namespace global_buffer {
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "Record state must be lock-free");
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Ring cursors must be lock-free");
+static_assert(sizeof(RecordHeader) % RecordRing::kAlignment == 0, "Record header must keep records aligned");
+
+namespace {
+
+// CRC-32（多項式 0xEDB88320）のテーブルをコンパイル時に生成する
+constexpr std::array<std::uint32_t, 256> makeCrcTable() {
+    std::array<std::uint32_t, 256> table{};
+    for (std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t value = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            value = (value & 1) ? (value >> 1) ^ 0xEDB88320U : value >> 1;
+        }
+        table[i] = value;
+    }
+    return table;
+}
+
+constexpr std::array<std::uint32_t, 256> kCrcTable = makeCrcTable();
+
+// crc に size バイト分のデータを加算する（初期値・最終反転は呼び出し側で行う）
+std::uint32_t updateCrc(std::uint32_t crc, const std::uint8_t *data, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+        crc = kCrcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef __linux__
+// statfs が hugetlbfs に対して返すファイルシステムの種別
+constexpr unsigned long kHugetlbfsMagic = 0x958458f6UL;
+#endif
+
+#ifdef __linux__
+// /proc/<pid>/stat から状態（3 番目の項目）と開始時刻（22 番目の項目。起動からのクロック数）を読む
+bool readProcessStat(std::uint32_t pid, char &state, std::uint64_t &startTime) {
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    if (!std::getline(stat, line)) {
+        return false;
+    }
+    // 2 番目の項目（コマンド名）は空白や括弧を含み得るため、最後の ')' の後ろから数える
+    std::size_t end = line.rfind(')');
+    if (end == std::string::npos) {
+        return false;
+    }
+    std::istringstream fields(line.substr(end + 1));
+    std::string field;
+    fields >> state;
+    for (int index = 4; index < 22; ++index) {
+        fields >> field;
+    }
+    return static_cast<bool>(fields >> startTime);
+}
+#endif
+
+// プロセスの開始時刻（取得できなければ 0）
+std::uint64_t processStartTime(std::uint32_t pid) {
+#ifdef __linux__
+    char state = 0;
+    std::uint64_t startTime = 0;
+    if (readProcessStat(pid, state, startTime)) {
+        return startTime;
+    }
+#else
+    (void)pid;
+#endif
+    return 0;
+}
+
+// プロセスが動作中か（シグナルを送る権限が無い場合も動作中とみなす）
+// startTime が 0 以外なら、同じ ID が別のプロセスに再利用されていれば停止したものとして扱う
+bool isAlive(std::uint32_t pid, std::uint64_t startTime) {
+#ifdef _WIN32
+    // 共有は POSIX でのみ利用できるため、ここには到達しない
+    (void)pid;
+    (void)startTime;
+    return true;
+#else
+    if (::kill(static_cast<pid_t>(pid), 0) != 0 && errno != EPERM) {
+        return false;
+    }
+#ifdef __linux__
+    char state = 0;
+    std::uint64_t started = 0;
+    if (readProcessStat(pid, state, started)) {
+        // 終了したが親に回収されていないプロセス（ゾンビ）も停止したものとして扱う
+        return state != 'Z' && (startTime == 0 || started == startTime);
+    }
+#else
+    (void)startTime;
+#endif
+    return true;
+#endif
+}
+
+// 準備結果の注記に 1 項目を追加する
+void addNote(std::string &notes, const std::string &note) {
+    if (!notes.empty()) {
+        notes += "; ";
+    }
+    notes += note;
+}
+
+} // namespace
+
+RecordRing::RecordRing(const std::string &path, std::size_t dataBytes, bool recoverExisting,
+                       const MapSettings &settings)
+    : path_(path), dataBytes_(dataBytes / kAlignment * kAlignment) {
+    if (path_.empty()) {
+        throw std::invalid_argument("Backing file must be provided for a record ring");
+    }
+    if (dataBytes_ < 2 * recordLength(0)) {
+        throw std::invalid_argument("Record ring is too small to hold any record");
+    }
+    static_assert(sizeof(Control) <= kControlBytes, "Ring control block must fit in its reserved area");
+#ifdef _WIN32
+    if (settings.shared) {
+        throw std::invalid_argument("Sharing a memory-mapped buffer across processes is not supported on Windows");
+    }
+#else
+    if (settings.shared) {
+        shared_ = true;
+        processId_ = static_cast<std::uint32_t>(::getpid());
+        startTime_ = processStartTime(processId_);
+    }
+#endif
+    mappedSize_ = kControlBytes + kSourceBytes + kSourceSequenceBytes + dataBytes_;
+    // 共有時は動作中の参加者がいるかを確かめるまで、既存の内容を消さずに開く
+    bool kept = map(recoverExisting || shared_, settings);
+    control_ = reinterpret_cast<Control *>(mappedView_);
+    sources_ = mappedView_ + kControlBytes;
+    sourceSequences_ = reinterpret_cast<std::atomic<std::uint64_t> *>(sources_ + kSourceBytes);
+    data_ = sources_ + kSourceBytes + kSourceSequenceBytes;
+    if (shared_) {
+        try {
+            attach(recoverExisting, kept);
+        } catch (...) {
+            unmap();
+            throw;
+        }
+        return;
+    }
+    if (kept && hasCompatibleLayout()) {
+        // 前回のリングを引き継ぎ、未消費のレコードを読み出せる状態に戻す
+        recoveredRecords_ = recover();
+        return;
+    }
+    // 引き継げない内容は捨て、空のリングとして初期化する
+    if (kept) {
+        std::memset(mappedView_, 0, mappedSize_);
+    }
+    initialize();
+}
+
+RecordRing::~RecordRing() {
+    if (shared_) {
+        detach();
+    }
+    unmap();
+}
+
+std::size_t RecordRing::recordLength(std::size_t payloadSize) {
+    // ヘッダ + ペイロードを 8 バイト境界へ切り上げる
+    std::size_t raw = sizeof(RecordHeader) + payloadSize;
+    return (raw + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+bool RecordRing::tryClaim(std::size_t length, std::uint64_t &position) {
+    if (length > maxRecordLength() || length > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("Record length exceeds the capacity of the memory-mapped buffer");
+    }
+    // 共有時は tail を進める前に確保する範囲を記録し、途中で停止しても他のプロセスが範囲を片付けられるようにする
+    Claim *claim = shared_ ? &acquireClaim() : nullptr;
+    std::uint64_t tail = control_->tail.load(std::memory_order_acquire);
+    bool reclaimed = false;
+    while (true) {
+        std::uint64_t head = control_->head.load(std::memory_order_acquire);
+        // 終端をまたぐ場合は余りをラップマーカーで埋め、先頭から確保する
+        std::size_t offset = static_cast<std::size_t>(tail % dataBytes_);
+        std::size_t toEnd = dataBytes_ - offset;
+        std::size_t padding = length > toEnd ? toEnd : 0;
+        std::size_t fitted = fitLength(padding > 0 ? 0 : offset, length);
+        if (tail + padding + fitted - head > dataBytes_) {
+            // 処理済みのレコードが残っていれば回収してから 1 度だけ再試行する
+            if (reclaimed) {
+                if (claim) {
+                    releaseClaim(*claim);
+                }
+                return false;
+            }
+            reclaim();
+            reclaimed = true;
+            tail = control_->tail.load(std::memory_order_acquire);
+            continue;
+        }
+        if (claim) {
+            claim->padding.store(static_cast<std::uint32_t>(padding), std::memory_order_relaxed);
+            claim->length.store(static_cast<std::uint32_t>(fitted), std::memory_order_relaxed);
+            claim->begin.store(tail, std::memory_order_release);
+        }
+        if (control_->tail.compare_exchange_weak(tail, tail + padding + fitted, std::memory_order_acq_rel)) {
+            if (padding > 0) {
+                // ラップマーカーも通常のレコードと同じく、全ての読み手が通過してから再利用する
+                RecordHeader &marker = header(tail);
+                marker.length.store(static_cast<std::uint32_t>(padding), std::memory_order_relaxed);
+                marker.readers.store(readers_, std::memory_order_relaxed);
+                marker.state.store(kPadding, std::memory_order_release);
+            }
+            position = tail + padding;
+            RecordHeader &record = header(position);
+            // 確保者を長さより先に書き、長さの見えたレコードは確保者も判定できるようにする
+            if (shared_) {
+                record.owner.store(processId_, std::memory_order_relaxed);
+            }
+            record.length.store(static_cast<std::uint32_t>(fitted), std::memory_order_release);
+            // 長さが見えた後は確保者の生死で判定できるため、範囲の記録を消す
+            if (claim) {
+                releaseClaim(*claim);
+            }
+            return true;
+        }
+    }
+}
+
+bool RecordRing::canClaim(std::size_t length) const {
+    std::uint64_t tail = control_->tail.load(std::memory_order_acquire);
+    std::uint64_t head = control_->head.load(std::memory_order_acquire);
+    std::size_t offset = static_cast<std::size_t>(tail % dataBytes_);
+    std::size_t toEnd = dataBytes_ - offset;
+    std::size_t padding = length > toEnd ? toEnd : 0;
+    return tail + padding + fitLength(padding > 0 ? 0 : offset, length) - head <= dataBytes_;
+}
+
+std::size_t RecordRing::fitLength(std::size_t offset, std::size_t length) const {
+    // 終端までの余りがヘッダより短くなる場合は、ラップマーカーを置けないため余りごとレコードに含める
+    std::size_t rest = dataBytes_ - offset - length;
+    return rest > 0 && rest < sizeof(RecordHeader) ? length + rest : length;
+}
+
+void RecordRing::shrink(std::uint64_t position, std::size_t newLength) {
+    RecordHeader &record = header(position);
+    std::size_t oldLength = record.length.load(std::memory_order_relaxed);
+    newLength = fitLength(static_cast<std::size_t>(position % dataBytes_), newLength);
+    if (newLength >= oldLength) {
+        return;
+    }
+    // 余りは他の生産者へ渡る可能性があるため、返却前に 0 へ戻しておく
+    std::memset(data_ + (position + newLength) % dataBytes_, 0, oldLength - newLength);
+    std::uint64_t expected = position + oldLength;
+    if (control_->tail.compare_exchange_strong(expected, position + newLength, std::memory_order_acq_rel)) {
+        record.length.store(static_cast<std::uint32_t>(newLength), std::memory_order_relaxed);
+    }
+}
+
+void RecordRing::commit(std::uint64_t position) {
+    // チェックサムを書き込んでから状態を公開する（復旧時はこの順序を前提に検査する）
+    RecordHeader &record = header(position);
+    record.checksum = checksum(position);
+    record.readers.store(readers_, std::memory_order_relaxed);
+    record.state.store(kCommitted, std::memory_order_release);
+}
+
+void RecordRing::discard(std::uint64_t position) {
+    RecordHeader &record = header(position);
+    record.readers.store(readers_, std::memory_order_relaxed);
+    record.state.store(kDiscarded, std::memory_order_release);
+}
+
+std::size_t RecordRing::tryClaimRead(std::size_t maxRecords, std::uint64_t &begin, std::uint64_t &end) {
+    return tryClaimRead(control_->readCursor, maxRecords, begin, end);
+}
+
+std::size_t RecordRing::tryClaimRead(std::atomic<std::uint64_t> &readCursor, std::size_t maxRecords,
+                                     std::uint64_t &begin, std::uint64_t &end) {
+    std::uint64_t cursor = readCursor.load(std::memory_order_acquire);
+    while (true) {
+        std::uint64_t tail = control_->tail.load(std::memory_order_acquire);
+        std::uint64_t position = cursor;
+        std::size_t records = 0;
+        while (position < tail && records < maxRecords) {
+            RecordHeader &record = header(position);
+            std::uint32_t state = record.state.load(std::memory_order_acquire);
+            // 未書き込み（または他の消費者に回収済み）の位置で止める
+            std::size_t length = record.length.load(std::memory_order_relaxed);
+            if (state == kEmpty || state == kReleased || length == 0 || length > dataBytes_) {
+                break;
+            }
+            if (state == kCommitted) {
+                ++records;
+            }
+            position += length;
+        }
+        if (position == cursor) {
+            return 0;
+        }
+        if (readCursor.compare_exchange_weak(cursor, position, std::memory_order_acq_rel)) {
+            begin = cursor;
+            end = position;
+            return records;
+        }
+    }
+}
+
+bool RecordRing::hasReadable() const {
+    return hasReadable(control_->readCursor);
+}
+
+bool RecordRing::hasReadable(const std::atomic<std::uint64_t> &readCursor) const {
+    std::uint64_t cursor = readCursor.load(std::memory_order_acquire);
+    if (cursor >= control_->tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    std::uint32_t state = header(cursor).state.load(std::memory_order_acquire);
+    return state != kEmpty && state != kReleased;
+}
+
+void RecordRing::release(std::uint64_t position) {
+    // 最後の読み手が処理を終えた時点で再利用対象にする
+    RecordHeader &record = header(position);
+    if (record.readers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        record.state.store(kReleased, std::memory_order_release);
+    }
+}
+
+void RecordRing::reclaim() {
+    const std::uint32_t token = shared_ ? processId_ : 1;
+    while (true) {
+        std::uint32_t expected = 0;
+        if (!control_->reclaiming.compare_exchange_strong(expected, token, std::memory_order_acquire)) {
+            // 回収中のスレッドに再確認を依頼する。依頼が間に合わず回収が終わっていれば自分で回収し直す
+            control_->reclaimPending.store(1, std::memory_order_seq_cst);
+            if (control_->reclaiming.load(std::memory_order_seq_cst) != 0) {
+                return;
+            }
+            continue;
+        }
+        // 依頼はこれから行う走査で満たされるため取り下げる
+        control_->reclaimPending.store(0, std::memory_order_relaxed);
+        std::uint64_t head = control_->head.load(std::memory_order_relaxed);
+        std::uint64_t limit = control_->readCursor.load(std::memory_order_acquire);
+        control_->head.store(reclaimFrom(head, limit), std::memory_order_release);
+        control_->reclaiming.store(0, std::memory_order_seq_cst);
+
+        // 回収中に他のスレッドが release して再確認を依頼していなければ終了する
+        if (control_->reclaimPending.load(std::memory_order_seq_cst) == 0) {
+            return;
+        }
+    }
+}
+
+std::uint64_t RecordRing::reclaimFrom(std::uint64_t head, std::uint64_t limit) {
+    while (head < limit) {
+        RecordHeader &record = header(head);
+        std::uint32_t state = record.state.load(std::memory_order_acquire);
+        std::size_t length = record.length.load(std::memory_order_relaxed);
+        // 消費者が通過した範囲の kEmpty は、回収の途中で停止したプロセスが残したレコード
+        if (state != kReleased && !(shared_ && state == kEmpty && length != 0)) {
+            break;
+        }
+        // 次周回の生産者が未書き込みと判定できるよう、レコード全体を 0 に戻す
+        record.state.store(kEmpty, std::memory_order_relaxed);
+        std::memset(reinterpret_cast<std::uint8_t *>(&record) + offsetof(RecordHeader, sequence), 0,
+                    length - offsetof(RecordHeader, sequence));
+        record.length.store(0, std::memory_order_relaxed);
+        head += length;
+        // 共有時は途中で停止しても続きから回収できるよう、1 件ごとに先頭を進める
+        if (shared_) {
+            control_->head.store(head, std::memory_order_release);
+        }
+    }
+    return head;
+}
+
+void RecordRing::attach(bool recoverExisting, bool kept) {
+    // map で取得したファイルロックの下で、参加者の表を確認してから自身を登録する
+    if (!(kept && hasCompatibleLayout() && hasLiveParticipant())) {
+        // 動作中のプロセスがいなければ、単独で開く場合と同じく引き継ぐか初期化する
+        if (kept && hasCompatibleLayout() && recoverExisting) {
+            recoveredRecords_ = recover();
+        } else {
+            std::memset(mappedView_, 0, mappedSize_);
+            initialize();
+        }
+        // 停止したプロセスが残した参加者・消費者・待機者の記録を消す（確保の範囲は recover で片付け済み）
+        for (auto &participant : control_->participants) {
+            participant.pid.store(0, std::memory_order_relaxed);
+            for (auto &claim : participant.claims) {
+                claim.length.store(0, std::memory_order_relaxed);
+            }
+        }
+        control_->consumer.store(0, std::memory_order_relaxed);
+        control_->pushWaiters.store(0, std::memory_order_relaxed);
+        control_->popWaiters.store(0, std::memory_order_relaxed);
+        // ファイルロックを持ち、他に動作中のプロセスがいない間に書き込みのフォールトも済ませる
+        if (prefaultPending_) {
+            touchPages(true);
+            report_.prefaulted = true;
+        }
+    } else if (prefaultPending_) {
+        addNote(report_.notes, "joined a live shared ring; pages were prefaulted for reading only");
+    }
+    prefaultPending_ = false;
+    // 空きの枠を優先し、無ければ停止したプロセスの枠を再利用する
+    // （確保の範囲を残した枠は、消費者がその範囲を片付けられるよう最後まで残す）
+    participant_ = kMaxParticipants;
+    std::size_t fallback = kMaxParticipants;
+    for (std::size_t index = 0; index < kMaxParticipants && participant_ == kMaxParticipants; ++index) {
+        Participant &participant = control_->participants[index];
+        std::uint32_t pid = participant.pid.load(std::memory_order_acquire);
+        if (pid == 0) {
+            participant_ = index;
+        } else if (!isAlive(pid, participant.startTime.load(std::memory_order_relaxed))) {
+            bool claiming = std::any_of(std::begin(participant.claims), std::end(participant.claims),
+                                        [](const Claim &claim) { return claim.length.load() != 0; });
+            if (!claiming) {
+                participant_ = index;
+            } else if (fallback == kMaxParticipants) {
+                fallback = index;
+            }
+        }
+    }
+    if (participant_ == kMaxParticipants) {
+        participant_ = fallback;
+    }
+    if (participant_ != kMaxParticipants) {
+        Participant &participant = control_->participants[participant_];
+        for (auto &claim : participant.claims) {
+            claim.length.store(0, std::memory_order_relaxed);
+        }
+        participant.startTime.store(startTime_, std::memory_order_relaxed);
+        participant.pid.store(processId_, std::memory_order_release);
+    }
+    unlockFile();
+    if (participant_ == kMaxParticipants) {
+        throw std::runtime_error("Too many processes are attached to the shared buffer: " + path_);
+    }
+}
+
+void RecordRing::detach() {
+    // 消費者の役割を手放してから参加者の表を空ける（処理中のレコードは残らない前提で、次の消費者はそのまま続きから読む）
+    std::uint32_t self = processId_;
+    control_->consumer.compare_exchange_strong(self, 0, std::memory_order_acq_rel);
+    if (participant_ != kMaxParticipants) {
+        control_->participants[participant_].pid.store(0, std::memory_order_release);
+    }
+    // 相手の待機が区切りを待たずに条件を確認し直せるよう、両側を起こしておく
+    wakeSignal(false);
+    wakeSignal(true);
+}
+
+bool RecordRing::hasLiveParticipant() const {
+    for (const auto &participant : control_->participants) {
+        std::uint32_t pid = participant.pid.load(std::memory_order_acquire);
+        if (pid != 0 && isAlive(pid, participant.startTime.load(std::memory_order_relaxed))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RecordRing::isParticipantAlive(std::uint32_t pid) const {
+    // 動作中のプロセスは必ず参加者の表に載っているため、載っていない ID は停止したものとして扱う
+    for (const auto &participant : control_->participants) {
+        if (participant.pid.load(std::memory_order_acquire) == pid) {
+            return isAlive(pid, participant.startTime.load(std::memory_order_relaxed));
+        }
+    }
+    return false;
+}
+
+RecordRing::Claim &RecordRing::acquireClaim() {
+    Participant &participant = control_->participants[participant_];
+    while (true) {
+        std::uint32_t used = claimSlots_.load(std::memory_order_relaxed);
+        for (std::size_t index = 0; index < kMaxClaims; ++index) {
+            const std::uint32_t bit = std::uint32_t{1} << index;
+            if ((used & bit) == 0 && claimSlots_.compare_exchange_weak(used, used | bit, std::memory_order_acquire)) {
+                return participant.claims[index];
+            }
+        }
+        // 全ての枠が使用中なら、他のスレッドの確保が終わるのを待つ
+        std::this_thread::yield();
+    }
+}
+
+void RecordRing::releaseClaim(Claim &claim) {
+    Participant &participant = control_->participants[participant_];
+    claim.length.store(0, std::memory_order_release);
+    const auto index = static_cast<std::size_t>(&claim - participant.claims);
+    claimSlots_.fetch_and(~(std::uint32_t{1} << index), std::memory_order_release);
+}
+
+bool RecordRing::hasLiveClaim(std::uint64_t position) const {
+    for (const auto &participant : control_->participants) {
+        std::uint32_t pid = participant.pid.load(std::memory_order_acquire);
+        if (pid == 0) {
+            continue;
+        }
+        for (const auto &claim : participant.claims) {
+            std::uint64_t begin = claim.begin.load(std::memory_order_acquire);
+            std::uint32_t length = claim.length.load(std::memory_order_acquire);
+            std::uint32_t padding = claim.padding.load(std::memory_order_relaxed);
+            if (length != 0 && (begin == position || begin + padding == position) &&
+                isAlive(pid, participant.startTime.load(std::memory_order_relaxed))) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool RecordRing::findAbandonedClaim(std::uint64_t position, AbandonedClaim &found) const {
+    // 同じ位置を狙って CAS に失敗したまま停止したプロセスの記録も残り得るため、
+    // 候補が複数あれば、範囲の終わりが tail か後続のレコードの先頭と一致するものを選ぶ
+    std::uint64_t tail = control_->tail.load(std::memory_order_acquire);
+    bool hasCandidate = false;
+    for (auto &participant : control_->participants) {
+        std::uint32_t pid = participant.pid.load(std::memory_order_acquire);
+        if (pid == 0 || isAlive(pid, participant.startTime.load(std::memory_order_relaxed))) {
+            continue;
+        }
+        for (auto &claim : participant.claims) {
+            std::uint64_t begin = claim.begin.load(std::memory_order_acquire);
+            std::size_t length = claim.length.load(std::memory_order_acquire);
+            std::size_t padding = claim.padding.load(std::memory_order_relaxed);
+            if (length == 0 || (begin != position && begin + padding != position) ||
+                begin + padding + length > tail) {
+                continue;
+            }
+            std::uint64_t end = begin + padding + length;
+            bool consistent = end == tail || header(end).length.load(std::memory_order_acquire) != 0;
+            if (!hasCandidate || consistent) {
+                found = AbandonedClaim{begin, padding, length, &claim};
+                hasCandidate = true;
+                if (consistent) {
+                    return true;
+                }
+            }
+        }
+    }
+    return hasCandidate;
+}
+
+bool RecordRing::publishAbandoned(std::uint64_t position, const AbandonedClaim &found) {
+    // 動作中の生産者が同じ位置へ長さを書いていれば、長さの CAS に失敗するため上書きしない
+    if (found.padding > 0 && found.begin == position) {
+        RecordHeader &marker = header(position);
+        std::uint32_t expected = 0;
+        if (!marker.length.compare_exchange_strong(expected, static_cast<std::uint32_t>(found.padding),
+                                                   std::memory_order_acq_rel)) {
+            return false;
+        }
+        marker.readers.store(readers_, std::memory_order_relaxed);
+        marker.state.store(kPadding, std::memory_order_release);
+        position += found.padding;
+    }
+    RecordHeader &record = header(position);
+    std::uint32_t expected = 0;
+    if (record.length.compare_exchange_strong(expected, static_cast<std::uint32_t>(found.length),
+                                              std::memory_order_acq_rel)) {
+        record.readers.store(readers_, std::memory_order_relaxed);
+        record.state.store(kDiscarded, std::memory_order_release);
+    }
+    found.claim->length.store(0, std::memory_order_release);
+    return true;
+}
+
+void RecordRing::lockReclaim() {
+    const std::uint32_t token = shared_ ? processId_ : 1;
+    std::uint32_t holder = 0;
+    while (!control_->reclaiming.compare_exchange_weak(holder, token, std::memory_order_acquire)) {
+        // 停止したプロセスが持ったままのフラグは引き取り、それ以外は回収が終わるのを待つ
+        if (holder != 0 && (!shared_ || isParticipantAlive(holder))) {
+            std::this_thread::yield();
+            holder = 0;
+        }
+    }
+}
+
+void RecordRing::acquireConsumer() {
+    std::uint32_t current = control_->consumer.load(std::memory_order_acquire);
+    if (current == processId_) {
+        return;
+    }
+    while (true) {
+        if (current != 0 && isParticipantAlive(current)) {
+            throw std::logic_error("Another process is already consuming the shared buffer: " + path_);
+        }
+        if (control_->consumer.compare_exchange_strong(current, processId_, std::memory_order_acq_rel)) {
+            break;
+        }
+        if (current == processId_) {
+            return;
+        }
+    }
+    // 前の消費者が停止していた場合は、処理途中のレコードを引き継ぐ
+    if (current != 0) {
+        takeOver();
+    }
+}
+
+void RecordRing::takeOver() {
+    lockReclaim();
+    control_->reclaimPending.store(0, std::memory_order_relaxed);
+    std::uint64_t cursor = control_->readCursor.load(std::memory_order_acquire);
+    std::uint64_t head = reclaimFrom(control_->head.load(std::memory_order_relaxed), cursor);
+    // 前の消費者が確保したまま release しなかったレコードをもう一度読み出させる
+    // その間に処理済みとなっていたレコードは、二重に出力しないよう読み飛ばし対象に変える
+    for (std::uint64_t position = head; position < cursor; position = next(position)) {
+        RecordHeader &record = header(position);
+        if (record.length.load(std::memory_order_relaxed) == 0) {
+            break;
+        }
+        if (record.state.load(std::memory_order_acquire) == kReleased) {
+            record.readers.store(readers_, std::memory_order_relaxed);
+            record.state.store(kDiscarded, std::memory_order_release);
+        }
+    }
+    control_->head.store(head, std::memory_order_release);
+    control_->readCursor.store(head, std::memory_order_release);
+    control_->reclaiming.store(0, std::memory_order_seq_cst);
+}
+
+bool RecordRing::recoverStalled() {
+    bool recovered = false;
+    // 回収中に停止したプロセスのフラグを外し、途中から回収をやり直す
+    std::uint32_t holder = control_->reclaiming.load(std::memory_order_acquire);
+    if (holder != 0 && !isParticipantAlive(holder) &&
+        control_->reclaiming.compare_exchange_strong(holder, 0, std::memory_order_acq_rel)) {
+        reclaim();
+        recovered = true;
+    }
+    // 消費者の次に読む位置から、確保したまま停止した生産者のレコードを読み飛ばし対象として公開する
+    std::uint64_t tail = control_->tail.load(std::memory_order_acquire);
+    for (std::uint64_t position = control_->readCursor.load(std::memory_order_acquire); position < tail;) {
+        RecordHeader &record = header(position);
+        std::size_t length = record.length.load(std::memory_order_acquire);
+        if (length > dataBytes_) {
+            break;
+        }
+        if (length == 0) {
+            // tail の確保から長さの書き込みまでの間に停止した場合は、確保前に記録した範囲から長さを求める
+            AbandonedClaim found{};
+            if (hasLiveClaim(position) || !findAbandonedClaim(position, found) || !publishAbandoned(position, found)) {
+                break;
+            }
+            recovered = true;
+            continue;
+        }
+        std::uint32_t state = record.state.load(std::memory_order_acquire);
+        if (state == kEmpty) {
+            // 長さを書いた後に停止したレコード。確保者の無いヘッダは、状態を書く前に停止したラップマーカー
+            // （生産者は長さより先に確保者を書くため、確保中の範囲の記録が無ければ動作中の生産者のものではない）
+            if (hasLiveClaim(position)) {
+                break;
+            }
+            std::uint32_t owner = record.owner.load(std::memory_order_relaxed);
+            if (owner != 0 && isParticipantAlive(owner)) {
+                break;
+            }
+            record.readers.store(readers_, std::memory_order_relaxed);
+            if (record.state.compare_exchange_strong(state, kDiscarded, std::memory_order_release)) {
+                recovered = true;
+            }
+        } else if (state == kReleased) {
+            break;
+        }
+        position += length;
+    }
+    return recovered;
+}
+
+std::atomic<std::uint32_t> &RecordRing::sharedWaiters(bool popSide) const {
+    return popSide ? control_->popWaiters : control_->pushWaiters;
+}
+
+std::uint32_t RecordRing::sharedSignal(bool popSide) const {
+    return (popSide ? control_->popSignal : control_->pushSignal).load(std::memory_order_acquire);
+}
+
+void RecordRing::waitSignal(bool popSide, std::uint32_t observed, std::chrono::nanoseconds timeout) const {
+    std::atomic<std::uint32_t> &signal = popSide ? control_->popSignal : control_->pushSignal;
+#ifdef __linux__
+    // 共有マップ上のカウンタで futex 待機する（プロセス間で共有するため FUTEX_PRIVATE_FLAG は付けない）
+    struct timespec relative {};
+    relative.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    relative.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&signal), FUTEX_WAIT, observed, &relative, nullptr, 0);
+#else
+    // futex の無い環境では、短い間隔でカウンタを確認し直す
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (signal.load(std::memory_order_acquire) == observed && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+#endif
+}
+
+void RecordRing::wakeSignal(bool popSide) const {
+    // 公開した状態と待機者数の読み取り順序を保証する
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sharedWaiters(popSide).load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    std::atomic<std::uint32_t> &signal = popSide ? control_->popSignal : control_->pushSignal;
+    signal.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&signal), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+RecordHeader &RecordRing::header(std::uint64_t position) const {
+    return *reinterpret_cast<RecordHeader *>(data_ + position % dataBytes_);
+}
+
+std::uint8_t *RecordRing::payload(std::uint64_t position) const {
+    return data_ + position % dataBytes_ + sizeof(RecordHeader);
+}
+
+void RecordRing::storeSource(std::uint32_t id, std::string_view name) {
+    std::lock_guard<std::mutex> lock(sourceMutex_);
+    appendSource(id, name);
+}
+
+SourceId RecordRing::internSource(std::string_view name, SourceRegistry &registry) {
+    // flock はプロセス単位で効くため、同じプロセスのスレッドどうしはミューテックスで直列化する
+    std::lock_guard<std::mutex> lock(sourceMutex_);
+    lockFile();
+    try {
+        // 他のプロセスが先に登録した番号を避けて採番できるよう、最新の一覧を取り込んでから登録する
+        syncSources(registry);
+        bool added = false;
+        SourceId id = registry.intern(name, &added);
+        if (added) {
+            appendSource(id, name);
+        }
+        unlockFile();
+        return id;
+    } catch (...) {
+        unlockFile();
+        throw;
+    }
+}
+
+void RecordRing::syncSources(SourceRegistry &registry) const {
+    forEachSource([&registry](std::uint32_t id, std::string_view name) {
+        if (!registry.contains(id)) {
+            registry.restore(id, name);
+        }
+    });
+}
+
+void RecordRing::appendSource(std::uint32_t id, std::string_view name) {
+    std::uint64_t used = control_->sourceBytes.load(std::memory_order_relaxed);
+    std::size_t length = (sizeof(SourceEntry) + name.size() + kAlignment - 1) / kAlignment * kAlignment;
+    if (used + length > kSourceBytes) {
+        throw std::runtime_error("Source directory of the memory-mapped buffer is full");
+    }
+    // エントリを書き終えてから使用済みバイト数を進め、途中で停止しても一覧が壊れないようにする
+    SourceEntry entry{id, static_cast<std::uint32_t>(name.size())};
+    std::memcpy(sources_ + used, &entry, sizeof(entry));
+    std::memcpy(sources_ + used + sizeof(entry), name.data(), name.size());
+    control_->sourceBytes.store(used + length, std::memory_order_release);
+}
+
+bool RecordRing::hasCompatibleLayout() const {
+    return control_->magic == kMagic && control_->version == kVersion &&
+           control_->headerBytes == sizeof(RecordHeader) && control_->dataBytes == dataBytes_;
+}
+
+void RecordRing::initialize() {
+    control_->sequence.store(0, std::memory_order_relaxed);
+    control_->sourceBytes.store(0, std::memory_order_relaxed);
+    for (std::size_t id = 0; id < SourceRegistry::kMaxSources; ++id) {
+        sourceSequences_[id].store(0, std::memory_order_relaxed);
+    }
+    control_->tail.store(0, std::memory_order_relaxed);
+    control_->readCursor.store(0, std::memory_order_relaxed);
+    control_->head.store(0, std::memory_order_relaxed);
+    control_->reclaiming.store(0, std::memory_order_relaxed);
+    control_->reclaimPending.store(0, std::memory_order_relaxed);
+    control_->version = kVersion;
+    control_->headerBytes = static_cast<std::uint32_t>(sizeof(RecordHeader));
+    control_->dataBytes = dataBytes_;
+    // 形式情報が揃ってから識別値を書き、途中で停止したファイルは次回も初期化し直す
+    std::atomic_thread_fence(std::memory_order_release);
+    control_->magic = kMagic;
+}
+
+std::size_t RecordRing::recover() {
+    std::uint64_t head = control_->head.load(std::memory_order_relaxed);
+    std::uint64_t tail = control_->tail.load(std::memory_order_relaxed);
+    if (head % kAlignment != 0 || tail % kAlignment != 0 || tail < head || tail - head > dataBytes_ ||
+        control_->sourceBytes.load(std::memory_order_relaxed) > kSourceBytes) {
+        std::memset(mappedView_, 0, mappedSize_);
+        initialize();
+        return 0;
+    }
+
+    // head から tail までを辿り、チェックサムの合う公開済みレコードだけを読み出し対象に残す
+    std::uint64_t sequence = control_->sequence.load(std::memory_order_relaxed);
+    std::size_t records = 0;
+    std::uint64_t position = head;
+    while (position < tail) {
+        RecordHeader &record = header(position);
+        std::size_t length = record.length.load(std::memory_order_relaxed);
+        // 共有時に確保直後に停止したレコードは、確保前に記録した範囲から長さを補う
+        AbandonedClaim found{};
+        if (length == 0 && findAbandonedClaim(position, found) && publishAbandoned(position, found)) {
+            continue;
+        }
+        // 長さが未書き込み（範囲の記録も無い）なら以降のレコードは辿れないため、ここで打ち切る
+        if (length == 0 || length % kAlignment != 0 || position % dataBytes_ + length > dataBytes_ ||
+            position + length > tail) {
+            break;
+        }
+        std::uint32_t state = record.state.load(std::memory_order_relaxed);
+        // 読み手は起動直後の消費者だけなので、読み手の数を 1 に戻す
+        record.readers.store(1, std::memory_order_relaxed);
+        if (state == kCommitted && length >= sizeof(RecordHeader) &&
+            sizeof(RecordHeader) + std::size_t{record.payloadSize} <= length &&
+            record.checksum == checksum(position)) {
+            ++records;
+            // 通し番号の表が記録より遅れていても（電源断など）、引き継いだ番号と重複させない
+            sequence = std::max(sequence, record.sequence + 1);
+            if (record.sourceId < SourceRegistry::kMaxSources) {
+                std::atomic<std::uint64_t> &next = sourceSequences_[record.sourceId];
+                next.store(std::max(next.load(std::memory_order_relaxed), record.sourceSequence + 1),
+                           std::memory_order_relaxed);
+            }
+        } else if (state != kPadding) {
+            // 書きかけ・取り消し・処理済みのレコードは消費者に読み飛ばさせる
+            record.state.store(kDiscarded, std::memory_order_relaxed);
+        }
+        position += length;
+    }
+    // 辿れなかった領域は空きへ戻す
+    clear(position, tail);
+
+    // 消費者が確保済みでも release していなかったレコードは、もう一度先頭から読み出させる
+    control_->sequence.store(sequence, std::memory_order_relaxed);
+    control_->tail.store(position, std::memory_order_relaxed);
+    control_->readCursor.store(head, std::memory_order_relaxed);
+    control_->reclaimPending.store(0, std::memory_order_relaxed);
+    control_->reclaiming.store(0, std::memory_order_release);
+    return records;
+}
+
+std::uint32_t RecordRing::checksum(std::uint64_t position) const {
+    // state と checksum 自身を除いたヘッダ項目、ペイロードの順に計算する
+    const RecordHeader &record = header(position);
+    const std::uint8_t *base = reinterpret_cast<const std::uint8_t *>(&record);
+    std::uint32_t crc = 0xFFFFFFFFU;
+    crc = updateCrc(crc, base + offsetof(RecordHeader, length),
+                    offsetof(RecordHeader, checksum) - offsetof(RecordHeader, length));
+    crc = updateCrc(crc, base + sizeof(RecordHeader), record.payloadSize);
+    return crc ^ 0xFFFFFFFFU;
+}
+
+void RecordRing::clear(std::uint64_t begin, std::uint64_t end) {
+    while (begin < end) {
+        std::size_t offset = static_cast<std::size_t>(begin % dataBytes_);
+        std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(end - begin, dataBytes_ - offset));
+        std::memset(data_ + offset, 0, chunk);
+        begin += chunk;
+    }
+}
+
+bool RecordRing::map(bool keepContents, const MapSettings &settings) {
+#ifdef _WIN32
+    // バックファイルを開き、引き継がない場合は一度切り詰めてから指定サイズに拡張する（領域は 0 で埋まる）
+    openFileHandle();
+    bool kept = keepContents && fileSize() == mappedSize_;
+    if (!kept) {
+        ensureFileSize(0);
+        ensureFileSize(mappedSize_);
+    }
+    mapView(mappedSize_);
+    prepare(settings);
+    return kept;
+#else
+    // POSIX システムでは open/ftruncate/mmap で共有領域を確保する
+    fileDescriptor_ = ::open(path_.c_str(), O_RDWR | O_CREAT, 0666);
+    if (fileDescriptor_ == -1) {
+        throw std::runtime_error("Failed to open backing file for memory-mapped buffer");
+    }
+    // 共有時は参加処理を終えるまで、他のプロセスによる切り詰めや初期化を待たせる
+    if (settings.shared) {
+        lockFile();
+    }
+#ifdef __linux__
+    // hugetlbfs 上のファイルは huge page 単位でしかマップできないため、マップ全体をその倍数へ切り上げる
+    struct statfs filesystem {};
+    if (::fstatfs(fileDescriptor_, &filesystem) == 0 &&
+        static_cast<unsigned long>(filesystem.f_type) == kHugetlbfsMagic) {
+        const std::size_t hugePage = static_cast<std::size_t>(filesystem.f_bsize);
+        report_.hugetlbfs = true;
+        report_.pageSize = hugePage;
+        mappedSize_ = (mappedSize_ + hugePage - 1) / hugePage * hugePage;
+    }
+#endif
+    // 同じサイズのファイルは内容を残し、それ以外は一度切り詰めてから拡張して 0 で埋まった状態にする
+    struct stat status {};
+    bool kept = keepContents && ::fstat(fileDescriptor_, &status) == 0 &&
+                static_cast<std::uint64_t>(status.st_size) == mappedSize_;
+    if (!kept && settings.shared && static_cast<std::uint64_t>(status.st_size) >= sizeof(Control)) {
+        // サイズの異なるリングを動作中のプロセスが使っていれば、切り詰めずに失敗させる
+        bool inUse = false;
+        for (std::size_t index = 0; index < kMaxParticipants && !inUse; ++index) {
+            const off_t offset = static_cast<off_t>(offsetof(Control, participants) + index * sizeof(Participant));
+            std::uint32_t pid = 0;
+            std::uint64_t startTime = 0;
+            inUse = ::pread(fileDescriptor_, &pid, sizeof(pid), offset + offsetof(Participant, pid)) ==
+                        static_cast<ssize_t>(sizeof(pid)) &&
+                    ::pread(fileDescriptor_, &startTime, sizeof(startTime),
+                            offset + offsetof(Participant, startTime)) == static_cast<ssize_t>(sizeof(startTime)) &&
+                    pid != 0 && isAlive(pid, startTime);
+        }
+        if (inUse) {
+            ::close(fileDescriptor_);
+            fileDescriptor_ = -1;
+            throw std::runtime_error("Shared buffer file is in use with a different size: " + path_);
+        }
+    }
+    if (!kept && (::ftruncate(fileDescriptor_, 0) == -1 ||
+                  ::ftruncate(fileDescriptor_, static_cast<off_t>(mappedSize_)) == -1)) {
+        ::close(fileDescriptor_);
+        fileDescriptor_ = -1;
+        throw std::runtime_error("Failed to resize backing file for memory-mapped buffer");
+    }
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    // 透過的 huge page を使う場合は、助言してから割り当てないと通常のページで埋まるため prepare に任せる
+    if (settings.prefault && !settings.hugePages) {
+        flags |= MAP_POPULATE;
+    }
+#endif
+    void *view = ::mmap(nullptr, mappedSize_, PROT_READ | PROT_WRITE, flags, fileDescriptor_, 0);
+    if (view == MAP_FAILED) {
+        ::close(fileDescriptor_);
+        fileDescriptor_ = -1;
+        throw std::runtime_error("Failed to map backing file into memory");
+    }
+    mappedView_ = static_cast<std::uint8_t *>(view);
+    prepare(settings);
+    return kept;
+#endif
+}
+
+void RecordRing::prepare(const MapSettings &settings) {
+    report_.memoryMapped = true;
+    report_.mappedBytes = mappedSize_;
+#ifdef _WIN32
+    SYSTEM_INFO system{};
+    GetSystemInfo(&system);
+    report_.pageSize = system.dwPageSize;
+    if (settings.hugePages) {
+        addNote(report_.notes, "huge pages are not supported for file mappings on Windows");
+    }
+#else
+    if (report_.pageSize == 0) {
+        report_.pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    }
+    // hugetlbfs 上では既に huge page でマップされているため助言は不要
+    if (settings.hugePages && !report_.hugetlbfs) {
+#ifdef MADV_HUGEPAGE
+        if (::madvise(mappedView_, mappedSize_, MADV_HUGEPAGE) == 0) {
+            report_.hugePagesAdvised = true;
+        } else {
+            addNote(report_.notes, std::string("madvise(MADV_HUGEPAGE) failed: ") + std::strerror(errno));
+        }
+#else
+        addNote(report_.notes, "transparent huge pages are not available on this platform");
+#endif
+    }
+#endif
+    if (settings.prefault) {
+        if (!shared_) {
+            // 各ページへ同じ値を書き戻し、読み込みと書き込みの両方のフォールトを起動時に済ませる
+            // （共有マップでは MAP_POPULATE だけだと、最初の書き込み時に再びフォールトすることがある）
+            touchPages(true);
+            report_.prefaulted = true;
+        } else {
+            // 共有時は動作中のプロセスが同じページを書き換えているため、値を書き戻すと更新を取り消しかねない
+            // 書き込みを伴わずに割り当てられればそれを使い、できなければ attach で単独と分かってから書き込む
+#ifdef MADV_POPULATE_WRITE
+            report_.prefaulted = ::madvise(mappedView_, mappedSize_, MADV_POPULATE_WRITE) == 0;
+#endif
+            if (!report_.prefaulted) {
+                touchPages(false);
+                prefaultPending_ = true;
+            }
+        }
+    }
+    if (settings.lock) {
+        // 上限（RLIMIT_MEMLOCK など）を超えて固定できなくても、固定せずに動作を続ける
+#ifdef _WIN32
+        if (VirtualLock(mappedView_, mappedSize_)) {
+            report_.locked = true;
+        } else {
+            addNote(report_.notes, "VirtualLock failed (error " + std::to_string(GetLastError()) + ")");
+        }
+#else
+        if (::mlock(mappedView_, mappedSize_) == 0) {
+            report_.locked = true;
+        } else {
+            addNote(report_.notes, std::string("mlock failed: ") + std::strerror(errno) + " (check RLIMIT_MEMLOCK)");
+        }
+#endif
+    }
+}
+
+void RecordRing::touchPages(bool write) {
+    volatile std::uint8_t *bytes = mappedView_;
+    for (std::size_t offset = 0; offset < mappedSize_; offset += report_.pageSize) {
+        if (write) {
+            bytes[offset] = bytes[offset];
+        } else {
+            (void)bytes[offset];
+        }
+    }
+}
+
+MappingReport RecordRing::mappingReport() const {
+    MappingReport report = report_;
+#ifdef __linux__
+    // /proc/self/smaps からこのマップの項目を探し、常駐・固定・huge page のバイト数を読む
+    std::ostringstream start;
+    start << std::hex << std::setw(8) << std::setfill('0') << reinterpret_cast<std::uintptr_t>(mappedView_) << '-';
+    const std::string prefix = start.str();
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool inside = false;
+    while (std::getline(smaps, line)) {
+        if (!inside) {
+            inside = line.compare(0, prefix.size(), prefix) == 0;
+            continue;
+        }
+        // 次のマップの見出し行（コロンより前に空白がある）に達したら終える
+        std::size_t colon = line.find(':');
+        if (colon == std::string::npos || line.find(' ') < colon) {
+            break;
+        }
+        const std::string key = line.substr(0, colon);
+        auto kilobytes = [&line, colon]() {
+            return static_cast<std::size_t>(std::strtoull(line.c_str() + colon + 1, nullptr, 10)) * 1024;
+        };
+        if (key == "Rss") {
+            report.residentBytes += kilobytes();
+        } else if (key == "Locked") {
+            report.lockedBytes += kilobytes();
+        } else if (key == "AnonHugePages" || key == "ShmemPmdMapped" || key == "FilePmdMapped") {
+            report.hugePageBytes += kilobytes();
+        } else if (key == "Shared_Hugetlb" || key == "Private_Hugetlb") {
+            // hugetlbfs のページは Rss に含まれないため、常駐分にも加える
+            report.hugePageBytes += kilobytes();
+            report.residentBytes += kilobytes();
+        }
+    }
+#endif
+    return report;
+}
+
+void RecordRing::unmap() {
+#ifdef _WIN32
+    // Windows ではビュー→マッピング→ファイルの順でクローズする（未消費分を次回へ残すため先に書き出す）
+    if (mappedView_) {
+        FlushViewOfFile(mappedView_, 0);
+    }
+    unmapView();
+    closeMappingHandle();
+    closeFileHandle();
+#else
+    // POSIX では内容をファイルへ書き出してからマップ解除とクローズを行う
+    if (mappedView_) {
+        ::msync(mappedView_, mappedSize_, MS_SYNC);
+        ::munmap(mappedView_, mappedSize_);
+    }
+    if (fileDescriptor_ != -1) {
+        ::close(fileDescriptor_);
+        fileDescriptor_ = -1;
+    }
+#endif
+    mappedView_ = nullptr;
+    control_ = nullptr;
+    sources_ = nullptr;
+    sourceSequences_ = nullptr;
+    data_ = nullptr;
+}
+
+#ifdef _WIN32
+void RecordRing::openFileHandle() {
+    // Windows API でバックファイルを開く（存在しなければ作成）
+    HANDLE handle = CreateFileA(path_.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open backing file for memory-mapped buffer");
+    }
+    fileHandle_ = handle;
+}
+
+std::uint64_t RecordRing::fileSize() const {
+    // 既存ファイルのサイズを取得する（取得できなければ 0 として扱う）
+    LARGE_INTEGER size{};
+    if (GetFileSizeEx(static_cast<HANDLE>(fileHandle_), &size) == 0) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>(size.QuadPart);
+}
+
+void RecordRing::ensureFileSize(std::uint64_t size) {
+    // ファイルポインタを移動して指定サイズに切り上げる
+    LARGE_INTEGER li{};
+    li.QuadPart = size;
+    if (SetFilePointerEx(static_cast<HANDLE>(fileHandle_), li, nullptr, FILE_BEGIN) == 0 ||
+        SetEndOfFile(static_cast<HANDLE>(fileHandle_)) == 0) {
+        CloseHandle(static_cast<HANDLE>(fileHandle_));
+        fileHandle_ = reinterpret_cast<void *>(-1);
+        throw std::runtime_error("Failed to resize backing file for memory-mapped buffer");
+    }
+}
+
+void RecordRing::mapView(std::uint64_t size) {
+    // 指定サイズでファイルマッピングを作成し、全域をマップする
+    HANDLE mapping = CreateFileMappingA(static_cast<HANDLE>(fileHandle_), nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFF), nullptr);
+    if (!mapping) {
+        CloseHandle(static_cast<HANDLE>(fileHandle_));
+        fileHandle_ = reinterpret_cast<void *>(-1);
+        throw std::runtime_error("Failed to create file mapping for memory-mapped buffer");
+    }
+    mappingHandle_ = mapping;
+    void *view = MapViewOfFile(mappingHandle_, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!view) {
+        CloseHandle(mappingHandle_);
+        mappingHandle_ = nullptr;
+        CloseHandle(static_cast<HANDLE>(fileHandle_));
+        fileHandle_ = reinterpret_cast<void *>(-1);
+        throw std::runtime_error("Failed to map backing file into memory");
+    }
+    mappedView_ = static_cast<std::uint8_t *>(view);
+}
+
+void RecordRing::unmapView() {
+    // マップ済みビューを解放する
+    if (mappedView_) {
+        UnmapViewOfFile(mappedView_);
+        mappedView_ = nullptr;
+    }
+}
+
+void RecordRing::closeMappingHandle() {
+    // ファイルマッピングハンドルをクローズする
+    if (mappingHandle_) {
+        CloseHandle(static_cast<HANDLE>(mappingHandle_));
+        mappingHandle_ = nullptr;
+    }
+}
+
+void RecordRing::closeFileHandle() {
+    // 元のファイルハンドルをクローズする
+    if (fileHandle_ != reinterpret_cast<void *>(-1)) {
+        CloseHandle(static_cast<HANDLE>(fileHandle_));
+        fileHandle_ = reinterpret_cast<void *>(-1);
+    }
+}
+
+void RecordRing::lockFile() {
+    // 共有は POSIX でのみ利用できるため、プロセス間の排他は行わない
+}
+
+void RecordRing::unlockFile() {}
+#else
+void RecordRing::lockFile() {
+    while (::flock(fileDescriptor_, LOCK_EX) == -1) {
+        if (errno != EINTR) {
+            throw std::runtime_error("Failed to lock backing file for memory-mapped buffer");
+        }
+    }
+}
+
+void RecordRing::unlockFile() {
+    ::flock(fileDescriptor_, LOCK_UN);
+}
+#endif
+
+} // namespace global_buffer
@@ -0,0 +1,55 @@
+#include "framework4cpp/Schema.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace global_buffer {
+
+Schema::Schema(FieldNames fieldNames, std::vector<Column> columns)
+    : fieldNames_(std::move(fieldNames)), columns_(std::move(columns)) {
+    // フィールド名が空の場合はデフォルトのフィールド名を採用する
+    if (fieldNames_.source.empty()) {
+        fieldNames_.source = FieldNames{}.source;
+    }
+    if (fieldNames_.timestamp.empty()) {
+        fieldNames_.timestamp = FieldNames{}.timestamp;
+    }
+    if (fieldNames_.payload.empty()) {
+        fieldNames_.payload = FieldNames{}.payload;
+    }
+    if (fieldNames_.sequence.empty()) {
+        fieldNames_.sequence = FieldNames{}.sequence;
+    }
+    if (fieldNames_.sourceSequence.empty()) {
+        fieldNames_.sourceSequence = FieldNames{}.sourceSequence;
+    }
+    // 列の指定が無ければ従来の出力順にし、通し番号の列は末尾へ置く（出力するかは出力側の設定で決める）
+    if (columns_.empty()) {
+        columns_ = {Column::Timestamp, Column::Source, Column::Payload, Column::Sequence, Column::SourceSequence};
+    }
+    // 同じ列を重複して出力することはできない
+    for (auto it = columns_.begin(); it != columns_.end(); ++it) {
+        if (std::find(it + 1, columns_.end(), *it) != columns_.end()) {
+            throw std::invalid_argument("Schema columns must not contain duplicates");
+        }
+    }
+}
+
+const std::string &Schema::name(Column column) const {
+    switch (column) {
+    case Column::Timestamp:
+        return fieldNames_.timestamp;
+    case Column::Source:
+        return fieldNames_.source;
+    case Column::Payload:
+        return fieldNames_.payload;
+    case Column::Sequence:
+        return fieldNames_.sequence;
+    case Column::SourceSequence:
+        return fieldNames_.sourceSequence;
+    }
+    throw std::invalid_argument("Unknown schema column");
+}
+
+} // namespace global_buffer
@@ -0,0 +1,62 @@
+#include "framework4cpp/SourceRegistry.h"
+
+#include <stdexcept>
+
+namespace global_buffer {
+
+SourceRegistry::SourceRegistry() : names_(new std::unique_ptr<const std::string>[kMaxSources]) {
+    // 番号 0 は名前の無い発生元として予約しておく
+    names_[kAnonymousSource] = std::make_unique<const std::string>();
+    ids_.emplace(std::string(), kAnonymousSource);
+    size_.store(1, std::memory_order_release);
+}
+
+SourceId SourceRegistry::intern(std::string_view name, bool *added) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (added) {
+        *added = false;
+    }
+    auto found = ids_.find(std::string(name));
+    if (found != ids_.end()) {
+        return found->second;
+    }
+    std::size_t next = size_.load(std::memory_order_relaxed);
+    if (next >= kMaxSources) {
+        throw std::runtime_error("Too many data sources registered");
+    }
+    // 名前を格納してから番号を公開し、参照側がロック無しで読めるようにする
+    names_[next] = std::make_unique<const std::string>(name);
+    ids_.emplace(std::string(name), static_cast<SourceId>(next));
+    size_.store(next + 1, std::memory_order_release);
+    if (added) {
+        *added = true;
+    }
+    return static_cast<SourceId>(next);
+}
+
+void SourceRegistry::restore(SourceId id, std::string_view name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id >= kMaxSources) {
+        throw std::runtime_error("Too many data sources registered");
+    }
+    if (names_[id]) {
+        return;
+    }
+    names_[id] = std::make_unique<const std::string>(name);
+    ids_.emplace(std::string(name), id);
+    // 間の番号が欠けていても、以降の登録は復元した最大の番号の次から行う
+    if (id >= size_.load(std::memory_order_relaxed)) {
+        size_.store(static_cast<std::size_t>(id) + 1, std::memory_order_release);
+    }
+}
+
+std::string_view SourceRegistry::name(SourceId id) const {
+    if (!contains(id)) {
+        throw std::out_of_range("Unknown data source id");
+    }
+    // 復元時に欠けた番号は名前の無い発生元として扱う
+    const std::unique_ptr<const std::string> &entry = names_[id];
+    return entry ? std::string_view(*entry) : std::string_view();
+}
+
+} // namespace global_buffer
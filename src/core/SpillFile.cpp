@@ -0,0 +1,80 @@
+#include "framework4cpp/SpillFile.h"
+
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <utility>
+
+namespace global_buffer {
+
+SpillFile::SpillFile(std::string path) : path_(std::move(path)) {
+    if (path_.empty()) {
+        throw std::invalid_argument("Spill file path must not be empty");
+    }
+    file_.open(path_, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file_) {
+        throw std::runtime_error("Failed to open spill file: " + path_);
+    }
+}
+
+SpillFile::~SpillFile() {
+    // 退避したデータはプロセスの実行中にのみ意味を持つため、終了時に削除する
+    file_.close();
+    std::remove(path_.c_str());
+}
+
+void SpillFile::append(const BufferItem &item) {
+    RecordHeader header{};
+    header.timestamp =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(item.timestamp.time_since_epoch()).count();
+    header.sequence = item.sequence;
+    header.sourceSequence = item.sourceSequence;
+    header.source = item.source;
+    header.payloadSize = static_cast<std::uint32_t>(item.payload.size());
+
+    file_.clear();
+    file_.seekp(static_cast<std::streamoff>(writeOffset_));
+    file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    if (!item.payload.empty()) {
+        file_.write(reinterpret_cast<const char *>(item.payload.data()),
+                    static_cast<std::streamsize>(item.payload.size()));
+    }
+    // 読み出し側が同じストリームで直後に参照するため、書き込みを確定させておく
+    file_.flush();
+    if (!file_) {
+        throw std::runtime_error("Failed to write spill file: " + path_);
+    }
+    writeOffset_ += sizeof(header) + item.payload.size();
+    ++pending_;
+}
+
+bool SpillFile::read(BufferItem &item) {
+    if (pending_ == 0) {
+        return false;
+    }
+    RecordHeader header{};
+    file_.clear();
+    file_.seekg(static_cast<std::streamoff>(readOffset_));
+    file_.read(reinterpret_cast<char *>(&header), sizeof(header));
+    item.payload.resizeForOverwrite(header.payloadSize);
+    if (header.payloadSize > 0) {
+        file_.read(reinterpret_cast<char *>(item.payload.data()), static_cast<std::streamsize>(header.payloadSize));
+    }
+    if (!file_) {
+        throw std::runtime_error("Failed to read spill file: " + path_);
+    }
+    item.source = header.source;
+    item.sequence = header.sequence;
+    item.sourceSequence = header.sourceSequence;
+    item.timestamp = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(header.timestamp)));
+    readOffset_ += sizeof(header) + header.payloadSize;
+    // 全て読み出したら先頭から書き直し、ファイルが際限なく伸びないようにする
+    if (--pending_ == 0) {
+        readOffset_ = 0;
+        writeOffset_ = 0;
+    }
+    return true;
+}
+
+} // namespace global_buffer
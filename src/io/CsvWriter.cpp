@@ -1,14 +1,33 @@
 #include "framework4cpp/CsvWriter.h"
 
+#include <algorithm>
+#include <charconv>
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <iterator>
+#include <limits>
 #include <stdexcept>
+#include <utility>
 
 namespace framework4cpp {
 
 CsvWriter::CsvWriter(const CsvSettings &settings, GlobalBuffer &buffer)
-    : settings_(settings), buffer_(buffer) {}
+    : settings_(settings), buffer_(buffer),
+      hexLayout_(settings.payloadLayout == PayloadLayout::Packed ? HexLayout::Packed : HexLayout::Spaced),
+      timestamp_(settings.timestampFormat) {
+    settings_.writeBufferBytes = std::max(settings_.writeBufferBytes, kMinWriteBufferBytes);
+    // 列の並びはバッファの生存中に変わらないため、ここで 1 度だけ取得する
+    for (Column column : buffer_.schema().columns()) {
+        // タイムスタンプ列は設定で無効化されていれば出力しない
+        if (column == Column::Timestamp && !settings_.includeTimestamp) {
+            continue;
+        }
+        // 通し番号の列は設定で有効化されたときだけ出力する
+        if ((column == Column::Sequence || column == Column::SourceSequence) && !settings_.includeSequence) {
+            continue;
+        }
+        columns_.push_back(column);
+    }
+}
 
 CsvWriter::~CsvWriter() {
     // オブジェクト破棄時に動作中であれば停止する
@@ -23,13 +42,16 @@ void CsvWriter::start() {
     }
 
     // 出力ファイルを追記モードで開く
-    output_.open(settings_.outputPath, std::ios::out | std::ios::app);
-    if (!output_.is_open()) {
+    try {
+        output_.open(settings_.outputPath, settings_.preallocateBytes);
+    } catch (...) {
         running_.store(false);
-        throw std::runtime_error("Failed to open CSV output: " + settings_.outputPath);
+        throw;
     }
 
-    // バックグラウンドで書き込み処理を行うスレッドを起動
+    // バックグラウンドで整形を行うスレッドと、整形済みの行をファイルへ書き込むスレッドを起動
+    ioRunning_ = true;
+    ioWorker_ = std::thread(&CsvWriter::writeLoop, this);
     worker_ = std::thread(&CsvWriter::run, this);
 }
 
@@ -42,113 +64,210 @@ void CsvWriter::stop() {
     if (worker_.joinable()) {
         worker_.join();
     }
-    if (output_.is_open()) {
-        // ファイル出力を保護しつつフラッシュ・クローズする
-        std::lock_guard<std::mutex> lock(fileMutex_);
-        output_.flush();
-        output_.close();
+    // 整形スレッドが最後に渡した分を書き終えてから、書き込みスレッドを止める
+    if (ioWorker_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(handoffMutex_);
+            ioRunning_ = false;
+        }
+        handoffCondition_.notify_all();
+        ioWorker_.join();
     }
+    output_.close();
 }
 
 void CsvWriter::run() {
     using clock = std::chrono::steady_clock;
-    // 次にフラッシュする時刻を初期化する
+    // 次に書き出す時刻を初期化する
     auto nextFlush = clock::now() + settings_.flushInterval;
+    // データが無いときに待機する上限（フラッシュ周期を守れる長さにする）
+    const auto maxWait = settings_.flushInterval.count() > 0 ? settings_.flushInterval : kIdleWait;
 
+    // 取り出したデータはバッファ内を直接参照して整形し、整形後に返却する（ペイロードを複製しない）
+    ReadLease batch;
+    // 入れ替えて使う 2 つの領域を書き込み単位分ずつ確保しておく（書き込みスレッドへはまだ何も渡していない）
+    pending_.reserve(settings_.writeBufferBytes);
+    written_.reserve(settings_.writeBufferBytes);
     while (true) {
-        // グローバルバッファから 1 件取り出す（終了時は nullopt）
-        auto item = buffer_.pop();
-        if (!item.has_value()) {
-            if (!running_.load()) {
-                // 停止要求が来ておりデータが無ければループ終了
-                break;
+        // グローバルバッファに溜まっている分をまとめて取り出す（前回の分はここで返却され、終了時や期限切れは 0 件）
+        std::size_t count = buffer_.lease(batch, kMaxBatchItems, maxWait);
+        if (count == 0 && !running_.load()) {
+            // 停止要求が来ておりデータが無ければループ終了
+            break;
+        }
+
+        if (count > 0) {
+            // 書き出し待ちの領域の末尾へ続けて整形する（容量を使い回すため、定常状態では確保が起きない）
+            for (const auto &item : batch) {
+                appendRecord(item, pending_);
+                pending_.push_back('\n');
+                // 発生元ごとの番号の抜けを記録し、再開位置を進める
+                gaps_.observe(item.source, item.sourceSequence);
+                if (!lastSequence_ || item.sequence > *lastSequence_) {
+                    lastSequence_ = item.sequence;
+                }
             }
-            continue;
+            // 整形を終えた領域は、書き出しを待たずに生産者へ返す
+            batch.release();
         }
 
-        // 取得したデータを CSV 形式に整形する
-        std::string line = formatRecord(*item);
-        {
-            // ファイル操作の競合を防ぐためにロックする
-            std::lock_guard<std::mutex> lock(fileMutex_);
-            output_ << line << '\n';
+        // フラッシュ間隔 0 の場合は毎回、それ以外は書き込み単位まで溜まるか周期が来た時点で書き込み側へ渡す
+        // （書き込み側がまだ前の分を書いていれば整形を続け、渡せたときだけ次の周期を決め直す）
+        if (settings_.flushInterval.count() == 0 || pending_.size() >= settings_.writeBufferBytes ||
+            clock::now() >= nextFlush) {
+            if (handOff(false)) {
+                nextFlush = clock::now() + settings_.flushInterval;
+            }
+        }
+    }
+    // 終了前に溜まっている分を書き込み側へ渡す
+    handOff(true);
+}
+
+bool CsvWriter::handOff(bool wait) {
+    if (pending_.empty()) {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(handoffMutex_);
+    if (writing_) {
+        // 書き込み中は溜められる上限までは待たずに整形を続け、それを超えたら書き込みの完了を待つ
+        if (!wait && pending_.size() < settings_.writeBufferBytes * kMaxPendingBuffers) {
+            return false;
         }
+        handoffCondition_.wait(lock, [this]() { return !writing_; });
+    }
+    // 領域を入れ替えて渡す（中身は複製せず、互いの容量を使い回す）
+    std::swap(pending_, written_);
+    writing_ = true;
+    handoffCondition_.notify_all();
+    return true;
+}
 
-        if (settings_.flushInterval.count() == 0) {
-            // フラッシュ間隔 0 の場合は毎回即時フラッシュ
-            std::lock_guard<std::mutex> lock(fileMutex_);
-            output_.flush();
-        } else if (clock::now() >= nextFlush) {
-            // 設定された周期でフラッシュを実行
-            std::lock_guard<std::mutex> lock(fileMutex_);
-            output_.flush();
-            nextFlush = clock::now() + settings_.flushInterval;
+void CsvWriter::writeLoop() {
+    std::unique_lock<std::mutex> lock(handoffMutex_);
+    while (true) {
+        handoffCondition_.wait(lock, [this]() { return writing_ || !ioRunning_; });
+        if (!writing_) {
+            // 停止要求が来ており、渡された分も無ければ終了
+            break;
         }
+        // 整形スレッドは待たせずに pending_ への整形を続けられるよう、ロックを外して書き込む
+        lock.unlock();
+        try {
+            output_.write(written_.data(), written_.size());
+            if (settings_.syncWrites) {
+                output_.sync();
+            }
+        } catch (const std::exception &ex) {
+            // 書き込めなかった分は捨てて続行し、最初の失敗だけを報告用に残す
+            if (!writeError_) {
+                writeError_ = ex.what();
+            }
+        }
+        written_.clear();
+        lock.lock();
+        writing_ = false;
+        handoffCondition_.notify_all();
     }
 }
 
-std::string CsvWriter::formatRecord(const BufferItem &item) const {
-    std::ostringstream oss;
+void CsvWriter::appendRecord(const ItemView &item, std::string &out) const {
     bool firstColumn = true;
-    // 列を追加するときの共通処理をラムダでまとめる
-    auto appendColumn = [&](const std::string &value) {
+    // 2 列目以降は区切り文字を挿入する
+    auto separate = [&]() {
         if (!firstColumn) {
-            // 2 列目以降は区切り文字を挿入
-            oss << settings_.delimiter;
+            out.push_back(settings_.delimiter);
         } else {
             firstColumn = false;
         }
-        if (settings_.quoteStrings) {
-            // 文字列をエスケープして引用符で囲む
-            oss << '"' << escape(value) << '"';
-        } else {
-            oss << value;
-        }
     };
 
-    if (settings_.includeTimestamp) {
-        // タイムスタンプをローカル時刻に変換して整形
-        std::time_t time = std::chrono::system_clock::to_time_t(item.timestamp);
-        std::tm tm{};
-#ifdef _WIN32
-        localtime_s(&tm, &time);
-#else
-        localtime_r(&time, &tm);
-#endif
-        std::ostringstream timeStream;
-        timeStream << std::put_time(&tm, settings_.timestampFormat.c_str());
-        appendColumn(timeStream.str());
+    // バッファの Schema が定める列の並びで出力する
+    for (Column column : columns_) {
+        separate();
+        switch (column) {
+        case Column::Timestamp:
+            // タイムスタンプをローカル時刻に変換して整形（同じ秒の間は秒未満の桁だけを書き換える）
+            if (settings_.quoteStrings) {
+                // 書式に二重引用符が含まれることもあるため、書き込んだ後にその場でエスケープする
+                out.push_back('"');
+                const std::size_t begin = out.size();
+                timestamp_.append(item.timestamp, out);
+                escapeFrom(out, begin);
+                out.push_back('"');
+            } else {
+                timestamp_.append(item.timestamp, out);
+            }
+            break;
+        case Column::Source:
+            // データの発生源を追加（整形済みの文字列をそのまま使う）
+            out.append(sourceColumn(item.source));
+            break;
+        case Column::Payload: {
+            // ペイロードを出力先へ直接 16 進文字列として書き込む（16 進の文字はエスケープ不要）
+            if (settings_.quoteStrings) {
+                out.push_back('"');
+            }
+            const std::size_t begin = out.size();
+            out.resize(begin + hexEncodedSize(item.payloadSize, hexLayout_));
+            encodeHex(item.payload, item.payloadSize, &out[begin], hexLayout_);
+            if (settings_.quoteStrings) {
+                out.push_back('"');
+            }
+            break;
+        }
+        case Column::Sequence:
+            // 通し番号は数値のため引用符で囲まない
+            appendNumber(item.sequence, out);
+            break;
+        case Column::SourceSequence:
+            appendNumber(item.sourceSequence, out);
+            break;
+        }
     }
+}
 
-    // データの発生源を追加
-    appendColumn(item.source);
-
-    // ペイロードを 16 進文字列へ変換して追加
-    std::ostringstream payload;
-    payload << std::hex << std::setfill('0');
-    for (std::size_t i = 0; i < item.payload.size(); ++i) {
-        payload << std::setw(2) << static_cast<unsigned int>(item.payload[i]);
-        if (i + 1 < item.payload.size()) {
-            payload << ' ';
+const std::string &CsvWriter::sourceColumn(SourceId id) const {
+    if (id >= sourceColumns_.size()) {
+        sourceColumns_.resize(static_cast<std::size_t>(id) + 1);
+    }
+    std::optional<std::string> &column = sourceColumns_[id];
+    if (!column) {
+        // 発生元の名前は変わらないため、初回に整形した結果を使い回す
+        std::string text(buffer_.sourceName(id));
+        if (settings_.quoteStrings) {
+            text.insert(text.begin(), '"');
+            escapeFrom(text, 1);
+            text.push_back('"');
         }
+        column = std::move(text);
     }
-    appendColumn(payload.str());
+    return *column;
+}
 
-    return oss.str();
+void CsvWriter::appendNumber(std::uint64_t value, std::string &out) {
+    char digits[std::numeric_limits<std::uint64_t>::digits10 + 1];
+    const auto result = std::to_chars(std::begin(digits), std::end(digits), value);
+    out.append(digits, result.ptr);
 }
 
-std::string CsvWriter::escape(const std::string &value) {
-    std::string escaped;
-    escaped.reserve(value.size());
-    for (char ch : value) {
-        // 文字をコピーし、必要なら二重引用符をエスケープ
-        escaped.push_back(ch);
+void CsvWriter::escapeFrom(std::string &out, std::size_t begin) {
+    const auto quotes = static_cast<std::size_t>(std::count(out.begin() + begin, out.end(), '"'));
+    if (quotes == 0) {
+        return;
+    }
+    // 末尾から後ろへずらしながら、二重引用符を 2 つ重ねる（最後の引用符より前は動かさずに済む）
+    std::size_t read = out.size();
+    out.resize(out.size() + quotes);
+    std::size_t write = out.size();
+    for (std::size_t remaining = quotes; remaining > 0;) {
+        const char ch = out[--read];
+        out[--write] = ch;
         if (ch == '"') {
-            escaped.push_back('"');
+            out[--write] = '"';
+            --remaining;
         }
     }
-    return escaped;
 }
 
 } // namespace framework4cpp
-
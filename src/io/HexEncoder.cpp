@@ -0,0 +1,224 @@
+#include "framework4cpp/HexEncoder.h"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define FRAMEWORK4CPP_HEX_X86 1
+#include <immintrin.h>
+#endif
+
+namespace framework4cpp {
+
+namespace {
+
+constexpr char kDigits[] = "0123456789abcdef";
+
+// バイト値ごとの 2 文字（上位・下位の桁）を引く表
+constexpr std::array<char, 512> makePairs() {
+    std::array<char, 512> pairs{};
+    for (std::size_t value = 0; value < 256; ++value) {
+        pairs[value * 2] = kDigits[value >> 4];
+        pairs[value * 2 + 1] = kDigits[value & 0x0f];
+    }
+    return pairs;
+}
+
+constexpr std::array<char, 512> kPairs = makePairs();
+
+// 表を引いて 1 バイトずつ変換する（ベクトル化した実装の端数処理にも使う）
+std::size_t encodeScalar(const std::uint8_t *data, std::size_t size, char *out, HexLayout layout) {
+    char *cursor = out;
+    if (layout == HexLayout::Spaced) {
+        for (std::size_t i = 0; i < size; ++i) {
+            if (i > 0) {
+                *cursor++ = ' ';
+            }
+            std::memcpy(cursor, &kPairs[data[i] * 2], 2);
+            cursor += 2;
+        }
+    } else {
+        for (std::size_t i = 0; i < size; ++i) {
+            std::memcpy(cursor, &kPairs[data[i] * 2], 2);
+            cursor += 2;
+        }
+    }
+    return static_cast<std::size_t>(cursor - out);
+}
+
+#ifdef FRAMEWORK4CPP_HEX_X86
+
+// 区切り付きの出力 48 文字（入力 16 バイト分）を 16 文字ずつ 3 つのベクトルに分けたときの、
+// 各位置へ上位の桁・下位の桁を運ぶ pshufb の添字（0x80 はその位置を 0 にする）と、空白を置く位置
+struct SpacedMasks {
+    alignas(16) std::uint8_t high[3][16];
+    alignas(16) std::uint8_t low[3][16];
+    alignas(16) std::uint8_t space[3][16];
+};
+
+constexpr SpacedMasks makeSpacedMasks() {
+    SpacedMasks masks{};
+    for (std::size_t part = 0; part < 3; ++part) {
+        for (std::size_t lane = 0; lane < 16; ++lane) {
+            const std::size_t position = part * 16 + lane;
+            const auto byte = static_cast<std::uint8_t>(position / 3);
+            masks.high[part][lane] = position % 3 == 0 ? byte : 0x80;
+            masks.low[part][lane] = position % 3 == 1 ? byte : 0x80;
+            masks.space[part][lane] = position % 3 == 2 ? ' ' : 0;
+        }
+    }
+    return masks;
+}
+
+constexpr SpacedMasks kSpacedMasks = makeSpacedMasks();
+
+__attribute__((target("ssse3"))) std::size_t encodeSsse3(const std::uint8_t *data, std::size_t size, char *out,
+                                                         HexLayout layout) {
+    const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i *>(kDigits));
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    std::size_t i = 0;
+    char *cursor = out;
+    if (layout == HexLayout::Spaced) {
+        __m128i high[3];
+        __m128i low[3];
+        __m128i space[3];
+        for (std::size_t part = 0; part < 3; ++part) {
+            high[part] = _mm_load_si128(reinterpret_cast<const __m128i *>(kSpacedMasks.high[part]));
+            low[part] = _mm_load_si128(reinterpret_cast<const __m128i *>(kSpacedMasks.low[part]));
+            space[part] = _mm_load_si128(reinterpret_cast<const __m128i *>(kSpacedMasks.space[part]));
+        }
+        // 16 バイトを "xx " の 48 文字にする。最後の 1 バイトの後に空白を置かないよう、末尾の塊は 1 バイトずつ変換する
+        for (; i + 16 < size; i += 16) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            const __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+            const __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, nibble));
+            for (std::size_t part = 0; part < 3; ++part) {
+                const __m128i chars = _mm_or_si128(
+                    _mm_or_si128(_mm_shuffle_epi8(hi, high[part]), _mm_shuffle_epi8(lo, low[part])), space[part]);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(cursor + part * 16), chars);
+            }
+            cursor += 48;
+        }
+    } else {
+        for (; i + 16 <= size; i += 16) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            const __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble));
+            const __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(bytes, nibble));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(cursor), _mm_unpacklo_epi8(hi, lo));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(cursor + 16), _mm_unpackhi_epi8(hi, lo));
+            cursor += 32;
+        }
+    }
+    return static_cast<std::size_t>(cursor - out) + encodeScalar(data + i, size - i, cursor, layout);
+}
+
+__attribute__((target("avx2"))) std::size_t encodeAvx2(const std::uint8_t *data, std::size_t size, char *out,
+                                                       HexLayout layout) {
+    // 区切り付きの表記は 128 ビットの半分ごとにしか並べ替えられず、幅を広げても書き出しの並べ直しが増えて速くならない
+    // （1 KB で SSSE3 と同等以下だった）ため、SSSE3 の実装に任せる
+    if (layout == HexLayout::Spaced) {
+        return encodeSsse3(data, size, out, layout);
+    }
+    const __m256i digits =
+        _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(kDigits)));
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    std::size_t i = 0;
+    char *cursor = out;
+    for (; i + 32 <= size; i += 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        const __m256i hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble));
+        const __m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, nibble));
+        // unpack も半分ごとに働くため、バイト 0-7・8-15・16-23・24-31 の順に並べ直す
+        const __m256i first = _mm256_unpacklo_epi8(hi, lo);
+        const __m256i second = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(cursor), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(cursor + 32),
+                            _mm256_permute2x128_si256(first, second, 0x31));
+        cursor += 64;
+    }
+    // 32 バイトに満たない残りは SSSE3 の実装で 16 バイトずつ変換する
+    return static_cast<std::size_t>(cursor - out) + encodeSsse3(data + i, size - i, cursor, layout);
+}
+
+#endif
+
+using Encoder = std::size_t (*)(const std::uint8_t *, std::size_t, char *, HexLayout);
+
+struct Dispatch {
+    HexKernel kernel;
+    Encoder encode;
+    const char *name;
+};
+
+Dispatch kernelDispatch(HexKernel kernel) {
+    switch (kernel) {
+#ifdef FRAMEWORK4CPP_HEX_X86
+    case HexKernel::Avx2:
+        return {HexKernel::Avx2, encodeAvx2, "avx2"};
+    case HexKernel::Ssse3:
+        return {HexKernel::Ssse3, encodeSsse3, "ssse3"};
+#endif
+    default:
+        return {HexKernel::Scalar, encodeScalar, "scalar"};
+    }
+}
+
+// 実行中の CPU で使える最も幅の広い実装を選ぶ
+Dispatch selectEncoder() {
+    for (HexKernel kernel : {HexKernel::Avx2, HexKernel::Ssse3}) {
+        if (hexKernelAvailable(kernel)) {
+            return kernelDispatch(kernel);
+        }
+    }
+    return kernelDispatch(HexKernel::Scalar);
+}
+
+const Dispatch &dispatch() {
+    static const Dispatch selected = selectEncoder();
+    return selected;
+}
+
+} // namespace
+
+std::size_t encodeHex(const std::uint8_t *data, std::size_t size, char *out, HexLayout layout) {
+    // 短いデータは判定と端数処理の手間の方が大きいため、表引きで済ませる
+    if (size < 16) {
+        return encodeScalar(data, size, out, layout);
+    }
+    return dispatch().encode(data, size, out, layout);
+}
+
+const char *hexEncoderName() {
+    return dispatch().name;
+}
+
+HexKernel selectedHexKernel() {
+    return dispatch().kernel;
+}
+
+bool hexKernelAvailable(HexKernel kernel) {
+    switch (kernel) {
+    case HexKernel::Scalar:
+        return true;
+#ifdef FRAMEWORK4CPP_HEX_X86
+    case HexKernel::Ssse3:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3");
+    case HexKernel::Avx2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+std::size_t encodeHexWith(HexKernel kernel, const std::uint8_t *data, std::size_t size, char *out, HexLayout layout) {
+    if (!hexKernelAvailable(kernel)) {
+        throw std::invalid_argument("Hex kernel is not available on this CPU");
+    }
+    return kernelDispatch(kernel).encode(data, size, out, layout);
+}
+
+} // namespace framework4cpp
@@ -0,0 +1,129 @@
+#include "framework4cpp/OutputFile.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace framework4cpp {
+
+OutputFile::~OutputFile() {
+    close();
+}
+
+void OutputFile::open(const std::string &path, std::size_t preallocateBytes) {
+    close();
+    path_ = path;
+    preallocateBytes_ = preallocateBytes;
+#ifdef _WIN32
+    // 追記専用で開き（存在しなければ作成）、書き込みは常に末尾へ行われるようにする
+    HANDLE handle = CreateFileA(path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                                OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open CSV output: " + path);
+    }
+    handle_ = handle;
+    LARGE_INTEGER size{};
+    end_ = GetFileSizeEx(handle, &size) ? static_cast<std::uint64_t>(size.QuadPart) : 0;
+#else
+    fileDescriptor_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    if (fileDescriptor_ == -1) {
+        throw std::runtime_error("Failed to open CSV output: " + path + ": " + std::strerror(errno));
+    }
+    struct stat status {};
+    end_ = ::fstat(fileDescriptor_, &status) == 0 ? static_cast<std::uint64_t>(status.st_size) : 0;
+#endif
+    allocatedEnd_ = end_;
+}
+
+bool OutputFile::isOpen() const {
+#ifdef _WIN32
+    return handle_ != INVALID_HANDLE_VALUE;
+#else
+    return fileDescriptor_ != -1;
+#endif
+}
+
+void OutputFile::write(const char *data, std::size_t size) {
+    reserve(size);
+    std::size_t written = 0;
+    while (written < size) {
+#ifdef _WIN32
+        // WriteFile は 1 回に DWORD で表せる長さまでしか受け付けない
+        const DWORD chunk = static_cast<DWORD>(std::min<std::size_t>(size - written, 1u << 30));
+        DWORD count = 0;
+        if (!WriteFile(static_cast<HANDLE>(handle_), data + written, chunk, &count, nullptr)) {
+            throw std::runtime_error("Failed to write CSV output: " + path_);
+        }
+#else
+        // シグナルによる中断や途中までの書き込みは、残りを書き直す
+        const ssize_t count = ::write(fileDescriptor_, data + written, size - written);
+        if (count == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to write CSV output: " + path_ + ": " + std::strerror(errno));
+        }
+#endif
+        written += static_cast<std::size_t>(count);
+        end_ += static_cast<std::uint64_t>(count);
+    }
+}
+
+void OutputFile::sync() {
+#ifdef _WIN32
+    if (!FlushFileBuffers(static_cast<HANDLE>(handle_))) {
+        throw std::runtime_error("Failed to sync CSV output: " + path_);
+    }
+#else
+#ifdef __linux__
+    // 追記の内容と長さだけを書き出せばよいため、更新時刻などのメタデータは待たない
+    const int result = ::fdatasync(fileDescriptor_);
+#else
+    const int result = ::fsync(fileDescriptor_);
+#endif
+    if (result == -1) {
+        throw std::runtime_error("Failed to sync CSV output: " + path_ + ": " + std::strerror(errno));
+    }
+#endif
+}
+
+void OutputFile::close() {
+#ifdef _WIN32
+    if (handle_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(static_cast<HANDLE>(handle_));
+        handle_ = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (fileDescriptor_ != -1) {
+        ::close(fileDescriptor_);
+        fileDescriptor_ = -1;
+    }
+#endif
+}
+
+void OutputFile::reserve(std::size_t size) {
+    if (preallocateBytes_ == 0 || end_ + size <= allocatedEnd_) {
+        return;
+    }
+#ifdef __linux__
+    // posix_fallocate はファイルの長さまで伸ばし、追記する CSV の末尾に 0 が残るため、長さを変えずに確保する
+    const std::size_t length = std::max(preallocateBytes_, size);
+    if (::fallocate(fileDescriptor_, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(end_), static_cast<off_t>(length)) == 0) {
+        allocatedEnd_ = end_ + length;
+        return;
+    }
+#endif
+    // 確保に対応しないファイルシステムや環境では、以降は確保せずに書き込む
+    preallocateBytes_ = 0;
+}
+
+} // namespace framework4cpp
@@ -0,0 +1,124 @@
+#include "framework4cpp/TimestampFormatter.h"
+
+namespace framework4cpp {
+
+namespace {
+
+// 1 つの strftime 指定子の出力先として最初に用意するバイト数（足りなければ広げる）
+constexpr std::size_t kInitialScratch = 64;
+// 出力先を広げる上限（これでも収まらない部分は空として扱う）
+constexpr std::size_t kMaxScratch = 4096;
+
+constexpr std::int64_t kNanosecondsPerSecond = 1000000000;
+
+// 秒未満の桁数ごとに、ナノ秒を割る値
+constexpr std::int64_t kDivisors[10] = {1000000000, 100000000, 10000000, 1000000, 100000,
+                                        10000,      1000,      100,      10,      1};
+
+} // namespace
+
+TimestampFormatter::TimestampFormatter(const std::string &format) {
+    // 秒未満の指定子で書式を区切り、それ以外は strftime へそのまま渡す
+    Piece piece;
+    for (std::size_t i = 0; i < format.size(); ++i) {
+        if (format[i] != '%' || i + 1 == format.size()) {
+            piece.format.push_back(format[i]);
+            continue;
+        }
+        unsigned digits = 0;
+        std::size_t length = 0;
+        if (format[i + 1] == 'f') {
+            digits = 6;
+            length = 2;
+        } else if (format[i + 1] >= '1' && format[i + 1] <= '9' && i + 2 < format.size() && format[i + 2] == 'f') {
+            digits = static_cast<unsigned>(format[i + 1] - '0');
+            length = 3;
+        }
+        if (digits == 0) {
+            // "%%" を含め、strftime の指定子は 2 文字まとめて渡す（"%%f" を秒未満と誤解しない）
+            piece.format.append(format, i, 2);
+            ++i;
+            continue;
+        }
+        piece.digits = digits;
+        pieces_.push_back(std::move(piece));
+        piece = Piece{};
+        i += length - 1;
+    }
+    if (!piece.format.empty() || pieces_.empty()) {
+        pieces_.push_back(std::move(piece));
+    }
+    scratch_.resize(kInitialScratch);
+}
+
+void TimestampFormatter::append(std::chrono::system_clock::time_point timestamp, std::string &out) {
+    const std::int64_t nanoseconds =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp.time_since_epoch()).count();
+    // エポックより前の時刻でも秒未満が負にならないよう、切り捨てで秒を求める
+    std::int64_t second = nanoseconds / kNanosecondsPerSecond;
+    std::int64_t fraction = nanoseconds % kNanosecondsPerSecond;
+    if (fraction < 0) {
+        --second;
+        fraction += kNanosecondsPerSecond;
+    }
+    if (!rendered_ || second != second_) {
+        render(second);
+    }
+    const std::size_t base = out.size();
+    out.append(text_);
+    // 同じ秒の整形結果のうち、秒未満の桁だけを書き込む
+    for (const Field &field : fields_) {
+        std::int64_t value = fraction / kDivisors[field.digits];
+        for (unsigned digit = field.digits; digit > 0; --digit) {
+            out[base + field.offset + digit - 1] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+    }
+}
+
+void TimestampFormatter::render(std::int64_t second) {
+    const std::tm &local = localTime(second);
+    text_.clear();
+    fields_.clear();
+    for (const Piece &piece : pieces_) {
+        if (!piece.format.empty()) {
+            // strftime は出力が空でも 0 を返すため、上限まで広げても 0 なら空として扱う
+            std::size_t written = 0;
+            while (true) {
+                written = std::strftime(scratch_.data(), scratch_.size(), piece.format.c_str(), &local);
+                if (written > 0 || scratch_.size() >= kMaxScratch) {
+                    break;
+                }
+                scratch_.resize(scratch_.size() * 2);
+            }
+            text_.append(scratch_.data(), written);
+        }
+        if (piece.digits > 0) {
+            fields_.push_back(Field{text_.size(), piece.digits});
+            text_.append(piece.digits, '0');
+        }
+    }
+    second_ = second;
+    rendered_ = true;
+}
+
+const std::tm &TimestampFormatter::localTime(std::int64_t second) {
+    // 時差や夏時間の切り替えは分の境目で起こるため、同じ分の間は秒を進めるだけで済む
+    if (hasConverted_ && second >= converted_ && convertedTime_.tm_sec + (second - converted_) <= 59) {
+        localTime_ = convertedTime_;
+        localTime_.tm_sec += static_cast<int>(second - converted_);
+        return localTime_;
+    }
+    const auto time = static_cast<std::time_t>(second);
+#ifdef _WIN32
+    localtime_s(&convertedTime_, &time);
+#else
+    localtime_r(&time, &convertedTime_);
+#endif
+    converted_ = second;
+    hasConverted_ = true;
+    localTime_ = convertedTime_;
+    return localTime_;
+}
+
+} // namespace framework4cpp
@@ -1,7 +1,10 @@
 #include "framework4cpp/StreamingSessions.h"
 
+#include <algorithm>
 #include <chrono>
 #include <fstream>
+#include <stdexcept>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -17,39 +20,55 @@ void FileSession::run() {
     }
 
     // 監視対象のファイルをバイナリモードで開く
-    std::ifstream input(settings_.path, std::ios::binary);
+    // 1 回の読み取りで read_chunk_size まで取り込めるよう、ストリームの内部バッファを開く前に差し替える
+    // （実装によっては末尾の 1 バイトを読み取りに使わないため、1 バイト多く用意する）
+    std::vector<char> streamBuffer(settings_.readChunkSize + 1);
+    std::ifstream input;
+    input.rdbuf()->pubsetbuf(streamBuffer.data(), static_cast<std::streamsize>(streamBuffer.size()));
+    input.open(settings_.path, std::ios::binary);
     if (!input.is_open()) {
         throw std::runtime_error("Failed to open input file: " + settings_.path);
     }
-
-    // 読み取りバッファを設定されたサイズで確保
-    std::vector<char> temp(settings_.readChunkSize);
+    // 発生元は 1 度だけ登録し、以降は番号でデータを渡す
+    const SourceId source = buffer_.registerSource(settings_.path);
+    // セッション専用の投入口を開き、他のセッションと競合せずに投入する
+    ProducerLane lane = buffer_.openLane(source);
 
     while (isRunning()) {
-        // ファイルからデータを読み取る
-        input.read(temp.data(), static_cast<std::streamsize>(temp.size()));
-        std::streamsize count = input.gcount();
-        if (count > 0) {
-            // 読み取れた場合はバッファアイテムを構築してキューに投入
-            BufferItem item;
-            item.source = settings_.path;
-            item.timestamp = std::chrono::system_clock::now();
-            item.payload.assign(temp.begin(), temp.begin() + count);
-            buffer_.push(std::move(item));
-        }
-
-        if (count == 0) {
+        if (input.peek() == std::char_traits<char>::eof()) {
             // 末尾に到達した場合の処理
             if (!settings_.follow) {
                 // tail 追従しない場合はループを終了
                 break;
             }
-            if (!input.good()) {
-                // EOF 状態をクリアして次回再読込できるようにする
-                input.clear();
-            }
+            // EOF 状態をクリアして次回再読込できるようにする
+            input.clear();
             // 新しいデータが書き込まれるまで待機
             std::this_thread::sleep_for(settings_.pollInterval);
+            continue;
+        }
+
+        // バッファが高水位に達している間は先読みを止め、低水位まで下がってから読み進める
+        if (!waitWhilePressured()) {
+            break;
+        }
+        // peek で内部バッファへ取り込み済みの分だけを確保して取り出す
+        // （FIFO や遅いファイルシステムでも、読み取りを待つ間は共有バッファの領域を確保したままにしない）
+        const std::streamsize available = input.rdbuf()->in_avail();
+        const std::size_t size =
+            std::min<std::size_t>(settings_.readChunkSize, available > 0 ? static_cast<std::size_t>(available) : 1);
+        auto reservation = lane.reserve(size);
+        if (!reservation) {
+            // バッファが終了している場合はループを抜ける
+            break;
+        }
+        // メモリマップト利用時は maxPayloadSize に切り詰めて確保されるため、確保できた長さまでだけ読み取る
+        std::streamsize count = input.readsome(reinterpret_cast<char *>(reservation.data()),
+                                               static_cast<std::streamsize>(reservation.size()));
+        if (count > 0) {
+            reservation.commit(static_cast<std::size_t>(count));
+        } else {
+            reservation.abort();
         }
     }
 }
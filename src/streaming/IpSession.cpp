@@ -32,6 +32,9 @@ using socket_t = SOCKET;
 constexpr socket_t invalid_socket = INVALID_SOCKET;
 #endif
 
+// 1 回の投入でまとめて共有バッファへ渡す最大受信件数
+constexpr std::size_t kMaxReceiveBurst = 32;
+
 // ソケットハンドルを安全にクローズする
 void closeSocket(socket_t sock) {
 #ifdef _WIN32
@@ -153,9 +156,27 @@ void IpSession::run() {
     // 有効なソケットハンドルを保持する
     socketHandle_ = static_cast<std::intptr_t>(sock);
 
+    // 発生元は 1 度だけ登録し、以降は番号でデータを渡す
+    const SourceId source = this->buffer_.registerSource(settings_.host + ":" + std::to_string(settings_.port));
+    // セッション専用の投入口を開き、他のセッションと競合せずに投入する
+    ProducerLane lane = this->buffer_.openLane(source);
+
     // 受信バッファを確保して読み取りループを開始
     std::vector<std::uint8_t> buffer(settings_.readChunkSize);
+    // ソケットに溜まっている分をまとめて共有バッファへ渡すための一時領域
+    std::vector<BufferItem> batch;
+    batch.reserve(kMaxReceiveBurst);
     while (isRunning()) {
+        if (!settings_.udp && this->buffer_.underPressure()) {
+            // TCP はバッファが高水位の間は受信を止め、受信ウィンドウを埋めて送信側を流量制御させる
+            // （UDP は止めてもカーネル内で数えられずに捨てられるため、受信を続けて満杯時の扱いに任せる）
+            if (!batch.empty()) {
+                lane.pushBatch(batch);
+            }
+            if (!waitWhilePressured()) {
+                break;
+            }
+        }
         int received = 0;
         if (settings_.udp) {
             // UDP は recvfrom で受信
@@ -166,28 +187,43 @@ void IpSession::run() {
         }
 
         if (received > 0) {
-            // 受信したデータを共有バッファへ格納
+            // 受信したデータをまとめ用の一時領域へ積む
             BufferItem item;
-            item.source = settings_.host + ":" + std::to_string(settings_.port);
-            item.timestamp = std::chrono::system_clock::now();
-            item.payload.assign(buffer.begin(), buffer.begin() + received);
-            this->buffer_.push(std::move(item));
-        } else {
-#ifdef _WIN32
-            if ((received == SOCKET_ERROR) && (WSAGetLastError() == WSAEWOULDBLOCK)) {
-                // ノンブロッキング待ち時は少しスリープして再試行
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                continue;
+            item.source = source;
+            item.timestamp = this->buffer_.now();
+            item.payload.assign(buffer.data(), static_cast<std::size_t>(received));
+            batch.push_back(std::move(item));
+            if (batch.size() >= kMaxReceiveBurst) {
+                // 上限に達したら共有バッファへまとめて投入
+                lane.pushBatch(batch);
             }
+            // ソケットが空になるまで続けて受信する
+            continue;
+        }
+
+        // 受信が途切れたら溜めた分を先に共有バッファへ渡す
+        if (!batch.empty()) {
+            lane.pushBatch(batch);
+        }
+#ifdef _WIN32
+        if ((received == SOCKET_ERROR) && (WSAGetLastError() == WSAEWOULDBLOCK)) {
+            // ノンブロッキング待ち時は少しスリープして再試行
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
 #else
-            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                continue;
-            }
-#endif
-            // 0 バイトまたは致命的なエラーであれば終了
-            break;
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
         }
+#endif
+        // 0 バイトまたは致命的なエラーであれば終了
+        break;
+    }
+
+    // 停止指示で抜けた場合も受信済みのデータは取りこぼさない
+    if (!batch.empty()) {
+        lane.pushBatch(batch);
     }
 }
 
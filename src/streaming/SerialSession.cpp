@@ -10,6 +10,7 @@
 #else
 #include <cerrno>
 #include <fcntl.h>
+#include <poll.h>
 #include <termios.h>
 #include <unistd.h>
 #endif
@@ -140,6 +141,11 @@ void SerialSession::run() {
         return;
     }
 
+    // 発生元は 1 度だけ登録し、以降は番号でデータを渡す
+    const SourceId source = buffer_.registerSource(settings_.port);
+    // セッション専用の投入口を開き、他のセッションと競合せずに投入する
+    ProducerLane lane = buffer_.openLane(source);
+
 #ifdef _WIN32
     // Win32 API を利用してシリアルポートを開く
     HANDLE handle = CreateFileA(settings_.port.c_str(), GENERIC_READ, 0, nullptr, OPEN_EXISTING, 0, nullptr);
@@ -184,10 +190,10 @@ void SerialSession::run() {
         if (bytesRead > 0) {
             // 読み取った内容をバッファアイテムに詰めて送出する
             BufferItem item;
-            item.source = settings_.port;
-            item.timestamp = std::chrono::system_clock::now();
-            item.payload.assign(buffer.begin(), buffer.begin() + bytesRead);
-            buffer_.push(std::move(item));
+            item.source = source;
+            item.timestamp = buffer_.now();
+            item.payload.assign(buffer.data(), static_cast<std::size_t>(bytesRead));
+            lane.push(std::move(item));
         } else {
             // データが無かった場合は少し待機してから再度試行
             std::this_thread::sleep_for(std::chrono::milliseconds(10));
@@ -217,22 +223,32 @@ void SerialSession::run() {
         throw std::runtime_error("Failed to set serial attributes");
     }
 
-    // 読み取り用の一時バッファを確保
-    std::vector<std::uint8_t> buffer(settings_.readChunkSize);
+    // 受信待ちに利用するポーリング対象としてシリアルポートを登録
+    pollfd descriptor{};
+    descriptor.fd = static_cast<int>(handle_);
+    descriptor.events = POLLIN;
     while (isRunning()) {
-        // 非ブロッキングでデータを読み取る
-        ssize_t count = ::read(static_cast<int>(handle_), buffer.data(), buffer.size());
+        // データが届くまで最大 10ms 待機する（停止指示を確認できるよう短めにする）
+        int ready = ::poll(&descriptor, 1, 10);
+        if (ready == 0 || (ready < 0 && errno == EINTR)) {
+            continue;
+        }
+        if (ready < 0) {
+            break;
+        }
+
+        // 受信データを共有バッファ内の領域へ直接読み込む
+        auto reservation = lane.reserve(settings_.readChunkSize);
+        if (!reservation) {
+            break;
+        }
+        ssize_t count = ::read(static_cast<int>(handle_), reservation.data(), reservation.size());
         if (count > 0) {
-            // 受信データをバッファアイテムに詰めて共有バッファへ投入
-            BufferItem item;
-            item.source = settings_.port;
-            item.timestamp = std::chrono::system_clock::now();
-            item.payload.assign(buffer.begin(), buffer.begin() + count);
-            buffer_.push(std::move(item));
+            reservation.commit(static_cast<std::size_t>(count));
         } else {
-            if (count == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
-                // データ未到着の場合は少し待って再試行
-                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            reservation.abort();
+            if (count == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                // 取りこぼし通知などでデータが無かった場合は再試行
                 continue;
             }
             // その他のエラーや切断時はループを抜ける
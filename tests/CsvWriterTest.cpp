@@ -0,0 +1,76 @@
+#include "TestSupport.h"
+
+#include "framework4cpp/Config.h"
+#include "framework4cpp/CsvWriter.h"
+#include "framework4cpp/GlobalBuffer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// content を一時ファイルへ書き出して設定として読み込む
+framework4cpp::Config loadConfig(const std::string &content) {
+    framework4cpp_test::TemporaryFile file("config.ini");
+    {
+        std::ofstream stream(file.path());
+        stream << content;
+    }
+    return framework4cpp::Config::loadFromFile(file.path());
+}
+
+} // namespace
+
+TEST_CASE(configRejectsZeroWriteBuffer) {
+    CHECK_EQ(loadConfig("[csv]\nwrite_buffer = 64k\n").csv.writeBufferBytes, std::size_t{64 * 1024});
+    bool thrown = false;
+    try {
+        loadConfig("[csv]\nwrite_buffer = 0\n");
+    } catch (const std::runtime_error &ex) {
+        thrown = std::string(ex.what()).find("write_buffer") != std::string::npos;
+    }
+    CHECK(thrown);
+}
+
+TEST_CASE(csvWriterWritesEveryRowWithTinyWriteBuffer) {
+    framework4cpp_test::TemporaryFile output("tiny.csv");
+    framework4cpp::CsvSettings settings;
+    settings.outputPath = output.path();
+    settings.includeTimestamp = false;
+    settings.quoteStrings = false;
+    // 下限より小さい書き込み単位は下限へ切り上げられ、整形と書き込みを重ねたまま全行を書き出す
+    settings.writeBufferBytes = 1;
+    settings.flushInterval = std::chrono::milliseconds(1);
+    framework4cpp::GlobalBuffer buffer(framework4cpp::GlobalBufferOptions{});
+    const framework4cpp::SourceId source = buffer.registerSource("tiny");
+    framework4cpp::CsvWriter writer(settings, buffer);
+    writer.start();
+    constexpr int kRows = 5000;
+    for (int row = 0; row < kRows; ++row) {
+        framework4cpp::BufferItem item;
+        item.source = source;
+        item.timestamp = buffer.now();
+        const auto value = static_cast<std::uint8_t>(row);
+        item.payload.assign(&value, 1);
+        buffer.push(std::move(item));
+    }
+    writer.stop();
+    CHECK(!writer.writeError().has_value());
+
+    std::ifstream stream(output.path());
+    std::string line;
+    int rows = 0;
+    bool ordered = true;
+    while (std::getline(stream, line)) {
+        char expected[3];
+        std::snprintf(expected, sizeof(expected), "%02x", rows & 0xff);
+        ordered = ordered && line.size() >= 2 && line.compare(line.size() - 2, 2, expected) == 0;
+        ++rows;
+    }
+    CHECK_EQ(rows, kRows);
+    CHECK(ordered);
+}
@@ -0,0 +1,56 @@
+#include "TestSupport.h"
+
+#include "framework4cpp/GlobalBuffer.h"
+#include "framework4cpp/StreamingSessions.h"
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+TEST_CASE(fileSessionReadsChunksLargerThanMappedPayload) {
+    framework4cpp_test::TemporaryFile input("input.bin");
+    framework4cpp_test::TemporaryFile backing("session.mmap");
+    std::vector<std::uint8_t> data(20 * 1024);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<std::uint8_t>(i * 7 + i / 256);
+    }
+    {
+        std::ofstream stream(input.path(), std::ios::binary);
+        stream.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+
+    framework4cpp::GlobalBufferOptions options;
+    options.memoryMapped = true;
+    options.backingFile = backing.path();
+    options.recover = false;
+    options.sizeBytes = 64 * 1024;
+    options.maxPayloadSize = 256;
+    framework4cpp::GlobalBuffer buffer(options);
+
+    // 1 回の読み取り単位が 1 レコードに収まる大きさを超えていても、確保できた長さずつ読み取る
+    framework4cpp::FileInputSettings settings;
+    settings.enabled = true;
+    settings.path = input.path();
+    settings.follow = false;
+    settings.readChunkSize = 4096;
+    framework4cpp::FileSession session(settings, buffer);
+    session.start();
+
+    std::vector<std::uint8_t> received;
+    std::vector<framework4cpp::BufferItem> out;
+    bool bounded = true;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (received.size() < data.size() && std::chrono::steady_clock::now() < deadline) {
+        out.clear();
+        buffer.popBatch(out, 64, std::chrono::milliseconds(10));
+        for (const auto &item : out) {
+            bounded = bounded && item.payload.size() <= options.maxPayloadSize;
+            received.insert(received.end(), item.payload.begin(), item.payload.end());
+        }
+    }
+    session.stop();
+    CHECK(bounded);
+    CHECK_EQ(received.size(), data.size());
+    CHECK(received == data);
+}
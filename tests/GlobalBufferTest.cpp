@@ -0,0 +1,541 @@
+#include "TestSupport.h"
+
+#include "framework4cpp/GlobalBuffer.h"
+#include "framework4cpp/RecordRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using global_buffer::BufferItem;
+using global_buffer::GlobalBuffer;
+using global_buffer::ItemView;
+using global_buffer::LaneOrder;
+using global_buffer::Options;
+using global_buffer::ProducerLane;
+using global_buffer::SinkMode;
+using global_buffer::SourceId;
+using global_buffer::Subscription;
+
+// ペイロードの先頭 8 バイトに生産者ごとの連番を入れ、残りを連番から決まる値で埋める
+BufferItem makeItem(SourceId source, std::uint64_t index, std::size_t size) {
+    BufferItem item;
+    item.source = source;
+    item.timestamp = std::chrono::system_clock::now();
+    item.payload.resizeForOverwrite(std::max<std::size_t>(size, sizeof(index)));
+    std::memcpy(item.payload.data(), &index, sizeof(index));
+    for (std::size_t i = sizeof(index); i < item.payload.size(); ++i) {
+        item.payload[i] = static_cast<std::uint8_t>(index + i);
+    }
+    return item;
+}
+
+std::uint64_t indexOf(const std::uint8_t *payload) {
+    std::uint64_t index = 0;
+    std::memcpy(&index, payload, sizeof(index));
+    return index;
+}
+
+// ペイロードが makeItem で作った内容のまま壊れていないか
+bool intact(const std::uint8_t *payload, std::size_t size) {
+    const std::uint64_t index = indexOf(payload);
+    for (std::size_t i = sizeof(index); i < size; ++i) {
+        if (payload[i] != static_cast<std::uint8_t>(index + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 生産者ごとに受け取った連番を検証する
+struct ProducerCheck {
+    std::uint64_t next{0};
+    std::uint64_t nextSourceSequence{0};
+    bool ordered{true};
+    bool intact{true};
+};
+
+// 連番 index のデータのペイロード長（maxSize ちょうど・その少し手前・小さなものを混ぜる）
+std::size_t payloadSizeOf(std::uint64_t index, std::size_t maxSize) {
+    switch (index % 4) {
+    case 0:
+        return maxSize;
+    case 1:
+        return maxSize - index % 8;
+    case 2:
+        return 8 + index % 24;
+    default:
+        return maxSize / 2 + index % 16;
+    }
+}
+
+// producers 本のスレッドから perProducer 件ずつ投入し、1 つの消費者で全件を順序どおり受け取れるか確かめる
+// useLanes が true なら、各生産者は自分の lane を開いて投入する
+void runProducers(GlobalBuffer &buffer, std::size_t producers, std::uint64_t perProducer, std::size_t maxSize,
+                  bool useLanes = false) {
+    std::vector<SourceId> sources;
+    std::vector<ProducerLane> lanes(producers);
+    for (std::size_t i = 0; i < producers; ++i) {
+        sources.push_back(buffer.registerSource("producer" + std::to_string(i)));
+        if (useLanes) {
+            lanes[i] = buffer.openLane(sources[i]);
+        }
+    }
+    std::vector<std::thread> threads;
+    for (std::size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            // 1 件ずつの投入とまとめての投入を混ぜ、両方の確保経路を通す
+            std::vector<BufferItem> batch;
+            std::uint64_t index = 0;
+            while (index < perProducer) {
+                const std::size_t count = static_cast<std::size_t>((index / 7 + p) % 5);
+                if (count <= 1) {
+                    BufferItem item = makeItem(sources[p], index, payloadSizeOf(index, maxSize));
+                    if (lanes[p]) {
+                        lanes[p].push(std::move(item));
+                    } else {
+                        buffer.push(std::move(item));
+                    }
+                    ++index;
+                    continue;
+                }
+                for (std::size_t i = 0; i < count && index < perProducer; ++i, ++index) {
+                    batch.push_back(makeItem(sources[p], index, payloadSizeOf(index, maxSize)));
+                }
+                if (lanes[p]) {
+                    lanes[p].pushBatch(batch);
+                } else {
+                    buffer.pushBatch(batch);
+                }
+            }
+        });
+    }
+
+    std::vector<ProducerCheck> checks(producers);
+    std::vector<BufferItem> out;
+    std::uint64_t received = 0;
+    const std::uint64_t expected = perProducer * producers;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (received < expected && std::chrono::steady_clock::now() < deadline) {
+        out.clear();
+        buffer.popBatch(out, 64, std::chrono::milliseconds(10));
+        for (const BufferItem &item : out) {
+            std::size_t p = 0;
+            while (p < producers && sources[p] != item.source) {
+                ++p;
+            }
+            if (p == producers) {
+                CHECK(p < producers);
+                continue;
+            }
+            ProducerCheck &check = checks[p];
+            check.ordered = check.ordered && indexOf(item.payload.data()) == check.next &&
+                            item.sourceSequence == check.nextSourceSequence;
+            check.intact = check.intact && intact(item.payload.data(), item.payload.size());
+            ++check.next;
+            ++check.nextSourceSequence;
+            ++received;
+        }
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    CHECK_EQ(received, expected);
+    for (const ProducerCheck &check : checks) {
+        CHECK(check.ordered);
+        CHECK(check.intact);
+        CHECK_EQ(check.next, perProducer);
+    }
+    CHECK(!buffer.tryPop().has_value());
+}
+
+// 購読者が受け取ったデータの連番を検証する（Lossy は読み飛ばしがあるため増加だけを確かめる）
+struct SinkCheck {
+    std::uint64_t received{0};
+    std::uint64_t next{0};
+    bool ordered{true};
+    bool intact{true};
+};
+
+void checkViews(const std::vector<ItemView> &views, SinkCheck &check, bool contiguous) {
+    for (const ItemView &view : views) {
+        const std::uint64_t index = indexOf(view.payload);
+        check.ordered = check.ordered && (contiguous ? index == check.next : index >= check.next);
+        check.intact = check.intact && intact(view.payload, view.payloadSize);
+        check.next = index + 1;
+        ++check.received;
+    }
+}
+
+// Blocking と Lossy の購読者を 1 つずつ付け、Lossy 側だけを遅らせて total 件を投入する
+// pop する消費者と Blocking の購読者は全件を、Lossy の購読者は読み飛ばされた分を除いて順に受け取る
+void runFanOut(GlobalBuffer &buffer, std::uint64_t total) {
+    Subscription blocking = buffer.subscribe(SinkMode::Blocking);
+    Subscription lossy = buffer.subscribe(SinkMode::Lossy);
+    const SourceId source = buffer.registerSource("fanout");
+    std::atomic<bool> produced{false};
+
+    std::thread producer([&] {
+        for (std::uint64_t index = 0; index < total; ++index) {
+            buffer.push(makeItem(source, index, 8 + index % 32));
+        }
+        produced.store(true);
+    });
+    SinkCheck blockingCheck;
+    std::thread blockingReader([&] {
+        std::vector<ItemView> views;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        while (blockingCheck.received < total && std::chrono::steady_clock::now() < deadline) {
+            views.clear();
+            blocking.read(views, 32, std::chrono::milliseconds(10));
+            checkViews(views, blockingCheck, true);
+        }
+        blocking.release();
+    });
+    SinkCheck lossyCheck;
+    std::thread lossyReader([&] {
+        std::vector<ItemView> views;
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+        while (std::chrono::steady_clock::now() < deadline) {
+            views.clear();
+            // 投入が終わった後は、残りを受け取り切るまで読み続ける
+            const bool done = produced.load();
+            if (lossy.read(views, 4, std::chrono::milliseconds(10)) == 0 && done) {
+                break;
+            }
+            checkViews(views, lossyCheck, false);
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+        lossy.release();
+    });
+
+    std::vector<BufferItem> out;
+    std::uint64_t popped = 0;
+    bool ordered = true;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(60);
+    while (popped < total && std::chrono::steady_clock::now() < deadline) {
+        out.clear();
+        buffer.popBatch(out, 64, std::chrono::milliseconds(10));
+        for (const BufferItem &item : out) {
+            ordered = ordered && indexOf(item.payload.data()) == popped;
+            ++popped;
+        }
+    }
+    producer.join();
+    blockingReader.join();
+    lossyReader.join();
+
+    CHECK_EQ(popped, total);
+    CHECK(ordered);
+    CHECK_EQ(blockingCheck.received, total);
+    CHECK(blockingCheck.ordered);
+    CHECK(blockingCheck.intact);
+    CHECK_EQ(blocking.dropped(), std::uint64_t{0});
+    // 遅い購読者は読み飛ばされるが、受け取ったデータと読み飛ばされたデータで全件になる
+    CHECK(lossy.dropped() > 0);
+    CHECK_EQ(lossyCheck.received + lossy.dropped(), total);
+    CHECK(lossyCheck.ordered);
+    CHECK(lossyCheck.intact);
+}
+
+} // namespace
+
+TEST_CASE(mpscBlockKeepsPerProducerOrderWithoutLoss) {
+    Options options;
+    // 容量を小さくし、生産者が満杯で待つ経路と周回を繰り返し通す
+    options.capacity = 16;
+    options.maxPayloadSize = 64;
+    GlobalBuffer buffer(options);
+    runProducers(buffer, 4, 20000, options.maxPayloadSize);
+}
+
+TEST_CASE(mpscBlockWithByteBudgetKeepsOrder) {
+    Options options;
+    options.capacity = 64;
+    options.maxPayloadSize = 64;
+    // 件数より先にバイト数の上限で満杯になるようにする
+    options.maxBytes = 256;
+    GlobalBuffer buffer(options);
+    runProducers(buffer, 4, 10000, options.maxPayloadSize);
+    CHECK_EQ(buffer.queuedBytes(), std::size_t{0});
+}
+
+TEST_CASE(mmapBlockWrapsWithRecordsNearMaxLength) {
+    framework4cpp_test::TemporaryFile file("mpsc.mmap");
+    Options options;
+    options.memoryMapped = true;
+    options.backingFile = file.path();
+    options.recover = false;
+    options.sizeBytes = 4096;
+    // 最大のペイロードでレコード長がリングの上限（データ領域の半分）ちょうどになるようにする
+    options.maxPayloadSize = options.sizeBytes / 2 - sizeof(global_buffer::RecordHeader);
+    GlobalBuffer buffer(options);
+    runProducers(buffer, 3, 5000, options.maxPayloadSize);
+}
+
+TEST_CASE(mmapRecoveryRestoresUnconsumedItems) {
+    framework4cpp_test::TemporaryFile file("restart.mmap");
+    Options options;
+    options.memoryMapped = true;
+    options.backingFile = file.path();
+    options.sizeBytes = 64 * 1024;
+    options.maxPayloadSize = 256;
+    {
+        options.recover = false;
+        GlobalBuffer buffer(options);
+        const SourceId source = buffer.registerSource("restart");
+        for (std::uint64_t index = 0; index < 20; ++index) {
+            buffer.push(makeItem(source, index, 8 + index));
+        }
+        // 先頭の 5 件だけを書き出した状態で停止する
+        std::vector<BufferItem> out;
+        CHECK_EQ(buffer.popBatch(out, 5, std::chrono::milliseconds(0)), std::size_t{5});
+    }
+
+    options.recover = true;
+    GlobalBuffer buffer(options);
+    CHECK_EQ(buffer.recoveredCount(), std::size_t{15});
+    std::vector<BufferItem> out;
+    buffer.popBatch(out, 64, std::chrono::milliseconds(0));
+    REQUIRE(out.size() == 15);
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        CHECK_EQ(indexOf(out[i].payload.data()), std::uint64_t{5 + i});
+        CHECK(intact(out[i].payload.data(), out[i].payload.size()));
+        CHECK_EQ(buffer.sourceName(out[i].source), std::string_view("restart"));
+        CHECK_EQ(out[i].sourceSequence, std::uint64_t{5 + i});
+    }
+}
+
+TEST_CASE(lossySubscriberLagsWithoutStallingBlockingReaders) {
+    Options options;
+    options.capacity = 32;
+    options.maxPayloadSize = 64;
+    GlobalBuffer buffer(options);
+    runFanOut(buffer, 5000);
+}
+
+TEST_CASE(mmapLossySubscriberLagsWithoutStallingBlockingReaders) {
+    framework4cpp_test::TemporaryFile file("fanout.mmap");
+    Options options;
+    options.memoryMapped = true;
+    options.backingFile = file.path();
+    options.recover = false;
+    options.sizeBytes = 4096;
+    options.maxPayloadSize = 64;
+    GlobalBuffer buffer(options);
+    runFanOut(buffer, 5000);
+}
+
+TEST_CASE(lanesKeepPerProducerOrderWithoutLoss) {
+    for (LaneOrder order : {LaneOrder::Timestamp, LaneOrder::RoundRobin}) {
+        Options options;
+        options.capacity = 16;
+        options.maxPayloadSize = 64;
+        options.producerLanes = true;
+        options.laneOrder = order;
+        GlobalBuffer buffer(options);
+        runProducers(buffer, 4, 20000, options.maxPayloadSize, true);
+    }
+}
+
+TEST_CASE(laneTimestampMergeOrdersQueuedItems) {
+    Options options;
+    options.capacity = 64;
+    options.maxPayloadSize = 64;
+    options.producerLanes = true;
+    GlobalBuffer buffer(options);
+    std::vector<ProducerLane> lanes;
+    for (std::size_t i = 0; i < 3; ++i) {
+        lanes.push_back(buffer.openLane(buffer.registerSource("lane" + std::to_string(i))));
+    }
+    // 各 lane の受信時刻が互い違いになるよう投入し、lane を介さない投入（共有リング）も混ぜる
+    const auto base = std::chrono::system_clock::now();
+    std::uint64_t index = 0;
+    for (std::size_t round = 0; round < 10; ++round) {
+        for (std::size_t lane = 0; lane < lanes.size(); ++lane, ++index) {
+            ProducerLane &target = lanes[(lane + round) % lanes.size()];
+            BufferItem item = makeItem(target.source(), index, 8);
+            item.timestamp = base + std::chrono::microseconds(index * 2);
+            target.push(std::move(item));
+        }
+        // この周の最初と 2 番目の lane のデータの間の時刻にする
+        BufferItem item = makeItem(global_buffer::kAnonymousSource, index, 8);
+        item.timestamp = base + std::chrono::microseconds((index - lanes.size()) * 2 + 1);
+        buffer.push(std::move(item));
+    }
+    std::vector<BufferItem> out;
+    buffer.popBatch(out, 64, std::chrono::milliseconds(0));
+    REQUIRE(out.size() == 40);
+    for (std::size_t i = 1; i < out.size(); ++i) {
+        CHECK(out[i - 1].timestamp < out[i].timestamp);
+    }
+}
+
+TEST_CASE(laneRoundRobinAlternatesBetweenLanes) {
+    Options options;
+    options.capacity = 64;
+    options.maxPayloadSize = 64;
+    options.producerLanes = true;
+    options.laneOrder = LaneOrder::RoundRobin;
+    GlobalBuffer buffer(options);
+    std::vector<ProducerLane> lanes;
+    for (std::size_t i = 0; i < 3; ++i) {
+        lanes.push_back(buffer.openLane(buffer.registerSource("lane" + std::to_string(i))));
+    }
+    for (std::uint64_t index = 0; index < 4; ++index) {
+        for (ProducerLane &lane : lanes) {
+            lane.push(makeItem(lane.source(), index, 8));
+        }
+    }
+    std::vector<BufferItem> out;
+    buffer.popBatch(out, 64, std::chrono::milliseconds(0));
+    REQUIRE(out.size() == 12);
+    // 全ての lane にデータがある間は、同じ lane から続けて取り出さない
+    for (std::size_t i = 0; i < out.size(); i += lanes.size()) {
+        for (std::size_t j = 0; j < lanes.size(); ++j) {
+            CHECK_EQ(out[i + j].source, out[j].source);
+            CHECK_EQ(indexOf(out[i + j].payload.data()), std::uint64_t{i / lanes.size()});
+        }
+    }
+}
+
+TEST_CASE(dropOldestKeepsNewestItemsInOrder) {
+    Options options;
+    options.capacity = 8;
+    options.maxPayloadSize = 64;
+    options.overflowPolicy = global_buffer::OverflowPolicy::DropOldest;
+    GlobalBuffer buffer(options);
+    const SourceId source = buffer.registerSource("drop");
+    for (std::uint64_t index = 0; index < 20; ++index) {
+        buffer.push(makeItem(source, index, 16));
+    }
+    std::vector<BufferItem> out;
+    buffer.popBatch(out, 64, std::chrono::milliseconds(0));
+    REQUIRE(out.size() == 8);
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        CHECK_EQ(indexOf(out[i].payload.data()), std::uint64_t{12 + i});
+        // 捨てられたデータも番号を消費する
+        CHECK_EQ(out[i].sourceSequence, std::uint64_t{12 + i});
+    }
+    CHECK_EQ(buffer.overflowStats().droppedOldest, std::uint64_t{12});
+}
+
+TEST_CASE(mmapDropOldestKeepsNewestItemsInOrder) {
+    framework4cpp_test::TemporaryFile file("drop.mmap");
+    Options options;
+    options.memoryMapped = true;
+    options.backingFile = file.path();
+    options.recover = false;
+    options.sizeBytes = 1024;
+    options.maxPayloadSize = 64;
+    options.overflowPolicy = global_buffer::OverflowPolicy::DropOldest;
+    GlobalBuffer buffer(options);
+    const SourceId source = buffer.registerSource("drop");
+    for (std::uint64_t index = 0; index < 100; ++index) {
+        buffer.push(makeItem(source, index, 8 + index % 40));
+    }
+    std::vector<BufferItem> out;
+    buffer.popBatch(out, 128, std::chrono::milliseconds(0));
+    REQUIRE(!out.empty());
+    // 残るのは末尾から連続する最新のデータで、捨てた件数と合わせて全件になる
+    const std::uint64_t first = 100 - out.size();
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        CHECK_EQ(indexOf(out[i].payload.data()), first + i);
+        CHECK(intact(out[i].payload.data(), out[i].payload.size()));
+    }
+    CHECK_EQ(buffer.overflowStats().droppedOldest, first);
+}
+
+TEST_CASE(spillRestoresItemsInFifoOrder) {
+    framework4cpp_test::TemporaryFile file("fifo.spill");
+    Options options;
+    options.capacity = 8;
+    options.maxPayloadSize = 64;
+    options.overflowPolicy = global_buffer::OverflowPolicy::Spill;
+    options.spillFile = file.path();
+    GlobalBuffer buffer(options);
+    const SourceId source = buffer.registerSource("spill");
+    for (std::uint64_t index = 0; index < 20; ++index) {
+        buffer.push(makeItem(source, index, 8 + index));
+    }
+    // 退避中に投入されたデータも、退避したデータより後に取り出される
+    std::vector<BufferItem> out;
+    buffer.popBatch(out, 4, std::chrono::milliseconds(0));
+    for (std::uint64_t index = 20; index < 30; ++index) {
+        buffer.push(makeItem(source, index, 8 + index));
+    }
+    while (buffer.popBatch(out, 64, std::chrono::milliseconds(0)) > 0) {
+    }
+    REQUIRE(out.size() == 30);
+    for (std::size_t i = 0; i < out.size(); ++i) {
+        CHECK_EQ(indexOf(out[i].payload.data()), std::uint64_t{i});
+        CHECK(intact(out[i].payload.data(), out[i].payload.size()));
+    }
+    const global_buffer::OverflowStats stats = buffer.overflowStats();
+    CHECK(stats.spilled > 0);
+    CHECK_EQ(stats.restored, stats.spilled);
+}
+
+TEST_CASE(spillKeepsOrderWithConcurrentProducers) {
+    framework4cpp_test::TemporaryFile file("mpsc.spill");
+    Options options;
+    options.capacity = 16;
+    options.maxPayloadSize = 64;
+    options.overflowPolicy = global_buffer::OverflowPolicy::Spill;
+    options.spillFile = file.path();
+    GlobalBuffer buffer(options);
+    runProducers(buffer, 4, 10000, options.maxPayloadSize);
+    const global_buffer::OverflowStats stats = buffer.overflowStats();
+    CHECK_EQ(stats.restored, stats.spilled);
+}
+
+TEST_CASE(mmapReserveCapsAtMaxPayloadSize) {
+    framework4cpp_test::TemporaryFile file("reserve.mmap");
+    Options options;
+    options.memoryMapped = true;
+    options.backingFile = file.path();
+    options.recover = false;
+    options.sizeBytes = 4096;
+    options.maxPayloadSize = 256;
+    GlobalBuffer buffer(options);
+    const SourceId source = buffer.registerSource("reserve");
+
+    // 上限を超える確保は maxPayloadSize に切り詰められ、確保した長さを超えて確定できない
+    global_buffer::WriteReservation reservation = buffer.reserve(4096, source);
+    REQUIRE(static_cast<bool>(reservation));
+    CHECK_EQ(reservation.size(), options.maxPayloadSize);
+    bool thrown = false;
+    try {
+        reservation.commit(reservation.size() + 1);
+    } catch (const std::out_of_range &) {
+        thrown = true;
+    }
+    CHECK(thrown);
+    for (std::size_t i = 0; i < reservation.size(); ++i) {
+        reservation.data()[i] = static_cast<std::uint8_t>(i);
+    }
+    reservation.commit(100);
+
+    // 取り消した予約は消費者に読み飛ばされる
+    global_buffer::WriteReservation aborted = buffer.reserve(64, source);
+    REQUIRE(static_cast<bool>(aborted));
+    aborted.abort();
+
+    std::vector<BufferItem> out;
+    buffer.popBatch(out, 8, std::chrono::milliseconds(0));
+    REQUIRE(out.size() == 1);
+    CHECK_EQ(out[0].payload.size(), std::size_t{100});
+    CHECK_EQ(out[0].source, source);
+    bool intactPayload = true;
+    for (std::size_t i = 0; i < out[0].payload.size(); ++i) {
+        intactPayload = intactPayload && out[0].payload[i] == static_cast<std::uint8_t>(i);
+    }
+    CHECK(intactPayload);
+}
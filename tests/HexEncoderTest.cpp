@@ -0,0 +1,134 @@
+#include "TestSupport.h"
+
+#include "framework4cpp/HexEncoder.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using framework4cpp::HexKernel;
+using framework4cpp::HexLayout;
+
+const char *kernelName(HexKernel kernel) {
+    switch (kernel) {
+    case HexKernel::Avx2:
+        return "avx2";
+    case HexKernel::Ssse3:
+        return "ssse3";
+    default:
+        return "scalar";
+    }
+}
+
+// 実装に依らない素朴な変換（期待値）
+std::string reference(const std::uint8_t *data, std::size_t size, HexLayout layout) {
+    std::string text;
+    char pair[3];
+    for (std::size_t i = 0; i < size; ++i) {
+        if (i > 0 && layout == HexLayout::Spaced) {
+            text.push_back(' ');
+        }
+        std::snprintf(pair, sizeof(pair), "%02x", data[i]);
+        text.append(pair, 2);
+    }
+    return text;
+}
+
+// 出力の直後に番兵を置いて変換し、書き込んだ文字列を返す（範囲外へ書き込めば overrun を true にする）
+std::string encodeWith(HexKernel kernel, const std::uint8_t *data, std::size_t size, HexLayout layout,
+                       bool &overrun) {
+    constexpr std::size_t kGuard = 64;
+    const std::size_t expected = framework4cpp::hexEncodedSize(size, layout);
+    std::vector<char> out(expected + kGuard, '#');
+    const std::size_t written = framework4cpp::encodeHexWith(kernel, data, size, out.data(), layout);
+    for (std::size_t i = expected; i < out.size(); ++i) {
+        overrun = overrun || out[i] != '#';
+    }
+    return std::string(out.data(), written);
+}
+
+} // namespace
+
+TEST_CASE(hexKernelsMatchScalarForEveryLength) {
+    const std::size_t lengths[] = {0, 1, 15, 16, 17, 31, 32, 33, 47, 48, 63, 64, 65, 1023, 1024};
+    const HexLayout layouts[] = {HexLayout::Packed, HexLayout::Spaced};
+    // 全てのバイト値を含むデータ（境界をずらして、揃っていない読み込みも通す）
+    std::vector<std::uint8_t> data(1024 + 1);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<std::uint8_t>(i * 167 + 13);
+    }
+    for (HexKernel kernel : {HexKernel::Scalar, HexKernel::Ssse3, HexKernel::Avx2}) {
+        if (!framework4cpp::hexKernelAvailable(kernel)) {
+            std::cout << "  " << kernelName(kernel) << " is not available on this CPU\n";
+            continue;
+        }
+        for (HexLayout layout : layouts) {
+            for (std::size_t length : lengths) {
+                for (std::size_t offset : {0, 1}) {
+                    const std::uint8_t *input = data.data() + offset;
+                    bool overrun = false;
+                    const std::string text = encodeWith(kernel, input, length, layout, overrun);
+                    const std::string scalar = encodeWith(HexKernel::Scalar, input, length, layout, overrun);
+                    if (text != scalar || scalar != reference(input, length, layout) || overrun) {
+                        framework4cpp_test::reportFailure(
+                            __FILE__, __LINE__,
+                            std::string(kernelName(kernel)) + (layout == HexLayout::Packed ? " packed" : " spaced") +
+                                " length " + std::to_string(length) + " offset " + std::to_string(offset));
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE(hexEncoderSelectsWidestSupportedKernel) {
+    HexKernel expected = HexKernel::Scalar;
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        expected = HexKernel::Avx2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        expected = HexKernel::Ssse3;
+    }
+    CHECK_EQ(framework4cpp::hexKernelAvailable(HexKernel::Avx2), __builtin_cpu_supports("avx2") != 0);
+    CHECK_EQ(framework4cpp::hexKernelAvailable(HexKernel::Ssse3), __builtin_cpu_supports("ssse3") != 0);
+#endif
+    CHECK(framework4cpp::selectedHexKernel() == expected);
+    CHECK_EQ(std::string(framework4cpp::hexEncoderName()), std::string(kernelName(expected)));
+
+    // 使えない実装は指定できない
+    for (HexKernel kernel : {HexKernel::Ssse3, HexKernel::Avx2}) {
+        if (framework4cpp::hexKernelAvailable(kernel)) {
+            continue;
+        }
+        char out[2];
+        const std::uint8_t byte = 0;
+        bool thrown = false;
+        try {
+            framework4cpp::encodeHexWith(kernel, &byte, 1, out, HexLayout::Packed);
+        } catch (const std::invalid_argument &) {
+            thrown = true;
+        }
+        CHECK(thrown);
+    }
+}
+
+TEST_CASE(encodeHexMatchesReference) {
+    std::vector<std::uint8_t> data(300);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<std::uint8_t>(255 - i);
+    }
+    for (std::size_t length = 0; length <= data.size(); ++length) {
+        for (HexLayout layout : {HexLayout::Packed, HexLayout::Spaced}) {
+            std::string out(framework4cpp::hexEncodedSize(length, layout), '\0');
+            const std::size_t written = framework4cpp::encodeHex(data.data(), length, out.data(), layout);
+            CHECK_EQ(written, out.size());
+            CHECK(out == reference(data.data(), length, layout));
+        }
+    }
+}
@@ -0,0 +1,411 @@
+#include "TestSupport.h"
+
+#include "framework4cpp/RecordRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using global_buffer::RecordHeader;
+using global_buffer::RecordRing;
+
+constexpr std::size_t kDataBytes = 4096;
+
+// 確保したレコードへ seed から決まる内容を書き込んで公開する
+void writeRecord(RecordRing &ring, std::uint64_t position, std::size_t payloadSize, std::uint32_t seed) {
+    RecordHeader &record = ring.header(position);
+    record.sequence = seed;
+    record.sourceSequence = seed;
+    record.timestamp = seed;
+    record.sourceId = 0;
+    record.payloadSize = static_cast<std::uint32_t>(payloadSize);
+    std::uint8_t *payload = ring.payload(position);
+    for (std::size_t i = 0; i < payloadSize; ++i) {
+        payload[i] = static_cast<std::uint8_t>(seed * 31 + i);
+    }
+    ring.commit(position);
+}
+
+bool matches(RecordRing &ring, std::uint64_t position, std::size_t payloadSize, std::uint32_t seed) {
+    const RecordHeader &record = ring.header(position);
+    if (record.sequence != seed || record.payloadSize != payloadSize) {
+        return false;
+    }
+    const std::uint8_t *payload = ring.payload(position);
+    for (std::size_t i = 0; i < payloadSize; ++i) {
+        if (payload[i] != static_cast<std::uint8_t>(seed * 31 + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 公開済みのレコードを全て読み出して返却し、データレコードの位置を順に返す
+std::vector<std::uint64_t> drain(RecordRing &ring) {
+    std::vector<std::uint64_t> records;
+    while (true) {
+        std::uint64_t begin = 0;
+        std::uint64_t end = 0;
+        ring.tryClaimRead(64, begin, end);
+        if (begin == end) {
+            break;
+        }
+        for (std::uint64_t position = begin; position < end;) {
+            if (ring.header(position).state.load() == RecordRing::kCommitted) {
+                records.push_back(position);
+            }
+            position = ring.next(position);
+        }
+    }
+    return records;
+}
+
+void releaseAll(RecordRing &ring, std::uint64_t begin, std::uint64_t end) {
+    for (std::uint64_t position = begin; position < end;) {
+        std::uint64_t next = ring.next(position);
+        ring.release(position);
+        position = next;
+    }
+    ring.reclaim();
+}
+
+} // namespace
+
+TEST_CASE(recordRingClaimsMaxLengthAtEveryWrapOffset) {
+    framework4cpp_test::TemporaryFile file("wrap.mmap");
+    RecordRing ring(file.path(), kDataBytes);
+    const std::size_t maxPayload = ring.maxRecordLength() - sizeof(RecordHeader);
+    REQUIRE(RecordRing::recordLength(maxPayload) == ring.maxRecordLength());
+
+    // 空のリングでは、末尾がどの位置にあっても最大長のレコードを確保できる
+    std::uint32_t seed = 0;
+    for (std::size_t offset = 0; offset < kDataBytes; offset += RecordRing::kAlignment) {
+        // 先頭・終端からの距離がヘッダより短い位置には、レコードの境界が来ない
+        if ((offset > 0 && offset < sizeof(RecordHeader)) || kDataBytes - offset < sizeof(RecordHeader)) {
+            continue;
+        }
+        std::uint64_t begin = ring.readCursor();
+        std::uint64_t position = 0;
+        // 小さなレコードを読み書きして末尾を offset へ進める（手前にある場合は終端まで埋めて 1 周する）
+        while (ring.tail() % kDataBytes != offset) {
+            const std::size_t current = static_cast<std::size_t>(ring.tail() % kDataBytes);
+            std::size_t gap = offset - current;
+            if (offset < current || gap < sizeof(RecordHeader)) {
+                gap = kDataBytes - current;
+            }
+            const std::size_t length =
+                gap <= ring.maxRecordLength() ? gap : std::min(ring.maxRecordLength(), gap - sizeof(RecordHeader));
+            REQUIRE(ring.tryClaim(length, position));
+            writeRecord(ring, position, 0, seed++);
+            drain(ring);
+            releaseAll(ring, begin, ring.tail());
+            begin = ring.readCursor();
+        }
+
+        const std::uint64_t tailBefore = ring.tail();
+        for (std::size_t payloadSize : {maxPayload, maxPayload - 1, maxPayload - RecordRing::kAlignment}) {
+            REQUIRE(ring.tryClaim(RecordRing::recordLength(payloadSize), position));
+            const std::uint32_t length = ring.header(position).length.load();
+            // レコードはデータ領域の終端をまたがない
+            CHECK(position % kDataBytes + length <= kDataBytes);
+            CHECK(length >= RecordRing::recordLength(payloadSize));
+            writeRecord(ring, position, payloadSize, seed);
+            const std::vector<std::uint64_t> records = drain(ring);
+            CHECK_EQ(records.size(), std::size_t{1});
+            if (records.size() == 1) {
+                CHECK_EQ(records[0], position);
+                CHECK(matches(ring, position, payloadSize, seed));
+            }
+            releaseAll(ring, begin, ring.tail());
+            begin = ring.readCursor();
+            ++seed;
+        }
+        CHECK(ring.tail() > tailBefore);
+        CHECK_EQ(ring.head(), ring.tail());
+    }
+}
+
+TEST_CASE(recordRingRejectsClaimsBeyondFreeSpace) {
+    framework4cpp_test::TemporaryFile file("full.mmap");
+    RecordRing ring(file.path(), kDataBytes);
+    std::uint64_t first = 0;
+    std::uint64_t second = 0;
+    std::uint64_t position = 0;
+    REQUIRE(ring.tryClaim(ring.maxRecordLength(), first));
+    REQUIRE(ring.tryClaim(ring.maxRecordLength(), second));
+    // 返却されるまでは、どの長さも確保できない
+    CHECK(!ring.tryClaim(RecordRing::recordLength(0), position));
+    CHECK(!ring.canClaim(RecordRing::recordLength(0)));
+    writeRecord(ring, first, 0, 1);
+    writeRecord(ring, second, 0, 2);
+    std::vector<std::uint64_t> records = drain(ring);
+    CHECK_EQ(records.size(), std::size_t{2});
+    releaseAll(ring, first, ring.tail());
+    CHECK(ring.tryClaim(ring.maxRecordLength(), position));
+}
+
+TEST_CASE(recordRingShrinkReturnsSpaceAcrossWrap) {
+    framework4cpp_test::TemporaryFile file("shrink.mmap");
+    RecordRing ring(file.path(), kDataBytes);
+    std::uint32_t seed = 0;
+    // 最大長で確保してから実際の長さへ縮める流れを何周も繰り返す
+    for (std::size_t round = 0; round < 200; ++round) {
+        const std::uint64_t begin = ring.readCursor();
+        std::uint64_t position = 0;
+        REQUIRE(ring.tryClaim(ring.maxRecordLength(), position));
+        const std::size_t payloadSize = (round * 37) % (ring.maxRecordLength() - sizeof(RecordHeader));
+        ring.shrink(position, RecordRing::recordLength(payloadSize));
+        CHECK(ring.header(position).length.load() < RecordRing::recordLength(payloadSize) + sizeof(RecordHeader));
+        CHECK_EQ(ring.tail(), position + ring.header(position).length.load());
+        writeRecord(ring, position, payloadSize, seed);
+        std::vector<std::uint64_t> records = drain(ring);
+        CHECK_EQ(records.size(), std::size_t{1});
+        CHECK(matches(ring, position, payloadSize, seed));
+        releaseAll(ring, begin, ring.tail());
+        ++seed;
+    }
+    CHECK(ring.tail() > 4 * kDataBytes);
+}
+
+TEST_CASE(recordRingRecoveryDropsTornAndCorruptRecords) {
+    framework4cpp_test::TemporaryFile file("recover.mmap");
+    std::vector<std::uint64_t> kept;
+    {
+        RecordRing ring(file.path(), kDataBytes);
+        std::uint64_t position = 0;
+        for (std::uint32_t seed = 0; seed < 3; ++seed) {
+            REQUIRE(ring.tryClaim(RecordRing::recordLength(100), position));
+            writeRecord(ring, position, 100, seed);
+            kept.push_back(position);
+        }
+        // 書き込み途中で停止したレコード（長さは見えているが公開されていない）
+        REQUIRE(ring.tryClaim(RecordRing::recordLength(100), position));
+        ring.header(position).payloadSize = 100;
+        // 公開後にペイロードが壊れたレコード
+        REQUIRE(ring.tryClaim(RecordRing::recordLength(100), position));
+        writeRecord(ring, position, 100, 3);
+        ring.payload(position)[10] ^= 0xFF;
+        // 後続の完全なレコードは引き継がれる
+        REQUIRE(ring.tryClaim(RecordRing::recordLength(100), position));
+        writeRecord(ring, position, 100, 4);
+        kept.push_back(position);
+    }
+
+    RecordRing ring(file.path(), kDataBytes, true);
+    CHECK_EQ(ring.recoveredRecords(), std::size_t{4});
+    const std::vector<std::uint64_t> records = drain(ring);
+    REQUIRE(records == kept);
+    const std::uint32_t seeds[] = {0, 1, 2, 4};
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        CHECK(matches(ring, records[i], 100, seeds[i]));
+    }
+    // 引き継いだ番号と重複しないよう、通し番号は最大の番号の次から振られる
+    CHECK_EQ(ring.nextSequence(1), std::uint64_t{5});
+}
+
+TEST_CASE(recordRingRecoveryTruncatesAtUnwrittenLength) {
+    framework4cpp_test::TemporaryFile file("torn.mmap");
+    std::uint64_t torn = 0;
+    {
+        RecordRing ring(file.path(), kDataBytes);
+        std::uint64_t position = 0;
+        for (std::uint32_t seed = 0; seed < 2; ++seed) {
+            REQUIRE(ring.tryClaim(RecordRing::recordLength(40), position));
+            writeRecord(ring, position, 40, seed);
+        }
+        // 末尾を進めた直後、長さを書く前に停止した状態を作る（以降のレコードは辿れない）
+        REQUIRE(ring.tryClaim(RecordRing::recordLength(40), torn));
+        ring.header(torn).length.store(0);
+        REQUIRE(ring.tryClaim(RecordRing::recordLength(40), position));
+        writeRecord(ring, position, 40, 2);
+    }
+
+    RecordRing ring(file.path(), kDataBytes, true);
+    CHECK_EQ(ring.recoveredRecords(), std::size_t{2});
+    CHECK_EQ(ring.tail(), torn);
+    CHECK_EQ(drain(ring).size(), std::size_t{2});
+    // 辿れなかった領域は空きへ戻り、続きから書き込める
+    std::uint64_t position = 0;
+    REQUIRE(ring.tryClaim(RecordRing::recordLength(40), position));
+    CHECK_EQ(position, torn);
+    CHECK_EQ(ring.header(position + RecordRing::recordLength(40)).length.load(), std::uint32_t{0});
+    writeRecord(ring, position, 40, 9);
+    const std::vector<std::uint64_t> records = drain(ring);
+    CHECK_EQ(records.size(), std::size_t{1});
+    CHECK(matches(ring, position, 40, 9));
+}
+
+#ifndef _WIN32
+namespace global_buffer {
+
+// tryClaim が tail を進めてから長さを書くまでの間に停止した生産者を再現する
+class RecordRingTestAccess {
+public:
+    // 範囲を記録して tail を進め、ラップマーカーも長さも書かずに戻る（空きがある前提）
+    static void claimWithoutLength(RecordRing &ring, std::size_t length) {
+        RecordRing::Claim &claim = ring.acquireClaim();
+        std::uint64_t tail = ring.control_->tail.load(std::memory_order_acquire);
+        std::size_t offset = static_cast<std::size_t>(tail % ring.dataBytes_);
+        std::size_t toEnd = ring.dataBytes_ - offset;
+        std::size_t padding = length > toEnd ? toEnd : 0;
+        std::size_t fitted = ring.fitLength(padding > 0 ? 0 : offset, length);
+        claim.padding.store(static_cast<std::uint32_t>(padding), std::memory_order_relaxed);
+        claim.length.store(static_cast<std::uint32_t>(fitted), std::memory_order_relaxed);
+        claim.begin.store(tail, std::memory_order_release);
+        ring.control_->tail.store(tail + padding + fitted, std::memory_order_release);
+    }
+};
+
+} // namespace global_buffer
+
+namespace {
+
+// 読み出せるレコードを全て返却する。公開済みのデータが壊れていれば intact を false にする
+std::size_t drainShared(RecordRing &ring, bool &intact) {
+    std::size_t records = 0;
+    while (true) {
+        std::uint64_t begin = 0;
+        std::uint64_t end = 0;
+        records += ring.tryClaimRead(64, begin, end);
+        if (begin == end) {
+            return records;
+        }
+        for (std::uint64_t position = begin; position < end; position = ring.next(position)) {
+            const RecordHeader &record = ring.header(position);
+            if (record.state.load() == RecordRing::kCommitted) {
+                intact = intact && matches(ring, position, record.payloadSize,
+                                           static_cast<std::uint32_t>(record.sequence));
+            }
+        }
+        releaseAll(ring, begin, end);
+    }
+}
+
+// 子プロセスで 1 件目を公開し、length バイトの範囲を tail まで確保したまま長さを書かずに 3 件目を公開して終了する
+bool stopBetweenTailAndLength(const std::string &path, std::size_t length) {
+    const pid_t child = ::fork();
+    if (child == -1) {
+        return false;
+    }
+    if (child == 0) {
+        global_buffer::MapSettings settings;
+        settings.shared = true;
+        RecordRing producer(path, kDataBytes, false, settings);
+        std::uint64_t first = 0;
+        std::uint64_t third = 0;
+        if (!producer.tryClaim(RecordRing::recordLength(16), first)) {
+            _exit(1);
+        }
+        writeRecord(producer, first, 16, 1);
+        global_buffer::RecordRingTestAccess::claimWithoutLength(producer, length);
+        if (!producer.tryClaim(RecordRing::recordLength(16), third)) {
+            _exit(1);
+        }
+        writeRecord(producer, third, 16, 3);
+        _exit(0);
+    }
+    int status = 0;
+    return ::waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+} // namespace
+
+TEST_CASE(sharedRingSkipsRecordsLeftUnpublishedByStoppedProducer) {
+    framework4cpp_test::TemporaryFile file("stopped.mmap");
+    global_buffer::MapSettings settings;
+    settings.shared = true;
+    RecordRing ring(file.path(), kDataBytes, false, settings);
+    ring.acquireConsumer();
+    const pid_t child = ::fork();
+    REQUIRE(child != -1);
+    if (child == 0) {
+        // 1 件目を公開し、2 件目を確保したまま停止する（3 件目は公開済み）
+        RecordRing producer(file.path(), kDataBytes, false, settings);
+        std::uint64_t first = 0;
+        std::uint64_t second = 0;
+        std::uint64_t third = 0;
+        if (producer.tryClaim(RecordRing::recordLength(16), first) &&
+            producer.tryClaim(RecordRing::recordLength(16), second) &&
+            producer.tryClaim(RecordRing::recordLength(16), third)) {
+            writeRecord(producer, first, 16, 1);
+            writeRecord(producer, third, 16, 3);
+            _exit(0);
+        }
+        _exit(1);
+    }
+    int status = 0;
+    REQUIRE(::waitpid(child, &status, 0) == child);
+    REQUIRE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    bool intact = true;
+    CHECK_EQ(drainShared(ring, intact), std::size_t{1});
+    CHECK(ring.readCursor() < ring.tail());
+    CHECK(ring.recoverStalled());
+    CHECK_EQ(drainShared(ring, intact), std::size_t{1});
+    CHECK(intact);
+    CHECK_EQ(ring.readCursor(), ring.tail());
+    CHECK_EQ(ring.head(), ring.tail());
+}
+
+
+TEST_CASE(sharedRingRecoversClaimsStoppedBeforeLengthWasWritten) {
+    framework4cpp_test::TemporaryFile file("unwritten.mmap");
+    global_buffer::MapSettings settings;
+    settings.shared = true;
+    RecordRing ring(file.path(), kDataBytes, false, settings);
+    ring.acquireConsumer();
+    REQUIRE(stopBetweenTailAndLength(file.path(), RecordRing::recordLength(100)));
+
+    // 長さの無い位置で読み出しが止まり、確保前に記録した範囲から読み飛ばし対象として公開される
+    bool intact = true;
+    CHECK_EQ(drainShared(ring, intact), std::size_t{1});
+    CHECK(ring.readCursor() < ring.tail());
+    CHECK_EQ(ring.header(ring.readCursor()).length.load(), std::uint32_t{0});
+    CHECK(ring.recoverStalled());
+    CHECK_EQ(ring.header(ring.readCursor()).state.load(), RecordRing::kDiscarded);
+    CHECK_EQ(drainShared(ring, intact), std::size_t{1});
+    CHECK(intact);
+    CHECK_EQ(ring.readCursor(), ring.tail());
+    CHECK_EQ(ring.head(), ring.tail());
+}
+
+TEST_CASE(sharedRingRecoversWrappingClaimsStoppedBeforeLengthWasWritten) {
+    framework4cpp_test::TemporaryFile file("unwritten-wrap.mmap");
+    global_buffer::MapSettings settings;
+    settings.shared = true;
+    RecordRing ring(file.path(), kDataBytes, false, settings);
+    ring.acquireConsumer();
+    // 終端までの余りが停止させる範囲より短くなるまで進め、ラップマーカーを伴う確保にする
+    const std::size_t length = RecordRing::recordLength(512);
+    bool intact = true;
+    for (std::uint32_t seed = 0; kDataBytes - ring.tail() % kDataBytes > length / 2; ++seed) {
+        std::uint64_t position = 0;
+        REQUIRE(ring.tryClaim(RecordRing::recordLength(64), position));
+        writeRecord(ring, position, 64, seed);
+        drainShared(ring, intact);
+    }
+    REQUIRE(kDataBytes - ring.tail() % kDataBytes >= sizeof(RecordHeader));
+    REQUIRE(stopBetweenTailAndLength(file.path(), length));
+
+    CHECK_EQ(drainShared(ring, intact), std::size_t{1});
+    const std::uint64_t marker = ring.readCursor();
+    CHECK(ring.recoverStalled());
+    CHECK_EQ(ring.header(marker).state.load(), RecordRing::kPadding);
+    CHECK_EQ(ring.next(marker) % kDataBytes, std::uint64_t{0});
+    CHECK_EQ(ring.header(ring.next(marker)).state.load(), RecordRing::kDiscarded);
+    CHECK_EQ(drainShared(ring, intact), std::size_t{1});
+    CHECK(intact);
+    CHECK_EQ(ring.readCursor(), ring.tail());
+    CHECK_EQ(ring.head(), ring.tail());
+}
+#endif
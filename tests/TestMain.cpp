@@ -0,0 +1,30 @@
+#include "TestSupport.h"
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+// 引数を指定した場合は、名前にその文字列を含むテストだけを実行する
+int main(int argc, char **argv) {
+    std::size_t failed = 0;
+    std::size_t run = 0;
+    for (const auto &test : framework4cpp_test::registry()) {
+        if (argc > 1 && std::strstr(test.name, argv[1]) == nullptr) {
+            continue;
+        }
+        ++run;
+        framework4cpp_test::failureCount() = 0;
+        try {
+            test.body();
+        } catch (const std::exception &ex) {
+            framework4cpp_test::reportFailure(__FILE__, __LINE__, std::string("unexpected exception: ") + ex.what());
+        }
+        const bool passed = framework4cpp_test::failureCount() == 0;
+        if (!passed) {
+            ++failed;
+        }
+        std::cout << (passed ? "[  OK  ] " : "[ FAIL ] ") << test.name << std::endl;
+    }
+    std::cout << run - failed << '/' << run << " tests passed" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
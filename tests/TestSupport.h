@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// 外部のテストフレームワークに依存しない最小限のテスト基盤
+namespace framework4cpp_test {
+
+struct TestCase {
+    const char *name;
+    void (*body)();
+};
+
+// 登録されたテストの一覧（静的初期化の順序に依存しないよう関数内で保持する）
+inline std::vector<TestCase> &registry() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+// 実行中のテストで記録した失敗の件数
+inline std::size_t &failureCount() {
+    static std::size_t count = 0;
+    return count;
+}
+
+struct Registrar {
+    Registrar(const char *name, void (*body)()) { registry().push_back(TestCase{name, body}); }
+};
+
+inline void reportFailure(const char *file, int line, const std::string &message) {
+    ++failureCount();
+    std::cerr << "  " << file << ':' << line << ": " << message << '\n';
+}
+
+template <typename Left, typename Right>
+std::string describeMismatch(const char *expression, const Left &left, const Right &right) {
+    std::ostringstream stream;
+    stream << expression << " (" << left << " vs " << right << ')';
+    return stream.str();
+}
+
+// テストごとに衝突しない一時ファイルのパス（ファイルは作成しない。使用後は呼び出し側で削除する）
+inline std::string temporaryPath(const std::string &name) {
+    static std::mt19937_64 random{std::random_device{}()};
+    std::ostringstream stream;
+    stream << "framework4cpp_test_" << std::hex << random() << '_' << name;
+    return (std::filesystem::temp_directory_path() / stream.str()).string();
+}
+
+// スコープを抜けるときに一時ファイルを削除する
+class TemporaryFile {
+public:
+    explicit TemporaryFile(const std::string &name) : path_(temporaryPath(name)) {}
+    ~TemporaryFile() {
+        std::error_code error;
+        std::filesystem::remove(path_, error);
+    }
+    TemporaryFile(const TemporaryFile &) = delete;
+    TemporaryFile &operator=(const TemporaryFile &) = delete;
+
+    const std::string &path() const noexcept { return path_; }
+
+private:
+    std::string path_;
+};
+
+} // namespace framework4cpp_test
+
+#define FW_TEST_CONCAT_INNER(a, b) a##b
+#define FW_TEST_CONCAT(a, b) FW_TEST_CONCAT_INNER(a, b)
+
+// テストを定義して登録する
+#define TEST_CASE(name)                                                                                       \
+    static void name();                                                                                       \
+    static const ::framework4cpp_test::Registrar FW_TEST_CONCAT(name, _registrar)(#name, name);               \
+    static void name()
+
+// 条件を確認し、満たさなければ失敗を記録してテストを続ける
+#define CHECK(condition)                                                                                      \
+    do {                                                                                                      \
+        if (!(condition)) {                                                                                   \
+            ::framework4cpp_test::reportFailure(__FILE__, __LINE__, "CHECK(" #condition ")");                 \
+        }                                                                                                     \
+    } while (false)
+
+#define CHECK_EQ(left, right)                                                                                 \
+    do {                                                                                                      \
+        const auto &fwLeft = (left);                                                                          \
+        const auto &fwRight = (right);                                                                        \
+        if (!(fwLeft == fwRight)) {                                                                           \
+            ::framework4cpp_test::reportFailure(                                                              \
+                __FILE__, __LINE__,                                                                           \
+                ::framework4cpp_test::describeMismatch("CHECK_EQ(" #left ", " #right ")", fwLeft, fwRight));  \
+        }                                                                                                     \
+    } while (false)
+
+// 条件を満たさなければ失敗を記録し、そのテストを打ち切る
+#define REQUIRE(condition)                                                                                    \
+    do {                                                                                                      \
+        if (!(condition)) {                                                                                   \
+            ::framework4cpp_test::reportFailure(__FILE__, __LINE__, "REQUIRE(" #condition ")");               \
+            return;                                                                                           \
+        }                                                                                                     \
+    } while (false)
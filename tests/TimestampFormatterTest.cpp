@@ -0,0 +1,187 @@
+#include "TestSupport.h"
+
+#include "framework4cpp/TimestampFormatter.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::system_clock;
+
+// TZ を切り替え、スコープを抜けるときに元へ戻す
+class ScopedTimeZone {
+public:
+    explicit ScopedTimeZone(const char *zone) {
+        if (const char *current = std::getenv("TZ")) {
+            previous_ = current;
+            hadPrevious_ = true;
+        }
+        set(zone);
+    }
+    ~ScopedTimeZone() { set(hadPrevious_ ? previous_.c_str() : nullptr); }
+    ScopedTimeZone(const ScopedTimeZone &) = delete;
+    ScopedTimeZone &operator=(const ScopedTimeZone &) = delete;
+
+private:
+    static void set(const char *zone) {
+#ifdef _WIN32
+        _putenv_s("TZ", zone ? zone : "");
+        _tzset();
+#else
+        if (zone) {
+            ::setenv("TZ", zone, 1);
+        } else {
+            ::unsetenv("TZ");
+        }
+        ::tzset();
+#endif
+    }
+
+    std::string previous_;
+    bool hadPrevious_{false};
+};
+
+// 秒未満の指定子を桁に置き換えてから put_time で整形する（期待値）
+std::string reference(const std::string &format, std::int64_t nanoseconds) {
+    std::int64_t second = nanoseconds / 1000000000;
+    std::int64_t fraction = nanoseconds % 1000000000;
+    if (fraction < 0) {
+        --second;
+        fraction += 1000000000;
+    }
+    std::string expanded;
+    for (std::size_t i = 0; i < format.size(); ++i) {
+        if (format[i] != '%' || i + 1 == format.size()) {
+            expanded.push_back(format[i]);
+            continue;
+        }
+        unsigned digits = 0;
+        if (format[i + 1] == 'f') {
+            digits = 6;
+        } else if (format[i + 1] >= '1' && format[i + 1] <= '9' && i + 2 < format.size() && format[i + 2] == 'f') {
+            digits = static_cast<unsigned>(format[i + 1] - '0');
+            ++i;
+        }
+        if (digits == 0) {
+            expanded.append(format, i, 2);
+        } else {
+            std::ostringstream value;
+            value << std::setw(9) << std::setfill('0') << fraction;
+            expanded.append(value.str(), 0, digits);
+        }
+        ++i;
+    }
+    const auto time = static_cast<std::time_t>(second);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &time);
+#else
+    localtime_r(&time, &local);
+#endif
+    std::ostringstream stream;
+    stream << std::put_time(&local, expanded.c_str());
+    return stream.str();
+}
+
+Clock::time_point fromNanoseconds(std::int64_t nanoseconds) {
+    return Clock::time_point(std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(nanoseconds)));
+}
+
+// instants の順に 1 つの整形器で整形し（前回の結果の使い回しを通す）、全て put_time と一致するか確かめる
+void checkSequence(const char *zone, const std::string &format, const std::vector<std::int64_t> &instants) {
+    framework4cpp::TimestampFormatter formatter(format);
+    std::string out;
+    for (std::int64_t instant : instants) {
+        // system_clock の分解能より細かい部分は、比較の前に落としておく
+        const std::int64_t nanoseconds =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(fromNanoseconds(instant).time_since_epoch()).count();
+        out.clear();
+        formatter.append(fromNanoseconds(instant), out);
+        const std::string expected = reference(format, nanoseconds);
+        if (out != expected) {
+            framework4cpp_test::reportFailure(__FILE__, __LINE__,
+                                              std::string(zone) + " \"" + format + "\" at " +
+                                                  std::to_string(nanoseconds) + ": " + out + " vs " + expected);
+        }
+    }
+}
+
+// base の前後 range 秒を step ナノ秒ごとに並べ、各秒の境目の直前・直後も加える
+std::vector<std::int64_t> around(std::int64_t baseSeconds, std::int64_t range, std::int64_t step) {
+    std::vector<std::int64_t> instants;
+    const std::int64_t base = baseSeconds * 1000000000;
+    for (std::int64_t offset = -range * 1000000000; offset <= range * 1000000000; offset += step) {
+        instants.push_back(base + offset);
+    }
+    for (std::int64_t second = -range; second <= range; ++second) {
+        instants.push_back(base + second * 1000000000 - 1);
+        instants.push_back(base + second * 1000000000);
+    }
+    return instants;
+}
+
+const char *const kZones[] = {
+    "UTC0",
+    // 米国東部（2024-03-10 02:00 に夏時間へ、2024-11-03 02:00 に標準時へ切り替わる）
+    "EST5EDT,M3.2.0,M11.1.0",
+    // 時差が 30 分単位の地域
+    "<+0530>-5:30",
+    // 夏時間の差が 30 分の地域（2024-10-06 02:00 に +11:00 へ、2024-04-07 02:00 に +10:30 へ戻る）
+    "<+1030>-10:30<+11>-11,M10.1.0,M4.1.0",
+};
+
+const char *const kFormats[] = {
+    "%Y-%m-%d %H:%M:%S",
+    "%Y-%m-%d %H:%M:%S.%3f",
+    "%H:%M:%S.%9f %Z %z",
+    "%f|%1f|%6f",
+    "100%% %H%%%M %%f %%3f %S.%3f%%",
+    "%s.%9f",
+    "",
+};
+
+} // namespace
+
+TEST_CASE(timestampFormatterMatchesPutTimeAcrossBoundaries) {
+    // 秒・分・時の境目、夏時間の切り替え、エポック前後
+    const std::int64_t bases[] = {
+        1704067200, // 2024-01-01 00:00:00 UTC（年・日・時・分の境目）
+        1704067230, // 分の途中
+        1710054000, // 2024-03-10 07:00:00 UTC（米国東部の夏時間開始）
+        1730613600, // 2024-11-03 06:00:00 UTC（米国東部の夏時間終了）
+        1712415600, // 2024-04-06 15:00:00 UTC（+11:00 → +10:30）
+        1728142200, // 2024-10-05 15:30:00 UTC（+10:30 → +11:00）
+        0,          // エポック（負の時刻を含む）
+    };
+    for (const char *zone : kZones) {
+        ScopedTimeZone scoped(zone);
+        for (const char *format : kFormats) {
+            for (std::int64_t base : bases) {
+                std::vector<std::int64_t> instants = around(base, 90, 250000000 + 7);
+                checkSequence(zone, format, instants);
+                // 時刻が戻る場合も、使い回した結果と食い違わない
+                std::vector<std::int64_t> reversed(instants.rbegin(), instants.rend());
+                checkSequence(zone, format, reversed);
+            }
+        }
+    }
+}
+
+TEST_CASE(timestampFormatterHandlesLargeJumps) {
+    ScopedTimeZone scoped("EST5EDT,M3.2.0,M11.1.0");
+    // 同じ分・同じ秒の値が別の日に現れても取り違えない
+    const std::vector<std::int64_t> instants = {
+        1704067259LL * 1000000000 + 999999999, 1704153659LL * 1000000000 + 1, 1704067259LL * 1000000000 + 5,
+        1704067260LL * 1000000000,             1735689599LL * 1000000000,     1704067200LL * 1000000000,
+    };
+    for (const char *format : kFormats) {
+        checkSequence("EST5EDT", format, instants);
+    }
+}